@@ -1,14 +1,44 @@
 #include "binary_serial.h"
+#include "text_codec.h"
 #include <string.h>
 
+size_t field_len(const char *field, size_t max_len) {
+  const char *end = memchr(field, '\0', max_len);
+  return end ? (size_t)(end - field) : max_len;
+}
+
+// LEB128 varint helpers (7 bits per byte, MSB = continuation)
+static size_t varint_put(uint8_t *out, uint32_t value) {
+  size_t n = 0;
+  while (value >= 0x80) {
+    out[n++] = (uint8_t)(value | 0x80);
+    value >>= 7;
+  }
+  out[n++] = (uint8_t)value;
+  return n;
+}
+
+static int varint_get(const uint8_t *in, size_t in_len, size_t *idx,
+                      uint32_t *value) {
+  uint32_t result = 0;
+  for (int shift = 0; shift < 32; shift += 7) {
+    if (*idx >= in_len)
+      return -1;
+    uint8_t b = in[(*idx)++];
+    result |= (uint32_t)(b & 0x7F) << shift;
+    if (!(b & 0x80)) {
+      *value = result;
+      return 0;
+    }
+  }
+  return -1; // too long
+}
+
 int serialize_message(const MeshMessage *msg, uint8_t *out_buf,
                       size_t *out_len) {
   if (!msg || !out_buf || !out_len)
     return -1;
 
-  if (msg->payload_len > MAX_PAYLOAD_SIZE)
-    return -2;
-
   size_t idx = 0;
 
   out_buf[idx++] = msg->type;
@@ -35,41 +65,256 @@ int serialize_message(const MeshMessage *msg, uint8_t *out_buf,
   return 0;
 }
 
-int deserialize_message(const uint8_t *in_buf, size_t in_len,
-                        MeshMessage *msg) {
-  if (!in_buf || !msg || in_len < (1 + 8 + USERNAME_MAX_LEN + 2 + 1))
+int serialize_message_v2(const MeshMessage *msg, int64_t now_us,
+                         uint8_t *out_buf, size_t *out_len) {
+  if (!msg || !out_buf || !out_len)
     return -1;
 
+  if (msg->type > MSG_V2_TYPE_MASK)
+    return -2;
+
+  size_t idx = 1; // header written last, once flags are known
+  uint8_t hdr = MSG_V2_MARKER | msg->type;
+
+  if (msg->msg_id != 0) {
+    hdr |= MSG_V2_FLAG_ID;
+    out_buf[idx++] = msg->msg_id;
+  }
+
+  // Timestamp as age in ms (fresh messages carry no timestamp at all)
+  int64_t age_ms = (now_us - (int64_t)msg->timestamp) / 1000;
+  if (age_ms > 0) {
+    if (age_ms > UINT32_MAX)
+      age_ms = UINT32_MAX;
+    hdr |= MSG_V2_FLAG_TS;
+    idx += varint_put(&out_buf[idx], (uint32_t)age_ms);
+  }
+
+  size_t name_len = field_len(msg->sender_name, USERNAME_MAX_LEN - 1);
+  if (name_len > 0) {
+    hdr |= MSG_V2_FLAG_NAME;
+    idx += varint_put(&out_buf[idx], (uint32_t)name_len);
+    memcpy(&out_buf[idx], msg->sender_name, name_len);
+    idx += name_len;
+  }
+
+  // Text goes through the chat dictionary coder when that makes it shorter
+  const uint8_t *payload = msg->payload;
+  size_t payload_len = msg->payload_len;
+  uint8_t packed[MAX_PAYLOAD_SIZE];
+  if (msg->type == MSG_TYPE_TEXT) {
+    size_t packed_len =
+        text_compress(msg->payload, msg->payload_len, packed, sizeof(packed));
+    if (packed_len > 0) {
+      hdr |= MSG_V2_FLAG_COMP;
+      payload = packed;
+      payload_len = packed_len;
+    }
+  }
+
+  idx += varint_put(&out_buf[idx], (uint32_t)payload_len);
+  if (payload_len > 0) {
+    memcpy(&out_buf[idx], payload, payload_len);
+    idx += payload_len;
+  }
+
+  out_buf[0] = hdr;
+  *out_len = idx;
+  return 0;
+}
+
+static int deserialize_view_v2(const uint8_t *in_buf, size_t in_len,
+                               int64_t now_us, MeshMessageView *view) {
   size_t idx = 0;
+  uint8_t hdr = in_buf[idx++];
+  uint32_t value;
+
+  memset(view, 0, sizeof(*view));
+  view->type = hdr & MSG_V2_TYPE_MASK;
+
+  if (hdr & MSG_V2_FLAG_ID) {
+    if (idx >= in_len)
+      return -1;
+    view->msg_id = in_buf[idx++];
+  }
+
+  // timestamp age -> local clock
+  view->timestamp = (uint64_t)now_us;
+  if (hdr & MSG_V2_FLAG_TS) {
+    if (varint_get(in_buf, in_len, &idx, &value) != 0)
+      return -1;
+    view->timestamp = (uint64_t)(now_us - (int64_t)value * 1000);
+  }
+
+  // sender_name
+  if (hdr & MSG_V2_FLAG_NAME) {
+    if (varint_get(in_buf, in_len, &idx, &value) != 0 || value == 0 ||
+        value >= USERNAME_MAX_LEN || idx + value > in_len)
+      return -1;
+    view->sender_name = (const char *)&in_buf[idx];
+    view->sender_name_len = (uint8_t)value;
+    idx += value;
+  }
+
+  // payload_len + payload
+  if (varint_get(in_buf, in_len, &idx, &value) != 0)
+    return -1;
+  if (value > MAX_PAYLOAD_SIZE || (idx + value) > in_len)
+    return -2;
+  view->payload_len = (uint8_t)value;
+  view->payload = &in_buf[idx];
+  view->compressed = (hdr & MSG_V2_FLAG_COMP) != 0;
+
+  return 0;
+}
+
+static int deserialize_view_v1(const uint8_t *in_buf, size_t in_len,
+                               MeshMessageView *view) {
+  if (in_len < (1 + 8 + USERNAME_MAX_LEN + 2 + 1))
+    return -1;
+
+  size_t idx = 0;
+  memset(view, 0, sizeof(*view));
 
   // type
-  msg->type = in_buf[idx++];
+  view->type = in_buf[idx++];
 
   // timestamp
-  msg->timestamp = 0;
+  view->timestamp = 0;
   for (int i = 0; i < 8; ++i) {
-    msg->timestamp |= ((uint64_t)in_buf[idx++]) << (i * 8);
+    view->timestamp |= ((uint64_t)in_buf[idx++]) << (i * 8);
   }
 
-  // sender_name
-  memcpy(msg->sender_name, &in_buf[idx], USERNAME_MAX_LEN);
+  // sender_name (fixed length, null-padded)
+  view->sender_name = (const char *)&in_buf[idx];
+  view->sender_name_len =
+      field_len(view->sender_name, USERNAME_MAX_LEN - 1);
   idx += USERNAME_MAX_LEN;
-  msg->sender_name[USERNAME_MAX_LEN - 1] = '\0';
 
   // addr
-  msg->addr = ((uint16_t)in_buf[idx] << 8) | in_buf[idx + 1];
+  view->addr = ((uint16_t)in_buf[idx] << 8) | in_buf[idx + 1];
   idx += 2;
   // payload_len
-  msg->payload_len = in_buf[idx++];
-  if (msg->payload_len > MAX_PAYLOAD_SIZE || (idx + msg->payload_len) > in_len)
+  view->payload_len = in_buf[idx++];
+  if ((idx + view->payload_len) > in_len)
     return -2;
 
   // payload
-  if (msg->payload_len > 0) {
-    memcpy(msg->payload, &in_buf[idx], msg->payload_len);
+  view->payload = &in_buf[idx];
+
+  return 0;
+}
+
+int deserialize_message_view(const uint8_t *in_buf, size_t in_len,
+                             int64_t now_us, MeshMessageView *view) {
+  if (!in_buf || !view || in_len < 2)
+    return -1;
+
+  if (in_buf[0] & MSG_V2_MARKER)
+    return deserialize_view_v2(in_buf, in_len, now_us, view);
+
+  return deserialize_view_v1(in_buf, in_len, view);
+}
+
+int deserialize_message(const uint8_t *in_buf, size_t in_len, int64_t now_us,
+                        MeshMessage *msg) {
+  if (!msg)
+    return -1;
+
+  MeshMessageView view;
+  int ret = deserialize_message_view(in_buf, in_len, now_us, &view);
+  if (ret != 0)
+    return ret;
+
+  memset(msg, 0, sizeof(*msg));
+  msg->type = view.type;
+  msg->msg_id = view.msg_id;
+  msg->timestamp = view.timestamp;
+  if (view.sender_name_len > 0) {
+    memcpy(msg->sender_name, view.sender_name, view.sender_name_len);
+  }
+  msg->addr = view.addr;
+
+  if (view.compressed) {
+    int len = text_decompress(view.payload, view.payload_len, msg->payload,
+                              MAX_PAYLOAD_SIZE);
+    if (len < 0)
+      return -3;
+    msg->payload_len = (uint8_t)len;
   } else {
-    memset(msg->payload, 0, MAX_PAYLOAD_SIZE);
+    msg->payload_len = view.payload_len;
+    memcpy(msg->payload, view.payload, view.payload_len);
   }
 
   return 0;
 }
+
+int deserialize_view_payload(MeshMessageView *view, uint8_t *buf) {
+  if (!view || !buf)
+    return -1;
+  if (!view->compressed)
+    return 0;
+
+  int len =
+      text_decompress(view->payload, view->payload_len, buf, MAX_PAYLOAD_SIZE);
+  if (len < 0)
+    return -3;
+
+  view->payload = buf;
+  view->payload_len = (uint8_t)len;
+  view->compressed = false;
+  return 0;
+}
+
+uint8_t frame_peek_msg_id(const uint8_t *in_buf, size_t in_len,
+                          uint8_t *type) {
+  if (!in_buf || in_len < 2 || !(in_buf[0] & MSG_V2_MARKER))
+    return 0;
+
+  if (type)
+    *type = in_buf[0] & MSG_V2_TYPE_MASK;
+
+  return (in_buf[0] & MSG_V2_FLAG_ID) ? in_buf[1] : 0;
+}
+
+size_t serialize_batch_record(const uint8_t *record, size_t record_len,
+                              uint8_t *out_buf) {
+  if (!record || !out_buf || record_len == 0)
+    return 0;
+
+  size_t idx = varint_put(out_buf, (uint32_t)record_len);
+  memcpy(&out_buf[idx], record, record_len);
+  return idx + record_len;
+}
+
+int deserialize_batch_record(const uint8_t *in_buf, size_t in_len,
+                             size_t *offset, const uint8_t **record,
+                             size_t *record_len) {
+  if (!in_buf || !offset || !record || !record_len)
+    return -1;
+
+  // Skip the batch header on the first call
+  if (*offset == 0)
+    *offset = 1;
+  if (*offset >= in_len)
+    return 0;
+
+  uint32_t len = 0;
+  if (varint_get(in_buf, in_len, offset, &len) != 0 || len == 0 ||
+      len > in_len - *offset)
+    return -1;
+
+  *record = &in_buf[*offset];
+  *record_len = len;
+  *offset += len;
+  return 1;
+}
+
+size_t mesh_frame_segment_count(size_t frame_len) {
+  size_t access_len = MESH_VENDOR_OPCODE_SIZE + frame_len;
+  if (access_len <= MESH_UNSEG_ACCESS_MAX)
+    return 1;
+
+  size_t upper_len = access_len + MESH_TRANS_MIC_SIZE;
+  return (upper_len + MESH_SEG_PAYLOAD_SIZE - 1) / MESH_SEG_PAYLOAD_SIZE;
+}
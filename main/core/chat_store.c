@@ -0,0 +1,447 @@
+#include "chat_store.h"
+#include "crc16.h"
+#include "esp_log.h"
+#include <string.h>
+
+static const char *TAG = "CHAT_STORE";
+
+#define SEGMENT_MAGIC 0x474C4843 // "CHLG"
+#define MAX_SEGMENTS 32          // One bit each in conv_t.seg_mask
+#define RECORD_FLAG_OUTGOING 0x01
+
+typedef struct {
+  uint32_t magic;
+  uint32_t seq; // Log position of the segment, counts up from 1
+} segment_hdr_t;
+
+typedef struct __attribute__((packed)) {
+  uint16_t crc; // crc16 of the rest of the header and the text
+  uint16_t peer;
+  uint32_t seq;
+  uint8_t len;
+  uint8_t flags;
+} record_hdr_t;
+
+#define RECORD_SIZE(len) ((sizeof(record_hdr_t) + (len) + 3) & ~3u)
+#define RECORD_MAX_SIZE RECORD_SIZE(MAX_MESSAGE_LEN)
+
+// Per-conversation index entry
+typedef struct {
+  bool used;
+  uint16_t peer;
+  uint32_t last_seq;  // Highest live seq, the next append uses last_seq + 1
+  uint32_t count;     // Live messages
+  uint32_t seg_mask;  // Segment slots holding messages of the conversation
+  uint32_t keep_from; // Compaction scratch: first seq to copy forward
+} conv_t;
+
+typedef void (*record_fn_t)(uint32_t slot, const record_hdr_t *hdr,
+                            const char *text, void *ctx);
+
+static const chat_store_flash_t *flash = NULL;
+static uint32_t seg_count = 0;
+static uint32_t head_seq = 0; // Newest segment, 0 = log empty
+static uint32_t write_off = 0;
+static bool head_sealed = true; // No more appends to the head segment
+static conv_t convs[CHAT_STORE_MAX_CONVS];
+static chat_store_stats_t stats;
+
+static int flash_read(size_t addr, void *buf, size_t len) {
+  return flash->read(flash->ctx, addr, buf, len);
+}
+
+static int flash_write(size_t addr, const void *buf, size_t len) {
+  return flash->write(flash->ctx, addr, buf, len);
+}
+
+static uint32_t slot_of(uint32_t seq) { return seq % seg_count; }
+
+static size_t seg_addr(uint32_t slot) {
+  return (size_t)slot * CHAT_STORE_SEGMENT_SIZE;
+}
+
+// Oldest live segment (the newest seg_count - 1 are live)
+static uint32_t live_tail(void) {
+  return (head_seq > seg_count - 1) ? head_seq - (seg_count - 2) : 1;
+}
+
+static bool segment_has_seq(uint32_t slot, uint32_t seq) {
+  segment_hdr_t hdr;
+  if (flash_read(seg_addr(slot), &hdr, sizeof(hdr)) != 0)
+    return false;
+  return hdr.magic == SEGMENT_MAGIC && hdr.seq == seq;
+}
+
+static conv_t *conv_find(uint16_t peer, bool create) {
+  conv_t *free_conv = NULL;
+  for (int i = 0; i < CHAT_STORE_MAX_CONVS; i++) {
+    if (convs[i].used && convs[i].peer == peer)
+      return &convs[i];
+    // A conversation without live messages can be given to another peer,
+    // unless compaction is about to copy some back
+    if (!free_conv && (!convs[i].used ||
+                       (convs[i].count == 0 && convs[i].keep_from == 0)))
+      free_conv = &convs[i];
+  }
+  if (!create || !free_conv)
+    return NULL;
+
+  memset(free_conv, 0, sizeof(*free_conv));
+  free_conv->used = true;
+  free_conv->peer = peer;
+  return free_conv;
+}
+
+static uint16_t record_crc(const uint8_t *rec, size_t len) {
+  return crc16(rec + sizeof(uint16_t),
+               sizeof(record_hdr_t) - sizeof(uint16_t) + len);
+}
+
+static bool is_erased(const uint8_t *buf, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    if (buf[i] != 0xFF)
+      return false;
+  }
+  return true;
+}
+
+// Call fn for every valid record of a segment, oldest first. *end is set to
+// the offset after the last valid record.
+// Returns true if the data ends in a torn record rather than erased flash.
+static bool scan_segment(uint32_t slot, record_fn_t fn, void *ctx,
+                         uint32_t *end) {
+  uint8_t rec[RECORD_MAX_SIZE];
+  record_hdr_t *hdr = (record_hdr_t *)rec;
+  uint32_t off = sizeof(segment_hdr_t);
+  bool torn = false;
+
+  while (off + sizeof(record_hdr_t) <= CHAT_STORE_SEGMENT_SIZE) {
+    if (flash_read(seg_addr(slot) + off, rec, sizeof(record_hdr_t)) != 0) {
+      torn = true;
+      break;
+    }
+
+    if (is_erased(rec, sizeof(record_hdr_t)))
+      break;
+
+    uint32_t size = RECORD_SIZE(hdr->len);
+    if (hdr->len > MAX_MESSAGE_LEN || off + size > CHAT_STORE_SEGMENT_SIZE ||
+        flash_read(seg_addr(slot) + off + sizeof(record_hdr_t),
+                   rec + sizeof(record_hdr_t), hdr->len) != 0 ||
+        record_crc(rec, hdr->len) != hdr->crc) {
+      torn = true;
+      break;
+    }
+
+    if (fn)
+      fn(slot, hdr, (const char *)rec + sizeof(record_hdr_t), ctx);
+    off += size;
+  }
+
+  if (end)
+    *end = off;
+  return torn;
+}
+
+static void index_record(uint32_t slot, const record_hdr_t *hdr,
+                         const char *text, void *ctx) {
+  conv_t *conv = conv_find(hdr->peer, true);
+  if (!conv) {
+    ESP_LOGW(TAG, "Conversation index full, 0x%04X not indexed", hdr->peer);
+    return;
+  }
+  conv->count++;
+  if (hdr->seq > conv->last_seq)
+    conv->last_seq = hdr->seq;
+  conv->seg_mask |= 1u << slot;
+}
+
+static void unindex_record(uint32_t slot, const record_hdr_t *hdr,
+                           const char *text, void *ctx) {
+  conv_t *conv = conv_find(hdr->peer, false);
+  if (!conv)
+    return;
+  if (conv->count > 0)
+    conv->count--;
+  conv->seg_mask &= ~(1u << slot);
+}
+
+// Append a record to the head segment (room checked)
+static int write_record(uint16_t peer, uint32_t seq, uint8_t flags,
+                        const char *text, uint8_t len) {
+  uint8_t rec[RECORD_MAX_SIZE];
+  record_hdr_t *hdr = (record_hdr_t *)rec;
+  uint32_t size = RECORD_SIZE(len);
+
+  memset(rec, 0xFF, size);
+  hdr->peer = peer;
+  hdr->seq = seq;
+  hdr->len = len;
+  hdr->flags = flags;
+  memcpy(rec + sizeof(record_hdr_t), text, len);
+  hdr->crc = record_crc(rec, len);
+
+  uint32_t slot = slot_of(head_seq);
+  if (flash_write(seg_addr(slot) + write_off, rec, size) != 0) {
+    // Part of the record may be programmed: never write after it
+    head_sealed = true;
+    return -1;
+  }
+  stats.bytes_written += size;
+  write_off += size;
+  index_record(slot, hdr, text, NULL);
+  return 0;
+}
+
+// Compaction pass 1: newest retired record of each conversation that is
+// newer than all its live messages (kept in keep_from for now)
+static void compact_plan(uint32_t slot, const record_hdr_t *hdr,
+                         const char *text, void *ctx) {
+  conv_t *conv = conv_find(hdr->peer, true);
+  if (!conv)
+    return;
+  if (conv->count > 0 && hdr->seq <= conv->last_seq)
+    return; // Already copied, or newer history is live
+  if (hdr->seq > conv->keep_from)
+    conv->keep_from = hdr->seq;
+}
+
+// Compaction pass 2: copy the planned records forward, in order
+static void compact_copy(uint32_t slot, const record_hdr_t *hdr,
+                         const char *text, void *ctx) {
+  conv_t *conv = conv_find(hdr->peer, false);
+  if (!conv || conv->keep_from == 0 || hdr->seq < conv->keep_from)
+    return;
+
+  if (head_sealed ||
+      write_off + RECORD_SIZE(hdr->len) > CHAT_STORE_SEGMENT_SIZE) {
+    ESP_LOGW(TAG, "No room to keep message %lu of 0x%04X",
+             (unsigned long)hdr->seq, hdr->peer);
+    return;
+  }
+  if (write_record(hdr->peer, hdr->seq, hdr->flags, text, hdr->len) == 0)
+    stats.copied++;
+}
+
+// Copy what must survive out of the retired segment seq into the head.
+// Idempotent: records already copied are newer than nothing live.
+static void compact_segment(uint32_t seq) {
+  uint32_t slot = slot_of(seq);
+  if (!segment_has_seq(slot, seq))
+    return;
+
+  for (int i = 0; i < CHAT_STORE_MAX_CONVS; i++) {
+    convs[i].keep_from = 0;
+  }
+  scan_segment(slot, compact_plan, NULL, NULL);
+  for (int i = 0; i < CHAT_STORE_MAX_CONVS; i++) {
+    conv_t *conv = &convs[i];
+    uint32_t newest = conv->keep_from;
+    if (newest == 0)
+      continue;
+
+    uint32_t from = (newest > CHAT_STORE_KEEP) ? newest - CHAT_STORE_KEEP + 1
+                                               : 1;
+    if (conv->count > 0 && from <= conv->last_seq) {
+      from = conv->last_seq + 1;
+    } else if (conv->count == 0 && newest > conv->last_seq) {
+      conv->last_seq = newest; // Numbering stays monotonic if a copy fails
+    }
+    conv->keep_from = from;
+  }
+  scan_segment(slot, compact_copy, NULL, NULL);
+
+  for (int i = 0; i < CHAT_STORE_MAX_CONVS; i++) {
+    convs[i].keep_from = 0;
+  }
+}
+
+// Erase the next slot, make it the head and retire the oldest live segment
+static int open_segment(void) {
+  uint32_t seq = head_seq + 1;
+  uint32_t slot = slot_of(seq);
+
+  if (flash->erase(flash->ctx, seg_addr(slot), CHAT_STORE_SEGMENT_SIZE) !=
+      0) {
+    ESP_LOGE(TAG, "Erase of segment %lu failed", (unsigned long)slot);
+    return -1;
+  }
+  stats.erases++;
+
+  segment_hdr_t hdr = {.magic = SEGMENT_MAGIC, .seq = seq};
+  if (flash_write(seg_addr(slot), &hdr, sizeof(hdr)) != 0) {
+    ESP_LOGE(TAG, "Header write of segment %lu failed", (unsigned long)slot);
+    return -1;
+  }
+  stats.bytes_written += sizeof(hdr);
+  head_seq = seq;
+  write_off = sizeof(hdr);
+  head_sealed = false;
+
+  // The segment after the head is now outside the live window
+  if (seq >= seg_count) {
+    uint32_t retired = seq - (seg_count - 1);
+    scan_segment(slot_of(retired), unindex_record, NULL, NULL);
+    compact_segment(retired);
+  }
+  return 0;
+}
+
+int chat_store_init(const chat_store_flash_t *store_flash) {
+  flash = NULL;
+  if (!store_flash) {
+    ESP_LOGW(TAG, "No '%s' flash, chat history is not persisted",
+             CHAT_STORE_PARTITION);
+    return -1;
+  }
+
+  seg_count = store_flash->size / CHAT_STORE_SEGMENT_SIZE;
+  if (seg_count > MAX_SEGMENTS)
+    seg_count = MAX_SEGMENTS;
+  if (seg_count < 3) {
+    ESP_LOGE(TAG, "Partition too small (%lu segments)",
+             (unsigned long)seg_count);
+    return -1;
+  }
+  flash = store_flash;
+
+  memset(convs, 0, sizeof(convs));
+  memset(&stats, 0, sizeof(stats));
+  head_seq = 0;
+  write_off = 0;
+  head_sealed = true;
+
+  // The head is the newest segment whose header matches its slot
+  for (uint32_t slot = 0; slot < seg_count; slot++) {
+    segment_hdr_t hdr;
+    if (flash_read(seg_addr(slot), &hdr, sizeof(hdr)) == 0 &&
+        hdr.magic == SEGMENT_MAGIC && hdr.seq != 0 &&
+        slot_of(hdr.seq) == slot && hdr.seq > head_seq) {
+      head_seq = hdr.seq;
+    }
+  }
+  if (head_seq == 0) {
+    ESP_LOGI(TAG, "Empty chat store, %lu segments", (unsigned long)seg_count);
+    return 0;
+  }
+
+  // Rebuild the index from the live segments, oldest first
+  for (uint32_t seq = live_tail(); seq <= head_seq; seq++) {
+    uint32_t slot = slot_of(seq);
+    if (!segment_has_seq(slot, seq))
+      continue;
+
+    uint32_t end = 0;
+    bool torn = scan_segment(slot, index_record, NULL, &end);
+    if (seq == head_seq) {
+      write_off = end;
+      head_sealed = torn;
+    }
+    if (torn) {
+      ESP_LOGW(TAG, "Torn record in segment %lu at %lu",
+               (unsigned long)slot, (unsigned long)end);
+    }
+  }
+
+  // Finish a compaction interrupted by a reset
+  if (head_seq >= seg_count) {
+    compact_segment(head_seq - (seg_count - 1));
+  }
+
+  ESP_LOGI(TAG, "Chat store mounted: head %lu, offset %lu%s",
+           (unsigned long)head_seq, (unsigned long)write_off,
+           head_sealed ? " (sealed)" : "");
+  return 0;
+}
+
+int chat_store_append(uint16_t peer, bool outgoing, const char *text,
+                      size_t len) {
+  if (!flash || !text)
+    return -1;
+  if (len > MAX_MESSAGE_LEN)
+    len = MAX_MESSAGE_LEN;
+
+  // Open the next segment first: compaction may reassign idle conversations.
+  // Its copies can fill the fresh segment, then the one after is opened.
+  for (uint32_t opened = 0;
+       head_seq == 0 || head_sealed ||
+       write_off + RECORD_SIZE(len) > CHAT_STORE_SEGMENT_SIZE;
+       opened++) {
+    if (opened == seg_count || open_segment() != 0)
+      return -1;
+  }
+
+  int ret = -1;
+
+  conv_t *conv = conv_find(peer, true);
+  if (!conv) {
+    ESP_LOGW(TAG, "Conversation index full, message to 0x%04X not stored",
+             peer);
+  } else if (write_record(peer, conv->last_seq + 1,
+                          outgoing ? RECORD_FLAG_OUTGOING : 0, text,
+                          (uint8_t)len) == 0) {
+    stats.appends++;
+    ret = 0;
+  }
+  return ret;
+}
+
+uint32_t chat_store_count(uint16_t peer) {
+  if (!flash)
+    return 0;
+
+  conv_t *conv = conv_find(peer, false);
+  return conv ? conv->count : 0;
+}
+
+typedef struct {
+  uint16_t peer;
+  uint32_t lo, hi; // seq range of the page
+  chat_store_msg_t *out;
+  int max;
+  int n;
+} page_ctx_t;
+
+static void page_collect(uint32_t slot, const record_hdr_t *hdr,
+                         const char *text, void *ctx) {
+  page_ctx_t *page = ctx;
+  if (hdr->peer != page->peer || hdr->seq < page->lo || hdr->seq > page->hi ||
+      page->n >= page->max)
+    return;
+
+  chat_store_msg_t *msg = &page->out[page->n++];
+  msg->seq = hdr->seq;
+  msg->outgoing = (hdr->flags & RECORD_FLAG_OUTGOING) != 0;
+  msg->len = hdr->len;
+  memcpy(msg->text, text, hdr->len);
+  msg->text[hdr->len] = '\0';
+}
+
+int chat_store_read_page(uint16_t peer, uint32_t page, chat_store_msg_t *out,
+                         int page_size) {
+  if (!flash || !out || page_size <= 0)
+    return 0;
+
+  conv_t *conv = conv_find(peer, false);
+  uint64_t skip = (uint64_t)page * (uint32_t)page_size;
+  if (!conv || conv->count == 0 || skip >= conv->last_seq)
+    return 0;
+
+  page_ctx_t ctx = {.peer = peer, .out = out, .max = page_size};
+  ctx.hi = conv->last_seq - (uint32_t)skip;
+  ctx.lo = (ctx.hi > (uint32_t)page_size) ? ctx.hi - page_size + 1 : 1;
+
+  // Only the segments the index lists for this conversation are read; log
+  // order is seq order within a conversation
+  for (uint32_t seq = live_tail(); seq <= head_seq; seq++) {
+    uint32_t slot = slot_of(seq);
+    if (conv->seg_mask & (1u << slot))
+      scan_segment(slot, page_collect, &ctx, NULL);
+  }
+  return ctx.n;
+}
+
+void chat_store_get_stats(chat_store_stats_t *out) {
+  if (out)
+    *out = stats;
+}
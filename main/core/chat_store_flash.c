@@ -0,0 +1,34 @@
+#include "chat_store.h"
+#include "esp_partition.h"
+
+// chat_store_flash_t over the "chatlog" data partition
+
+static int partition_read(void *ctx, size_t addr, void *buf, size_t len) {
+  return esp_partition_read(ctx, addr, buf, len) == ESP_OK ? 0 : -1;
+}
+
+static int partition_write(void *ctx, size_t addr, const void *buf,
+                           size_t len) {
+  return esp_partition_write(ctx, addr, buf, len) == ESP_OK ? 0 : -1;
+}
+
+static int partition_erase(void *ctx, size_t addr, size_t len) {
+  return esp_partition_erase_range(ctx, addr, len) == ESP_OK ? 0 : -1;
+}
+
+const chat_store_flash_t *chat_store_partition_flash(void) {
+  static chat_store_flash_t flash = {
+      .read = partition_read,
+      .write = partition_write,
+      .erase = partition_erase,
+  };
+
+  const esp_partition_t *partition = esp_partition_find_first(
+      ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, CHAT_STORE_PARTITION);
+  if (!partition)
+    return NULL;
+
+  flash.size = partition->size;
+  flash.ctx = (void *)partition;
+  return &flash;
+}
@@ -0,0 +1,97 @@
+#include "chat_store.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <string.h>
+
+static const char *TAG = "CHAT_STORE";
+
+typedef struct {
+  uint16_t peer;
+  bool outgoing;
+  uint8_t len;
+  char text[MAX_MESSAGE_LEN];
+} store_item_t;
+
+static QueueHandle_t store_queue = NULL;
+static SemaphoreHandle_t store_mutex = NULL; // Recursive
+static uint32_t appends_dropped = 0;
+
+void chat_store_lock(void) {
+  if (store_mutex)
+    xSemaphoreTakeRecursive(store_mutex, portMAX_DELAY);
+}
+
+void chat_store_unlock(void) {
+  if (store_mutex)
+    xSemaphoreGiveRecursive(store_mutex);
+}
+
+// Flash writes and erases happen here, off the UI and RX tasks
+static void chat_store_task(void *pvParameters) {
+  static store_item_t item; // only touched by this task
+
+  while (1) {
+    if (xQueueReceive(store_queue, &item, portMAX_DELAY) != pdTRUE) {
+      continue;
+    }
+
+    chat_store_lock();
+    int err = chat_store_append(item.peer, item.outgoing, item.text, item.len);
+    chat_store_unlock();
+    if (err != 0) {
+      ESP_LOGW(TAG, "Message of 0x%04X not stored", item.peer);
+    }
+  }
+}
+
+void chat_store_task_init(void) {
+  if (store_queue) {
+    return;
+  }
+
+  if (!store_mutex) {
+    store_mutex = xSemaphoreCreateRecursiveMutex();
+    if (!store_mutex) {
+      ESP_LOGE(TAG, "Failed to create store mutex");
+      return;
+    }
+  }
+
+  store_queue = xQueueCreate(CHAT_STORE_QUEUE_LEN, sizeof(store_item_t));
+  if (!store_queue) {
+    ESP_LOGE(TAG, "Failed to create store queue");
+    return;
+  }
+
+  if (xTaskCreate(chat_store_task, "chat_store", CHAT_STORE_TASK_STACK_SIZE,
+                  NULL, CHAT_STORE_TASK_PRIORITY, NULL) != pdPASS) {
+    ESP_LOGE(TAG, "Failed to create store task");
+    vQueueDelete(store_queue);
+    store_queue = NULL;
+  }
+}
+
+int chat_store_append_async(uint16_t peer, bool outgoing, const char *text,
+                            size_t len) {
+  if (!store_queue || !text)
+    return -1;
+  if (len > MAX_MESSAGE_LEN)
+    len = MAX_MESSAGE_LEN;
+
+  store_item_t item;
+  item.peer = peer;
+  item.outgoing = outgoing;
+  item.len = (uint8_t)len;
+  memcpy(item.text, text, len);
+
+  if (xQueueSend(store_queue, &item, 0) != pdTRUE) {
+    appends_dropped++;
+    ESP_LOGW(TAG, "Store queue full, dropping message of 0x%04X (%lu so far)",
+             peer, (unsigned long)appends_dropped);
+    return -1;
+  }
+  return 0;
+}
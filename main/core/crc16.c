@@ -36,7 +36,7 @@ static const uint16_t crc16_table[256] = {
 uint16_t crc16(const uint8_t *data, size_t length) {
   uint16_t crc = 0xFFFF;
 
-  for (uint16_t i = 0; i < length; i++) {
+  for (size_t i = 0; i < length; i++) {
     uint8_t table_index = (crc ^ data[i]) & 0xFF;
     crc = (crc >> 8) ^ crc16_table[table_index];
   }
@@ -0,0 +1,65 @@
+#include "dedup_filter.h"
+#include <string.h>
+
+static uint8_t generations[2][DEDUP_FILTER_BITS / 8];
+static int current_gen = 0;
+static int64_t rotated_at = 0;
+
+// 32-bit integer mix (murmur3 finalizer)
+static uint32_t dedup_hash(uint32_t key) {
+  key ^= key >> 16;
+  key *= 0x85EBCA6B;
+  key ^= key >> 13;
+  key *= 0xC2B2AE35;
+  key ^= key >> 16;
+  return key;
+}
+
+static void dedup_rotate(int64_t now_us) {
+  int64_t elapsed_ms = (now_us - rotated_at) / 1000;
+  if (elapsed_ms < DEDUP_WINDOW_MS)
+    return;
+
+  if (elapsed_ms >= 2 * DEDUP_WINDOW_MS) {
+    // Both generations expired
+    memset(generations, 0, sizeof(generations));
+  } else {
+    current_gen ^= 1;
+    memset(generations[current_gen], 0, sizeof(generations[current_gen]));
+  }
+  rotated_at = now_us;
+}
+
+void dedup_filter_init(int64_t now_us) {
+  memset(generations, 0, sizeof(generations));
+  current_gen = 0;
+  rotated_at = now_us;
+}
+
+bool dedup_filter_seen(uint16_t src_addr, uint32_t key, int64_t now_us) {
+  dedup_rotate(now_us);
+
+  // Double hashing: bit_i = h1 + i * h2
+  uint32_t h = dedup_hash(key ^ dedup_hash(src_addr));
+  uint32_t h1 = h & 0xFFFF;
+  uint32_t h2 = (h >> 16) | 1;
+
+  uint16_t bit_idx[DEDUP_FILTER_HASHES];
+  bool in_current = true;
+  bool in_previous = true;
+  for (int i = 0; i < DEDUP_FILTER_HASHES; i++) {
+    bit_idx[i] = (h1 + i * h2) % DEDUP_FILTER_BITS;
+    uint8_t mask = 1 << (bit_idx[i] & 7);
+    if (!(generations[current_gen][bit_idx[i] >> 3] & mask))
+      in_current = false;
+    if (!(generations[current_gen ^ 1][bit_idx[i] >> 3] & mask))
+      in_previous = false;
+  }
+
+  // Record in the current generation (refreshes entries seen last window)
+  for (int i = 0; i < DEDUP_FILTER_HASHES; i++) {
+    generations[current_gen][bit_idx[i] >> 3] |= 1 << (bit_idx[i] & 7);
+  }
+
+  return in_current || in_previous;
+}
@@ -0,0 +1,37 @@
+#include "phrasebook.h"
+#include "crc16.h"
+#include <string.h>
+
+static const char *const phrases[PHRASEBOOK_SIZE] = {
+    "Hello", "How are you?", "Thanks", "Yes", "No", "OK", "Goodbye"};
+
+const char *phrasebook_get(uint8_t id) {
+  return id < PHRASEBOOK_SIZE ? phrases[id] : NULL;
+}
+
+int phrasebook_find(const char *text) {
+  if (!text)
+    return -1;
+
+  for (int i = 0; i < PHRASEBOOK_SIZE; i++) {
+    if (strcmp(phrases[i], text) == 0)
+      return i;
+  }
+  return -1;
+}
+
+// Computed on every call (about 60 bytes of CRC), so no cached state is
+// shared between the UI and mesh RX tasks
+uint16_t phrasebook_hash(void) {
+  // Chain the CRC over the version and each phrase incl. its terminator
+  uint8_t version = PHRASEBOOK_VERSION;
+  uint16_t crc = crc16(&version, 1);
+  for (int i = 0; i < PHRASEBOOK_SIZE; i++) {
+    uint16_t part = crc16((const uint8_t *)phrases[i], strlen(phrases[i]) + 1);
+    uint8_t chain[4] = {crc >> 8, crc & 0xFF, part >> 8, part & 0xFF};
+    crc = crc16(chain, sizeof(chain));
+  }
+
+  // 0 means "unknown" in the user table
+  return crc != 0 ? crc : 1;
+}
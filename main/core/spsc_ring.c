@@ -0,0 +1,46 @@
+#include "spsc_ring.h"
+
+int spsc_ring_init(spsc_ring_t *ring, void *storage, size_t slot_size,
+                   uint32_t slot_count) {
+  if (!ring || !storage || slot_count == 0 ||
+      (slot_count & (slot_count - 1)) != 0)
+    return -1;
+
+  ring->slots = storage;
+  ring->slot_size = slot_size;
+  ring->slot_count = slot_count;
+  atomic_init(&ring->head, 0);
+  atomic_init(&ring->tail, 0);
+  return 0;
+}
+
+// head and tail run freely and wrap at 2^32; slot_count divides 2^32
+static uint8_t *slot_at(spsc_ring_t *ring, uint32_t pos) {
+  return &ring->slots[(pos & (ring->slot_count - 1)) * ring->slot_size];
+}
+
+void *spsc_ring_write_slot(spsc_ring_t *ring) {
+  uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+  if (head - tail >= ring->slot_count)
+    return NULL;
+  return slot_at(ring, head);
+}
+
+void spsc_ring_commit(spsc_ring_t *ring) {
+  uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+void *spsc_ring_read_slot(spsc_ring_t *ring) {
+  uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+  uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+  if (head == tail)
+    return NULL;
+  return slot_at(ring, tail);
+}
+
+void spsc_ring_release(spsc_ring_t *ring) {
+  uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+  atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+}
@@ -0,0 +1,103 @@
+#include "text_codec.h"
+#include <string.h>
+
+// Common English chat fragments, longest first within each group
+static const char *const dict[128] = {
+    " the ", "hello", "thank", "where", "there", "what", "when", "have",
+    "that",  "this",  "with",  "your",  "ight",  "ould", "you",  "the",
+    "ing",   "and",   "are",   "for",   "not",   "can",  "out",  "see",
+    "now",   "ome",   "ent",   "ion",   "ere",   "all",  "ll ",  "e ",
+    "s ",    "t ",    "d ",    "y ",    "o ",    "n ",   "r ",   ", ",
+    ". ",    "? ",    "! ",    " t",    " a",    " i",   " w",   " s",
+    " o",    " h",    " m",    " y",    " b",    " c",   " f",   " g",
+    " l",    " d",    " n",    " I",    "th",    "he",   "in",   "er",
+    "an",    "re",    "on",    "at",    "en",    "nd",   "ou",   "es",
+    "is",    "it",    "or",    "to",    "ha",    "ll",   "ed",   "hi",
+    "as",    "ar",    "te",    "st",    "ng",    "le",   "ve",   "me",
+    "se",    "of",    "no",    "go",    "be",    "we",   "do",   "so",
+    "ok",    "OK",    "et",    "ea",    "ti",    "al",   "ne",   "wa",
+    "ro",    "co",    "ma",    "ra",    "de",    "ri",   "ic",   "li",
+    "om",    "ur",    "la",    "el",    "ee",    "oo",   "ay",   "ow",
+    "ch",    "wh",    "sh",    "ly",    "ce",    "ge",   "us",   "ca"};
+
+// strlen() of each dict entry, so matching never has to measure them
+static const uint8_t dict_len[128] = {
+    5, 5, 5, 5, 5, 4, 4, 4, 4, 4, 4, 4, 4, 4, 3, 3,
+    3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 2,
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2};
+
+size_t text_compress(const uint8_t *in, size_t in_len, uint8_t *out,
+                     size_t out_max) {
+  if (!in || !out || in_len == 0)
+    return 0;
+
+  size_t idx = 0;
+  size_t pos = 0;
+  while (pos < in_len) {
+    // Longest dictionary entry matching at pos
+    int best = -1;
+    size_t best_len = 1;
+    for (int i = 0; i < 128; i++) {
+      size_t len = dict_len[i];
+      if (len > best_len && len <= in_len - pos &&
+          memcmp(&in[pos], dict[i], len) == 0) {
+        best = i;
+        best_len = len;
+      }
+    }
+
+    if (idx + 2 > out_max)
+      return 0;
+
+    if (best >= 0) {
+      out[idx++] = (uint8_t)(TEXT_CODEC_DICT_BASE + best);
+      pos += best_len;
+    } else if (in[pos] >= 0x20 && in[pos] < 0x7F) {
+      out[idx++] = in[pos++];
+    } else {
+      out[idx++] = TEXT_CODEC_ESCAPE;
+      out[idx++] = in[pos++];
+    }
+  }
+
+  return idx < in_len ? idx : 0;
+}
+
+int text_decompress(const uint8_t *in, size_t in_len, uint8_t *out,
+                    size_t out_max) {
+  if (!in || !out)
+    return -1;
+
+  size_t idx = 0;
+  for (size_t pos = 0; pos < in_len; pos++) {
+    uint8_t b = in[pos];
+
+    if (b >= TEXT_CODEC_DICT_BASE) {
+      uint8_t len = dict_len[b - TEXT_CODEC_DICT_BASE];
+      if (idx + len > out_max)
+        return -1;
+      memcpy(&out[idx], dict[b - TEXT_CODEC_DICT_BASE], len);
+      idx += len;
+      continue;
+    }
+
+    if (b == TEXT_CODEC_ESCAPE) {
+      if (++pos >= in_len)
+        return -1;
+      b = in[pos];
+    } else if (b < 0x20 || b == 0x7F) {
+      return -1;
+    }
+
+    if (idx >= out_max)
+      return -1;
+    out[idx++] = b;
+  }
+
+  return (int)idx;
+}
@@ -1,6 +1,8 @@
 #include "user_table.h"
 #include "constants.h"
 #include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include "nvs.h"
 #include "nvs_flash.h"
 #include <stdio.h>
@@ -11,7 +13,217 @@ static const char *NVS_NAMESPACE = "meshtalk";
 static const char *NVS_USER_COUNT_KEY = "user_count";
 static const char *NVS_USER_KEY_PREFIX = "user_";
 
+#define HASH_MASK (USER_TABLE_HASH_SIZE - 1)
+#define HASH_EMPTY 0xFFFF
+
+_Static_assert(USER_TABLE_HASH_SIZE >= 2 * MAX_USERS,
+               "user_table hash indices must stay at most half full");
+_Static_assert(MAX_USERS <= 256, "peer_id_t holds the index in 8 bits");
+
+// On-flash layout of one entry (key NVS_USER_KEY_PREFIX + table index)
+typedef struct {
+  char username[USERNAME_MAX_LEN];
+  uint16_t unicast_addr;
+  bool valid;
+} nvs_user_entry_t;
+
 user_t user_table[MAX_USERS] = {0};
+static int user_count = 0;
+static uint32_t use_clock = 0; // LRU clock, bumped on every touch
+static user_table_evict_cb_t evict_cb = NULL;
+static SemaphoreHandle_t table_mutex = NULL; // Recursive, see user_table.h
+
+// Hash indices: table index per slot, HASH_EMPTY if free
+static uint16_t addr_index[USER_TABLE_HASH_SIZE] = {
+    [0 ... USER_TABLE_HASH_SIZE - 1] = HASH_EMPTY};
+static uint16_t name_index[USER_TABLE_HASH_SIZE] = {
+    [0 ... USER_TABLE_HASH_SIZE - 1] = HASH_EMPTY};
+
+static uint32_t hash_mix(uint32_t h) {
+  return (h * 2654435761u) >> (32 - USER_TABLE_HASH_BITS);
+}
+
+static uint32_t addr_home(uint16_t addr) { return hash_mix(addr); }
+
+// FNV-1a over the whole string, so a longer lookup name never matches
+static uint32_t name_home(const char *name) {
+  uint32_t h = 2166136261u;
+  while (*name) {
+    h = (h ^ (uint8_t)*name++) * 16777619u;
+  }
+  return hash_mix(h);
+}
+
+static uint32_t entry_addr_home(int idx) {
+  return addr_home(user_table[idx].unicast_addr);
+}
+
+static uint32_t entry_name_home(int idx) {
+  return name_home(user_table[idx].username);
+}
+
+static void index_insert(uint16_t *index, uint32_t home, int idx) {
+  uint32_t i = home;
+  while (index[i] != HASH_EMPTY) {
+    i = (i + 1) & HASH_MASK;
+  }
+  index[i] = (uint16_t)idx;
+}
+
+// Remove idx (keyed as home_of(idx) says) by shifting the rest of its probe
+// cluster back, so lookups never need tombstones
+static void index_remove(uint16_t *index, uint32_t (*home_of)(int), int idx) {
+  uint32_t hole = home_of(idx);
+  while (index[hole] != idx) {
+    if (index[hole] == HASH_EMPTY)
+      return;
+    hole = (hole + 1) & HASH_MASK;
+  }
+
+  for (uint32_t i = (hole + 1) & HASH_MASK; index[i] != HASH_EMPTY;
+       i = (i + 1) & HASH_MASK) {
+    // An entry may fill the hole if the hole lies between its home and it
+    uint32_t home = home_of(index[i]);
+    if (((i - home) & HASH_MASK) >= ((i - hole) & HASH_MASK)) {
+      index[hole] = index[i];
+      hole = i;
+    }
+  }
+  index[hole] = HASH_EMPTY;
+}
+
+static void index_rebuild(void) {
+  memset(addr_index, 0xFF, sizeof(addr_index));
+  memset(name_index, 0xFF, sizeof(name_index));
+  for (int i = 0; i < user_count; i++) {
+    index_insert(addr_index, entry_addr_home(i), i);
+    index_insert(name_index, entry_name_home(i), i);
+  }
+}
+
+// Least recently seen entry (table full)
+static int lru_victim(void) {
+  int victim = 0;
+  for (int i = 1; i < user_count; i++) {
+    if (user_table[i].last_seen < user_table[victim].last_seen) {
+      victim = i;
+    }
+  }
+  return victim;
+}
+
+void user_table_init(void) {
+  if (!table_mutex)
+    table_mutex = xSemaphoreCreateRecursiveMutex();
+}
+
+void user_table_lock(void) {
+  if (table_mutex)
+    xSemaphoreTakeRecursive(table_mutex, portMAX_DELAY);
+}
+
+void user_table_unlock(void) {
+  if (table_mutex)
+    xSemaphoreGiveRecursive(table_mutex);
+}
+
+int user_table_count(void) { return user_count; }
+
+void user_table_register_evict_cb(user_table_evict_cb_t cb) { evict_cb = cb; }
+
+peer_id_t user_table_peer_id(int idx) {
+  peer_id_t peer = PEER_NONE;
+  user_table_lock();
+  if (idx >= 0 && idx < user_count)
+    peer = (peer_id_t)((user_table[idx].generation << 8) | idx);
+  user_table_unlock();
+  return peer;
+}
+
+int user_table_index_of(peer_id_t peer) {
+  int idx = peer & 0xFF;
+  user_table_lock();
+  // Generations start at 1, so PEER_NONE never matches
+  if (idx >= user_count || user_table[idx].generation != (peer >> 8))
+    idx = -1;
+  user_table_unlock();
+  return idx;
+}
+
+void user_table_touch(int idx) {
+  user_table_lock();
+  if (idx >= 0 && idx < user_count) {
+    user_table[idx].last_seen = ++use_clock;
+  }
+  user_table_unlock();
+}
+
+bool user_table_copy_name(int idx, char *out, size_t len) {
+  if (!out || len == 0)
+    return false;
+
+  user_table_lock();
+  bool found = idx >= 0 && idx < user_count;
+  if (found) {
+    snprintf(out, len, "%s", user_table[idx].username);
+  }
+  user_table_unlock();
+  return found;
+}
+
+// The directory has an NVS partition of its own: MAX_USERS entries take
+// about three NVS entries each, more than the default partition can spare
+static esp_err_t directory_nvs_open(nvs_open_mode_t mode,
+                                    nvs_handle_t *nvs_handle) {
+  return nvs_open_from_partition(USER_TABLE_NVS_PARTITION, NVS_NAMESPACE,
+                                 mode, nvs_handle);
+}
+
+// Copy of an entry as saved to NVS (call with the lock held)
+static void entry_snapshot(int idx, nvs_user_entry_t *entry) {
+  memcpy(entry->username, user_table[idx].username, USERNAME_MAX_LEN);
+  entry->unicast_addr = user_table[idx].unicast_addr;
+  entry->valid = user_table[idx].valid;
+}
+
+static esp_err_t save_entry(nvs_handle_t nvs_handle, int idx,
+                            const nvs_user_entry_t *entry) {
+  char key[16];
+  snprintf(key, sizeof(key), "%s%d", NVS_USER_KEY_PREFIX, idx);
+
+  esp_err_t err = nvs_set_blob(nvs_handle, key, entry, sizeof(*entry));
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "Error saving user %d: %s", idx, esp_err_to_name(err));
+  } else {
+    ESP_LOGD(TAG, "Saved user %s (0x%04X) to NVS", entry->username,
+             entry->unicast_addr);
+  }
+  return err;
+}
+
+// Write one entry (and the count) instead of the whole table. Takes a
+// snapshot so NVS is written without holding the table lock.
+static esp_err_t user_table_save_entry(int idx, const nvs_user_entry_t *entry,
+                                       int count) {
+  nvs_handle_t nvs_handle;
+  esp_err_t err = directory_nvs_open(NVS_READWRITE, &nvs_handle);
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "Error (%s) opening NVS handle", esp_err_to_name(err));
+    return err;
+  }
+
+  err = save_entry(nvs_handle, idx, entry);
+  if (err == ESP_OK)
+    err = nvs_set_i32(nvs_handle, NVS_USER_COUNT_KEY, count);
+  if (err == ESP_OK)
+    err = nvs_commit(nvs_handle);
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "Error saving user %d: %s", idx, esp_err_to_name(err));
+  }
+
+  nvs_close(nvs_handle);
+  return err;
+}
 
 // Save current user table to NVS
 esp_err_t user_table_save_to_nvs(void) {
@@ -19,60 +231,33 @@ esp_err_t user_table_save_to_nvs(void) {
   esp_err_t err;
 
   // Open NVS namespace
-  err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
+  err = directory_nvs_open(NVS_READWRITE, &nvs_handle);
   if (err != ESP_OK) {
     ESP_LOGE(TAG, "Error (%s) opening NVS handle", esp_err_to_name(err));
     return err;
   }
 
-  // Count valid users
-  int valid_count = 0;
-  for (int i = 0; i < MAX_USERS; i++) {
-    if (user_table[i].valid) {
-      valid_count++;
-    }
-  }
+  // Whole-table save is rare (not on the message path): hold the lock
+  user_table_lock();
 
   // Save user count
-  err = nvs_set_i32(nvs_handle, NVS_USER_COUNT_KEY, valid_count);
+  err = nvs_set_i32(nvs_handle, NVS_USER_COUNT_KEY, user_count);
   if (err != ESP_OK) {
     ESP_LOGE(TAG, "Error saving user count: %s", esp_err_to_name(err));
+    user_table_unlock();
     nvs_close(nvs_handle);
     return err;
   }
 
-  // Structure to save user data
-  typedef struct {
-    char username[USERNAME_MAX_LEN];
-    uint16_t unicast_addr;
-    bool valid;
-  } nvs_user_entry_t;
-
-  // Save each valid user
+  // Entries are contiguous, so key i is table index i
   int saved_count = 0;
-  for (int i = 0; i < MAX_USERS && saved_count < valid_count; i++) {
-    if (user_table[i].valid) {
-      char key[32];
-      snprintf(key, sizeof(key), "%s%d", NVS_USER_KEY_PREFIX, saved_count);
-
-      nvs_user_entry_t entry;
-      strncpy(entry.username, user_table[i].username, USERNAME_MAX_LEN);
-      entry.username[USERNAME_MAX_LEN - 1] = '\0';
-      entry.unicast_addr = user_table[i].unicast_addr;
-      entry.valid = user_table[i].valid;
-
-      size_t required_size = sizeof(nvs_user_entry_t);
-      err = nvs_set_blob(nvs_handle, key, &entry, required_size);
-      if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error saving user %d: %s", saved_count,
-                 esp_err_to_name(err));
-      } else {
-        ESP_LOGD(TAG, "Saved user %s (0x%04X) to NVS", entry.username,
-                 entry.unicast_addr);
-      }
-      saved_count++;
-    }
+  for (int i = 0; i < user_count; i++) {
+    nvs_user_entry_t entry;
+    entry_snapshot(i, &entry);
+    save_entry(nvs_handle, i, &entry);
+    saved_count++;
   }
+  user_table_unlock();
 
   // Commit changes
   err = nvs_commit(nvs_handle);
@@ -92,7 +277,7 @@ esp_err_t user_table_load_from_nvs(void) {
   esp_err_t err;
 
   // Open NVS namespace
-  err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs_handle);
+  err = directory_nvs_open(NVS_READONLY, &nvs_handle);
   if (err != ESP_OK) {
     ESP_LOGI(TAG, "No existing user data found in NVS: %s",
              esp_err_to_name(err));
@@ -100,43 +285,40 @@ esp_err_t user_table_load_from_nvs(void) {
   }
 
   // Get user count
-  int32_t user_count = 0;
-  err = nvs_get_i32(nvs_handle, NVS_USER_COUNT_KEY, &user_count);
-  if (err != ESP_OK || user_count <= 0) {
+  int32_t stored_count = 0;
+  err = nvs_get_i32(nvs_handle, NVS_USER_COUNT_KEY, &stored_count);
+  if (err != ESP_OK || stored_count <= 0) {
     ESP_LOGI(TAG, "No users found in NVS");
     nvs_close(nvs_handle);
     return err;
   }
 
-  ESP_LOGI(TAG, "Loading %d users from NVS", (int)user_count);
+  ESP_LOGI(TAG, "Loading %d users from NVS", (int)stored_count);
 
   // Clear current user table
+  user_table_lock();
   memset(user_table, 0, sizeof(user_table));
-
-  // Structure to load user data
-  typedef struct {
-    char username[USERNAME_MAX_LEN];
-    uint16_t unicast_addr;
-    bool valid;
-  } nvs_user_entry_t;
+  user_count = 0;
 
   // Load each user
   int loaded_count = 0;
-  for (int i = 0; i < user_count && loaded_count < MAX_USERS; i++) {
-    char key[32];
+  for (int i = 0; i < stored_count && loaded_count < MAX_USERS; i++) {
+    char key[16];
     snprintf(key, sizeof(key), "%s%d", NVS_USER_KEY_PREFIX, i);
 
     nvs_user_entry_t entry;
     size_t required_size = sizeof(nvs_user_entry_t);
 
     err = nvs_get_blob(nvs_handle, key, &entry, &required_size);
-    if (err == ESP_OK && loaded_count < MAX_USERS) {
-      // Add user to table
-      user_table[loaded_count].valid = true;
-      user_table[loaded_count].unicast_addr = entry.unicast_addr;
-      strncpy(user_table[loaded_count].username, entry.username,
-              USERNAME_MAX_LEN);
-      user_table[loaded_count].username[USERNAME_MAX_LEN - 1] = '\0';
+    if (err == ESP_OK) {
+      // Add user to table; older keys count as less recently seen
+      user_t *user = &user_table[loaded_count];
+      user->valid = true;
+      user->unicast_addr = entry.unicast_addr;
+      memcpy(user->username, entry.username, USERNAME_MAX_LEN);
+      user->username[USERNAME_MAX_LEN - 1] = '\0';
+      user->last_seen = ++use_clock;
+      user->generation = 1;
 
       ESP_LOGD(TAG, "Loaded user %s (0x%04X) from NVS at index %d",
                entry.username, entry.unicast_addr, loaded_count);
@@ -147,6 +329,9 @@ esp_err_t user_table_load_from_nvs(void) {
   }
 
   nvs_close(nvs_handle);
+  user_count = loaded_count;
+  index_rebuild();
+  user_table_unlock();
   ESP_LOGI(TAG, "Successfully loaded %d users from persistent storage",
            loaded_count);
   return ESP_OK;
@@ -154,11 +339,15 @@ esp_err_t user_table_load_from_nvs(void) {
 
 // Clear user table (both RAM and NVS)
 void user_table_clear(void) {
+  user_table_lock();
   memset(user_table, 0, sizeof(user_table));
+  user_count = 0;
+  index_rebuild();
+  user_table_unlock();
 
   // Clear NVS data
   nvs_handle_t nvs_handle;
-  esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
+  esp_err_t err = directory_nvs_open(NVS_READWRITE, &nvs_handle);
   if (err == ESP_OK) {
     nvs_erase_all(nvs_handle);
     nvs_commit(nvs_handle);
@@ -167,97 +356,128 @@ void user_table_clear(void) {
   }
 }
 
-// Modified user_table_set with NVS persistence
+// Add or rename a user, evicting the least recently seen one if full
 bool user_table_set(const char *username, uint16_t unicast_addr) {
   if (!username || strlen(username) == 0) {
     ESP_LOGW(TAG, "Invalid username provided");
     return false;
   }
 
+  nvs_user_entry_t entry;
+  int count;
+
+  user_table_lock();
+
   // Check if address already exists -> update if name is different
-  for (int i = 0; i < MAX_USERS; i++) {
-    if (user_table[i].valid && user_table[i].unicast_addr == unicast_addr) {
-      // If name is different, update it
-      if (strncmp(user_table[i].username, username, USERNAME_MAX_LEN) != 0) {
-        strncpy(user_table[i].username, username, USERNAME_MAX_LEN - 1);
-        user_table[i].username[USERNAME_MAX_LEN - 1] = '\0';
-        ESP_LOGI(TAG, "Updated user at index %d: %s (0x%04X)", i, username,
-                 unicast_addr);
-
-        // Save to NVS
-        user_table_save_to_nvs();
-      }
-      return true; // Address already exists (updated if needed)
+  int i = user_table_find_index_by_addr(unicast_addr);
+  if (i >= 0) {
+    user_table_touch(i);
+    if (strncmp(user_table[i].username, username, USERNAME_MAX_LEN - 1) == 0) {
+      user_table_unlock();
+      return true; // Address already exists, nothing to save
     }
+    index_remove(name_index, entry_name_home, i);
+    strncpy(user_table[i].username, username, USERNAME_MAX_LEN - 1);
+    user_table[i].username[USERNAME_MAX_LEN - 1] = '\0';
+    index_insert(name_index, entry_name_home(i), i);
+    entry_snapshot(i, &entry);
+    count = user_count;
+    user_table_unlock();
+    ESP_LOGI(TAG, "Updated user at index %d: %s (0x%04X)", i, username,
+             unicast_addr);
+
+    // Save to NVS
+    user_table_save_entry(i, &entry, count);
+    return true;
   }
 
-  // Otherwise add a new entry
-  for (int i = 0; i < MAX_USERS; i++) {
-    if (!user_table[i].valid) {
-      user_table[i].valid = true;
-      user_table[i].unicast_addr = unicast_addr;
-      strncpy(user_table[i].username, username, USERNAME_MAX_LEN - 1);
-      user_table[i].username[USERNAME_MAX_LEN - 1] = '\0';
-      ESP_LOGI(TAG, "Added new user at index %d: %s (0x%04X)", i, username,
-               unicast_addr);
-
-      // Save to NVS
-      user_table_save_to_nvs();
-      return true;
-    }
+  // Otherwise take the next free entry, or the least recently seen one
+  if (user_count < MAX_USERS) {
+    i = user_count++;
+  } else {
+    i = lru_victim();
+    ESP_LOGI(TAG, "User table full, evicting %s (0x%04X) for %s",
+             user_table[i].username, user_table[i].unicast_addr, username);
+    if (evict_cb)
+      evict_cb(user_table_peer_id(i));
+    index_remove(addr_index, entry_addr_home, i);
+    index_remove(name_index, entry_name_home, i);
   }
 
-  // Table full
-  ESP_LOGW(TAG, "User table full, cannot add %s", username);
-  return false;
+  // New handle for the entry: ones of an evicted peer stop resolving
+  user_table[i].generation = (user_table[i].generation == 0xFF)
+                                 ? 1
+                                 : user_table[i].generation + 1;
+  user_table[i].valid = true;
+  user_table[i].unicast_addr = unicast_addr;
+  user_table[i].phrasebook = 0;
+  strncpy(user_table[i].username, username, USERNAME_MAX_LEN - 1);
+  user_table[i].username[USERNAME_MAX_LEN - 1] = '\0';
+  index_insert(addr_index, entry_addr_home(i), i);
+  index_insert(name_index, entry_name_home(i), i);
+  user_table_touch(i);
+  entry_snapshot(i, &entry);
+  count = user_count;
+  user_table_unlock();
+  ESP_LOGI(TAG, "Added new user at index %d: %s (0x%04X)", i, username,
+           unicast_addr);
+
+  // Save to NVS
+  user_table_save_entry(i, &entry, count);
+  return true;
 }
 
 uint16_t user_table_get_addr(const char *username) {
-  for (int i = 0; i < MAX_USERS; i++) {
-    if (user_table[i].valid && strncmp(user_table[i].username, username,
-                                       sizeof(user_table[i].username)) == 0) {
-      return user_table[i].unicast_addr;
-    }
-  }
-  return 0; // Not found
+  user_table_lock();
+  int i = user_table_find_index_by_name(username);
+  uint16_t addr = (i >= 0) ? user_table[i].unicast_addr : 0; // 0 = not found
+  user_table_unlock();
+  return addr;
 }
 
 const char *user_table_get_name(uint16_t unicast_addr) {
-  for (int i = 0; i < MAX_USERS; i++) {
-    if (user_table[i].valid && user_table[i].unicast_addr == unicast_addr) {
-      return user_table[i].username;
-    }
-  }
-  return NULL; // Not found
+  int i = user_table_find_index_by_addr(unicast_addr);
+  return (i >= 0) ? user_table[i].username : NULL;
 }
 
 void user_table_print(void) {
   printf("=== User Table ===\n");
-  for (int i = 0; i < MAX_USERS; i++) {
-    if (user_table[i].valid) {
-      printf("Name: %s | Addr: 0x%04X\n", user_table[i].username,
-             user_table[i].unicast_addr);
-    }
+  user_table_lock();
+  for (int i = 0; i < user_count; i++) {
+    printf("Name: %s | Addr: 0x%04X\n", user_table[i].username,
+           user_table[i].unicast_addr);
   }
+  user_table_unlock();
 }
 
 int user_table_find_index_by_addr(uint16_t addr) {
-  for (int i = 0; i < MAX_USERS; i++) {
-    if (user_table[i].valid && user_table[i].unicast_addr == addr) {
-      return i;
+  int found = -1;
+  user_table_lock();
+  // The index is at most half full, so every probe ends at an empty slot
+  for (uint32_t h = addr_home(addr); addr_index[h] != HASH_EMPTY;
+       h = (h + 1) & HASH_MASK) {
+    if (user_table[addr_index[h]].unicast_addr == addr) {
+      found = addr_index[h];
+      break;
     }
   }
-  return -1; // not found
+  user_table_unlock();
+  return found;
 }
 
 int user_table_find_index_by_name(const char *username) {
   if (!username)
     return -1;
 
-  for (int i = 0; i < MAX_USERS; i++) {
-    if (user_table[i].valid && strcmp(user_table[i].username, username) == 0) {
-      return i;
+  int found = -1;
+  user_table_lock();
+  for (uint32_t h = name_home(username); name_index[h] != HASH_EMPTY;
+       h = (h + 1) & HASH_MASK) {
+    if (strcmp(user_table[name_index[h]].username, username) == 0) {
+      found = name_index[h];
+      break;
     }
   }
-  return -1; // not found
+  user_table_unlock();
+  return found;
 }
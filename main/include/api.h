@@ -1,27 +1,67 @@
 #pragma once
 
+#include "chat_log.h"
 #include "message_struct.h"
+#include "types_common.h"
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
+// Peers are passed around as peer_id_t handles (see user_table.h); names
+// are only looked up to render them, with api_get_peer_name().
+
 // Callback type for UI to receive messages
-typedef void (*ui_receive_cb_t)(const char *sender_name, const char *msg);
+typedef void (*ui_receive_cb_t)(peer_id_t sender, const char *msg);
+
+// Callback type for UI to learn about delivery state changes
+typedef void (*ui_delivery_cb_t)(peer_id_t receiver, delivery_state_t state);
 
 // Initialize API and register UI callback
 void api_init(ui_receive_cb_t cb);
 
+// Register UI callback for delivery state changes of sent messages
+void api_register_delivery_cb(ui_delivery_cb_t cb);
+
+// Restore the chat logs of known users from the chat store (at boot)
+void api_load_chat_history(void);
+
 // UI → API → Handler
-void api_send_text(const char *receiver_id, const char *msg);
+// Returns 0 when the message was queued, negative if it could not be sent
+int api_send_text(peer_id_t receiver, const char *msg);
 
-void api_on_message_received(const MeshMessage *m);
+// Handler → API: zero-copy view of a received frame
+void api_on_message_view(const MeshMessageView *v);
 
 void api_broadcast_addr(void);
 
-int api_get_contact_names(char names[][USERNAME_MAX_LEN], int max_contacts);
+// Contacts by stable index (0 .. api_get_contact_count() - 1, the same index
+// app_state uses for new message flags), for windowed lists
+int api_get_contact_count(void);
+bool api_get_contact_name(int contact_idx, char *name,
+                          size_t len);           // false if out of range
+peer_id_t api_get_contact_peer(int contact_idx); // PEER_NONE if out of range
+
+// Name of a peer, false once the peer was evicted from the directory. Names
+// are copied out: the RX task may rename or evict the peer meanwhile.
+bool api_get_peer_name(peer_id_t peer, char *name, size_t len);
+
+// Open a read cursor on a peer's chat log, walked with chat_log_iter_next().
+// Entries point into the log; check chat_log_iter_valid() after reading.
+// Returns false (empty cursor) for a stale handle.
+bool api_chat_iter_begin(peer_id_t peer, chat_log_iter_t *it);
+
+// Chat log generation: read it before reading lines or entries, and check
+// with api_chat_unchanged() afterwards that no append overwrote them
+uint32_t api_get_chat_generation(void);
+bool api_chat_unchanged(uint32_t gen);
+
+// Number of word-wrapped lines in a peer's chat log
+int api_get_chat_line_count(peer_id_t peer);
+
+// Lines dropped from the front of a peer's chat log (see chat_log.h)
+uint32_t api_get_chat_evicted_lines(peer_id_t peer);
 
-// Get chat log of a user by name
-// out_buf: 2D array to store messages
-// max_msgs: maximum messages to copy
-// Returns the number of messages copied
-int api_get_chat_log(const char *username, char out_buf[][MAX_MESSAGE_LEN + 1],
-                     int max_msgs);
+// Get a window of word-wrapped chat lines, starting at line index first
+// (0 = oldest). Lines point into the chat log. Returns the number of lines.
+int api_get_chat_lines(peer_id_t peer, int first, chat_log_line_t out[],
+                       int max_lines);
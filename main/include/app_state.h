@@ -10,8 +10,8 @@
  */
 typedef struct {
   screen_t current_screen;
-  char selected_user[USERNAME_MAX_LEN];
-  bool new_message_flags[MAX_USERS];
+  peer_id_t selected_peer;           // Open conversation, PEER_NONE if none
+  bool new_message_flags[MAX_USERS]; // By user_table index
 } app_state_t;
 
 // Global instance (defined in app_state.c)
@@ -28,14 +28,17 @@ screen_t app_state_get_screen(void);
 // Set current screen
 void app_state_set_screen(screen_t screen);
 
-// Get selected user
-const char *app_state_get_selected_user(void);
+// Get selected peer
+peer_id_t app_state_get_selected_peer(void);
 
-// Set selected user
-void app_state_set_selected_user(const char *username);
+// Set selected peer
+void app_state_set_selected_peer(peer_id_t peer);
 
-// Get unread message flag
-bool app_state_has_new_message(int user_idx);
+// Get unread message flag (false for a stale handle)
+bool app_state_has_new_message(peer_id_t peer);
+
+// Set unread flag
+void app_state_set_new_message(peer_id_t peer);
 
 // Clear unread flag
-void app_state_clear_new_message(int user_idx);
+void app_state_clear_new_message(peer_id_t peer);
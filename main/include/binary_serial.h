@@ -7,6 +7,129 @@
 #define MAX_SERIALIZED_SIZE                                                    \
   (1 + 8 + USERNAME_MAX_LEN + 2 + 1 + MAX_PAYLOAD_SIZE)
 
+/*
+ * v2 wire format (all multi-byte integers are LEB128 varints):
+ *
+ *   [hdr][msg_id?][ts_age?][name_len name?][payload_len][payload]
+ *
+ * hdr bit 7 is always set, which tells v2 frames apart from v1 frames (whose
+ * first byte is the message type, 1 or 2). Bits 2..0 carry the message type
+ * and bits 6..3 are presence flags for the optional fields. The sender
+ * address is not carried: the mesh network header already has it.
+ * msg_id always directly follows hdr so it can be read without a full parse.
+ */
+#define MSG_V2_MARKER 0x80
+#define MSG_V2_FLAG_TS 0x08   // ts_age present (ms between creation and TX)
+#define MSG_V2_FLAG_NAME 0x10 // sender name present
+#define MSG_V2_FLAG_ID 0x20   // msg_id present (sender expects an ACK)
+#define MSG_V2_FLAG_COMP 0x40 // payload compressed with text_compress()
+#define MSG_V2_TYPE_MASK 0x07
+
+/*
+ * Batch frame (several v2 frames for the same destination in one SDU):
+ *
+ *   [MSG_BATCH_HEADER]([record_len][record])...
+ *
+ * Each record is a complete v2 frame without CRC; one CRC covers the batch.
+ */
+#define MSG_BATCH_HEADER (MSG_V2_MARKER | MSG_TYPE_BATCH)
+#define MSG_BATCH_RECORD_OVERHEAD 2 // record_len varint (records < 16 KiB)
+
+#define MSG_V2_MAX_HEADER_SIZE (1 + 1 + 5 + 1 + USERNAME_MAX_LEN + 2)
+
+// Largest access payload that goes out as one unsegmented PDU (incl. opcode)
+#define MESH_UNSEG_ACCESS_MAX 11
+// Upper transport bytes carried by each segment of a segmented message
+#define MESH_SEG_PAYLOAD_SIZE 12
+#define MESH_TRANS_MIC_SIZE 4
+#define MESH_VENDOR_OPCODE_SIZE 3
+
+/**
+ * @brief Length of a string field that need not be null-terminated.
+ *
+ * Reads at most max_len bytes (strnlen is POSIX, not C11).
+ *
+ * @return Bytes before the first '\0', or max_len if there is none.
+ */
+size_t field_len(const char *field, size_t max_len);
+
 int serialize_message(const MeshMessage *msg, uint8_t *out_buf,
                       size_t *out_len);
-int deserialize_message(const uint8_t *in_buf, size_t in_len, MeshMessage *msg);
+
+/**
+ * @brief Serialize a message using the compact v2 encoding.
+ *
+ * The name is only written when msg->sender_name is non-empty, the msg_id
+ * only when non-zero, and the timestamp only when it is older than 1 ms
+ * relative to now_us. Text payloads are compressed when that saves bytes.
+ *
+ * @param msg     Message to encode.
+ * @param now_us  Current esp_timer time, used to encode the timestamp age.
+ * @param out_buf Output buffer (at least MSG_V2_MAX_HEADER_SIZE + payload).
+ * @param out_len Number of bytes written.
+ * @return 0 on success, negative on error.
+ */
+int serialize_message_v2(const MeshMessage *msg, int64_t now_us,
+                         uint8_t *out_buf, size_t *out_len);
+
+/**
+ * @brief Deserialize a v1 or v2 frame (CRC already stripped).
+ *
+ * For v2 frames the timestamp is rebased onto the local clock using now_us
+ * and msg->addr is left at 0 for the caller to fill from the mesh context.
+ * Compressed payloads are expanded.
+ */
+int deserialize_message(const uint8_t *in_buf, size_t in_len, int64_t now_us,
+                        MeshMessage *msg);
+
+/**
+ * @brief Parse a v1 or v2 frame (CRC already stripped) without copying.
+ *
+ * The resulting view points into in_buf; see deserialize_message() for how
+ * the timestamp and address are filled. A compressed payload is left as is
+ * with view->compressed set, expand it with deserialize_view_payload().
+ */
+int deserialize_message_view(const uint8_t *in_buf, size_t in_len,
+                             int64_t now_us, MeshMessageView *view);
+
+/**
+ * @brief Expand a compressed view payload into buf (MAX_PAYLOAD_SIZE bytes)
+ * and point the view at it. No-op for uncompressed views.
+ *
+ * @return 0 on success, negative if the payload is malformed.
+ */
+int deserialize_view_payload(MeshMessageView *view, uint8_t *buf);
+
+/**
+ * @brief Read the type and msg_id of a frame without deserializing it.
+ *
+ * @param type Set to the message type (may be NULL).
+ * @return msg_id, or 0 for v1 frames and frames without an id.
+ */
+uint8_t frame_peek_msg_id(const uint8_t *in_buf, size_t in_len,
+                          uint8_t *type);
+
+/**
+ * @brief Append one record (a v2 frame without CRC) to a batch frame.
+ *
+ * @return Bytes written to out_buf (record_len + length prefix), 0 on error.
+ */
+size_t serialize_batch_record(const uint8_t *record, size_t record_len,
+                              uint8_t *out_buf);
+
+/**
+ * @brief Iterate over the records of a batch frame (CRC already stripped).
+ *
+ * Start with *offset = 0; record points into in_buf.
+ *
+ * @return 1 when a record was returned, 0 at the end, negative if malformed.
+ */
+int deserialize_batch_record(const uint8_t *in_buf, size_t in_len,
+                             size_t *offset, const uint8_t **record,
+                             size_t *record_len);
+
+/**
+ * @brief Number of lower transport PDUs needed to send a frame of frame_len
+ * bytes with a 3-byte vendor opcode (1 means unsegmented).
+ */
+size_t mesh_frame_segment_count(size_t frame_len);
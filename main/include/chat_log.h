@@ -1,36 +1,172 @@
 #pragma once
 
+#include "types_common.h"
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
-#define MAX_CHAT_PER_USER 6
 #define MAX_MESSAGE_LEN 64
 
+/*
+ * All conversations share one ring arena of CHAT_LOG_ARENA_SIZE bytes.
+ * A message is a variable-length record:
+ *
+ *   [next][user][len][msg_id][state][line_count][flags][spans][text\0]
+ *
+ * Conversations are addressed by peer handle; records keep the user_table
+ * index. Records of a user are linked oldest to newest through next. When
+ * the arena is full the oldest record overall is evicted, so an idle
+ * contact gives its space to the active ones.
+ *
+ * Readers get pointers into the arena instead of copies. Writers are
+ * serialized and bump a generation counter (odd while a change is in
+ * progress), so a reader can tell afterwards whether what it read may have
+ * been overwritten, and read again. Writers hold user_table_lock() from
+ * resolving the handle until the change is done, so the peer cannot be
+ * evicted in between.
+ */
+#define CHAT_LOG_ARENA_SIZE 1536
+#define CHAT_LOG_NONE 0xFFFF // End of a record list
+
+// Messages per user restored from the chat store at boot
+#define MAX_CHAT_PER_USER 6
+
+// Messages are word-wrapped once, when stored, to the chat screen width:
+// MAX_CHARS_PER_LINE minus the 2-column list indent.
+#define CHAT_LOG_WRAP_WIDTH 19
+#define CHAT_LOG_MAX_LINES 8   // Wrapped lines kept per message
+#define CHAT_LOG_MARKER_WIDTH 2 // " x" delivery marker after outgoing text
+
+// One wrapped line of a stored message
 typedef struct {
-  char messages[MAX_CHAT_PER_USER][MAX_MESSAGE_LEN + 1]; // Last 5 messages
-  int head;  // Points to the next slot to write (circular buffer)
-  int count; // Number of messages stored (<= MAX_CHAT_PER_USER)
+  uint8_t start; // Offset into the message
+  uint8_t len;
+} chat_log_span_t;
+
+typedef struct {
+  uint16_t first; // Arena offset of the oldest record (CHAT_LOG_NONE: empty)
+  uint16_t last;  // Arena offset of the newest record
+  uint16_t count;       // Number of messages stored
+  uint16_t total_lines; // Sum of the wrapped lines of the stored messages
+  uint32_t evicted_lines; // Lines of messages dropped from the log so far
 } user_chat_log_t;
 
+// A message as returned by chat_log_iter_next(), pointing into the arena
+typedef struct {
+  const char *text; // Null-terminated
+  uint8_t len;
+  const chat_log_span_t *lines; // Cached word-wrap layout
+  uint8_t line_count;
+  delivery_state_t state;
+} chat_log_entry_t;
+
+// Read cursor over the messages of one user, oldest first
+typedef struct {
+  uint16_t next; // Arena offset of the next record
+  uint32_t gen;  // Generation the cursor was opened at
+} chat_log_iter_t;
+
+// A wrapped line as returned by chat_log_get_lines()
+typedef struct {
+  const char *text; // Points into the log entry, not null-terminated
+  uint8_t len;
+  bool last;              // Last line of its message
+  delivery_state_t state; // Delivery state of the message
+} chat_log_line_t;
+
 /**
- * Initialize chat log (clear all entries)
+ * Initialize chat log (clear all entries and create the writer lock)
  */
 void chat_log_init(void);
 
 /**
- * Store a new chat message for a user index
- * @param user_idx Index in user_table
+ * Drop all messages of a peer (its user_table entry is being reassigned)
+ */
+void chat_log_clear_peer(peer_id_t peer);
+
+/**
+ * Store a new chat message for a peer
+ * @param peer     Peer handle (stale handles are ignored)
+ * @param msg      Message string (null-terminated)
+ */
+void chat_log_add(peer_id_t peer, const char *msg, bool outgoing);
+
+/**
+ * Store a new chat message of known length (need not be null-terminated)
+ * @param peer     Peer handle
+ * @param msg      Message bytes
+ * @param len      Number of bytes in msg
+ * @return Pointer to the stored (null-terminated) entry, valid until the
+ *         entry is evicted; NULL on error
+ */
+const char *chat_log_add_n(peer_id_t peer, const char *msg, size_t len,
+                           bool outgoing);
+
+/**
+ * Store an outgoing message tracked for delivery (state DELIVERY_QUEUED)
+ * @param peer     Peer handle
  * @param msg      Message string (null-terminated)
+ * @param msg_id   Id the message is sent with
+ */
+void chat_log_add_outgoing(peer_id_t peer, const char *msg, uint8_t msg_id);
+
+/**
+ * Update the delivery state of an outgoing message
+ * @return true if the message is still in the log
+ */
+bool chat_log_set_delivery(peer_id_t peer, uint8_t msg_id,
+                           delivery_state_t state);
+
+/**
+ * Current log generation, to be checked with chat_log_unchanged()
+ */
+uint32_t chat_log_generation(void);
+
+/**
+ * Whether the log is unchanged since chat_log_generation() returned gen
+ * @return true if everything read from the log since then is consistent
+ */
+bool chat_log_unchanged(uint32_t gen);
+
+/**
+ * Open a read cursor on a user's messages
+ * @param peer     Peer handle
+ * @param it       Cursor to initialize (empty for an invalid index)
+ */
+void chat_log_iter_begin(peer_id_t peer, chat_log_iter_t *it);
+
+/**
+ * Advance a cursor
+ * @param out Next message, pointing into the log
+ * @return false at the end of the log
+ */
+bool chat_log_iter_next(chat_log_iter_t *it, chat_log_entry_t *out);
+
+/**
+ * Whether the messages returned by a cursor are still valid
+ * @return false if the log changed since chat_log_iter_begin()
+ */
+bool chat_log_iter_valid(const chat_log_iter_t *it);
+
+/**
+ * Number of wrapped lines over all stored messages of a user
+ */
+int chat_log_line_count(peer_id_t peer);
+
+/**
+ * Number of wrapped lines dropped from the front of a user's log so far.
+ * Adding it to a line index gives a number that stays stable as old
+ * messages are overwritten.
  */
-void chat_log_add(int user_idx, const char *msg, bool outgoing);
+uint32_t chat_log_evicted_lines(peer_id_t peer);
 
 /**
- * Retrieve all stored chat messages for a user index
- * @param user_idx Index in user_table
- * @param out_buf  Array of strings to copy messages into
- * @param max_msgs Maximum number of messages out_buf can hold
- * @return Number of messages copied
+ * Retrieve a window of wrapped lines, oldest first, from the cached layout
+ * @param peer      Peer handle
+ * @param first     Index of the first line (0 = oldest line in the log)
+ * @param out       Lines, pointing into the log (check with chat_log_unchanged)
+ * @param max_lines Maximum number of lines out can hold
+ * @return Number of lines returned
  */
-int chat_log_get(int user_idx, char out_buf[][MAX_MESSAGE_LEN + 1],
-                 int max_msgs);
+int chat_log_get_lines(peer_id_t peer, int first, chat_log_line_t out[],
+                       int max_lines);
@@ -0,0 +1,145 @@
+#pragma once
+
+#include "constants.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Persistent chat history on the "chatlog" data partition.
+ *
+ * The store reaches flash only through a chat_store_flash_t, so the same
+ * code runs on the partition (chat_store_partition_flash()) and on a file
+ * in the host tests. Appends from the UI and RX tasks are queued and
+ * written by a low-priority store task (chat_store_append_async()): an
+ * erase stalls for tens of milliseconds and must not block either of them.
+ *
+ * The partition is a circular log of CHAT_STORE_SEGMENT_SIZE segments (one
+ * flash sector each). A segment starts with a header carrying a sequence
+ * number and is filled with variable-length records:
+ *
+ *   [crc16][peer][seq][len][flags][text]  padded to 4 bytes
+ *
+ * crc16 covers the rest of the record. seq numbers the messages of one
+ * conversation (peer unicast address) from 1, so a page is a seq range.
+ * Segments are reused round-robin, which spreads erases evenly. Only the
+ * newest CHAT_STORE_SEGMENTS - 1 segments are live; the next one is always
+ * free to open.
+ *
+ * Before the oldest segment is dropped it is compacted: a conversation whose
+ * remaining history lives only there keeps its newest CHAT_STORE_KEEP
+ * messages, copied forward in order. The copy is idempotent and simply
+ * redone at mount if power was lost halfway.
+ *
+ * A torn record (bad CRC) ends the scan of its segment at mount; if that is
+ * the newest segment, it is sealed and appends continue in the next one.
+ */
+#define CHAT_STORE_PARTITION "chatlog"
+#define CHAT_STORE_SEGMENT_SIZE 4096
+#define CHAT_STORE_MAX_CONVS MAX_USERS // Conversations indexed in RAM
+#define CHAT_STORE_KEEP 6              // Messages compaction keeps per conversation
+
+#define CHAT_STORE_QUEUE_LEN 8 // Appends waiting for the store task
+#define CHAT_STORE_TASK_STACK_SIZE 3072
+#define CHAT_STORE_TASK_PRIORITY 2 // Below the UI, RX, TX and display tasks
+
+/*
+ * Flash the store lives on. Addresses are offsets from its start; erase is
+ * called with whole CHAT_STORE_SEGMENT_SIZE segments. Like NOR flash, a
+ * write may only clear bits of erased (0xFF) bytes. The functions return 0
+ * on success, negative on error.
+ */
+typedef struct {
+  int (*read)(void *ctx, size_t addr, void *buf, size_t len);
+  int (*write)(void *ctx, size_t addr, const void *buf, size_t len);
+  int (*erase)(void *ctx, size_t addr, size_t len);
+  size_t size; // Bytes available
+  void *ctx;   // Passed to every call
+} chat_store_flash_t;
+
+typedef struct {
+  uint32_t seq; // Message number within the conversation
+  bool outgoing;
+  uint8_t len;
+  char text[MAX_MESSAGE_LEN + 1];
+} chat_store_msg_t;
+
+// Flash cost of the store since mount
+typedef struct {
+  uint32_t appends;       // Records written by chat_store_append()
+  uint32_t copied;        // Records copied forward by compaction
+  uint32_t erases;        // Segments erased
+  uint32_t bytes_written; // Record and header bytes programmed
+} chat_store_stats_t;
+
+/**
+ * @brief Flash ops of the "chatlog" partition.
+ *
+ * @return NULL if the partition table has no such partition.
+ */
+const chat_store_flash_t *chat_store_partition_flash(void);
+
+/*
+ * The functions below are not thread-safe. Mount and read the history
+ * before chat_store_task_init(); after that the store task writes, and
+ * anyone else calls them between chat_store_lock() and chat_store_unlock().
+ */
+
+/**
+ * @brief Mount the store: find the live segments, rebuild the conversation
+ * index and recover from an interrupted write or compaction.
+ *
+ * @param flash Flash to use, kept by the store (NULL: not persisted).
+ * @return 0 on success, negative if flash is missing or too small.
+ */
+int chat_store_init(const chat_store_flash_t *flash);
+
+/**
+ * @brief Append a message to the conversation with peer, writing it to
+ * flash before returning. Use chat_store_append_async() from other tasks.
+ *
+ * @return 0 on success, negative on error (not mounted, flash error, or
+ * the conversation index is full).
+ */
+int chat_store_append(uint16_t peer, bool outgoing, const char *text,
+                      size_t len);
+
+/**
+ * @brief Number of messages stored for peer.
+ */
+uint32_t chat_store_count(uint16_t peer);
+
+/**
+ * @brief Read one page of a conversation, oldest message first.
+ *
+ * Page 0 holds the newest page_size messages, page 1 the ones before, and
+ * so on. Messages lost to reclaimed segments leave a page short.
+ *
+ * @return Number of messages written to out (at most page_size).
+ */
+int chat_store_read_page(uint16_t peer, uint32_t page, chat_store_msg_t *out,
+                         int page_size);
+
+void chat_store_get_stats(chat_store_stats_t *out);
+
+/**
+ * @brief Create the store queue, lock and task. Call after
+ * chat_store_init() succeeded.
+ */
+void chat_store_task_init(void);
+
+/**
+ * @brief Queue a message for the store task to append; text is copied.
+ *
+ * @return 0 if queued, negative if the store is not running or the queue
+ * is full (the message is then not persisted).
+ */
+int chat_store_append_async(uint16_t peer, bool outgoing, const char *text,
+                            size_t len);
+
+/**
+ * @brief Hold off the store task to call the functions above. Recursive;
+ * no-ops before chat_store_task_init().
+ */
+void chat_store_lock(void);
+void chat_store_unlock(void);
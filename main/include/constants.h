@@ -2,7 +2,13 @@
 
 #define SYMBOL_NEW_MESSAGE "*"
 
+// Delivery state markers appended to outgoing chat lines
+#define SYMBOL_DELIVERY_QUEUED "."
+#define SYMBOL_DELIVERY_SENT ">"
+#define SYMBOL_DELIVERY_ACKED "+"
+#define SYMBOL_DELIVERY_FAILED "!"
+
 // Misc
-#define MAX_USERS 3 // Max number of known users in the chat
+#define MAX_USERS 256 // Max number of known users (user_table directory)
 #define USERNAME_MAX_LEN 10
 #define MAX_MESSAGE_LEN 64 // Maximum length of a single message
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Time-decaying duplicate filter keyed on (source address, key). The key
+ * is the msg id of frames that carry one; frames without an id
+ * (broadcasts, v1 frames) use DEDUP_KEY_CONTENT | the CRC16 of their
+ * bytes, so a relayed copy is caught but the same content sent again
+ * within the window is dropped too.
+ *
+ * Two Bloom filter generations of DEDUP_FILTER_BITS bits each: inserts go
+ * into the current one, lookups test both, and every DEDUP_WINDOW_MS the
+ * older generation is cleared and becomes current. An entry is therefore
+ * remembered for between one and two windows, in fixed memory.
+ *
+ * The window must stay well below the time a sender needs to wrap its
+ * 8-bit msg id, or a new message could be mistaken for an old one.
+ * Not thread-safe: call from the receive context only.
+ */
+#define DEDUP_FILTER_BITS 4096 // Per generation (512 bytes)
+#define DEDUP_FILTER_HASHES 3
+#define DEDUP_WINDOW_MS 30000
+#define DEDUP_KEY_CONTENT 0x10000u // Key is a frame CRC, not a msg id
+
+/**
+ * @brief Clear both generations.
+ */
+void dedup_filter_init(int64_t now_us);
+
+/**
+ * @brief Check whether (src_addr, key) was seen recently and record it.
+ *
+ * @param key Msg id, or DEDUP_KEY_CONTENT | CRC16 of a frame without one.
+ * @return true if it is (probably) a duplicate, false if it is new.
+ */
+bool dedup_filter_seen(uint16_t src_addr, uint32_t key, int64_t now_us);
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "types_common.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Delivery tracking configuration
+#define DELIVERY_MAX_PENDING 4    // Unacked messages tracked at once
+#define DELIVERY_MAX_PEERS 8      // Peers with an RTT estimate
+#define DELIVERY_MAX_ATTEMPTS 4   // First send + retransmissions
+#define DELIVERY_FRAME_MAX 288    // Largest single-message frame
+#define DELIVERY_RTO_INITIAL_MS 3000
+#define DELIVERY_RTO_MIN_MS 500
+#define DELIVERY_RTO_MAX_MS 30000
+
+/**
+ * Callback for delivery state changes of a tracked message
+ * (runs in the mesh TX / esp_timer / receive context)
+ */
+typedef void (*delivery_cb_t)(uint16_t dst, uint8_t msg_id,
+                              delivery_state_t state);
+
+/**
+ * @brief Initialize delivery tracking (pending table + retransmit timer)
+ */
+void delivery_init(void);
+
+/**
+ * @brief Register the delivery state callback
+ */
+void delivery_register_cb(delivery_cb_t cb);
+
+/**
+ * @brief Allocate the next per-node message id (1..255, never 0)
+ */
+uint8_t delivery_next_msg_id(void);
+
+/**
+ * @brief Start tracking a frame that is about to be queued.
+ *
+ * The frame is kept for retransmission until it is ACKed or fails. If
+ * the table is full the caller must not send the frame: an untracked
+ * message would never get a delivery state.
+ *
+ * @param dst    Unicast destination.
+ * @param msg_id Message id carried in the frame.
+ * @param frame  Serialized frame incl. CRC.
+ * @param len    Frame length.
+ * @param tx_id  Mesh TX id of the first transmission (may be shared by
+ *               several messages sent in one batch).
+ * @return 0 on success, -1 if the pending table is full.
+ */
+int delivery_track(uint16_t dst, uint8_t msg_id, const uint8_t *frame,
+                   size_t len, uint32_t tx_id);
+
+/**
+ * @brief TX result for a mesh frame; starts the RTO timer for tracked ones.
+ * @return true if tx_id belonged to at least one tracked message.
+ */
+bool delivery_on_tx_done(uint32_t tx_id, int err);
+
+/**
+ * @brief ACK received from src for msg_id.
+ */
+void delivery_on_ack(uint16_t src, uint8_t msg_id);
+
+/**
+ * @brief Current retransmission timeout for a peer (ms).
+ */
+uint32_t delivery_get_rto_ms(uint16_t peer);
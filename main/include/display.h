@@ -11,14 +11,25 @@
 #define I2C_MASTER_NUM I2C_NUM_0
 #define I2C_MASTER_FREQ_HZ 400000
 #define SSD1306_I2C_ADDRESS 0x3C
+#define DISPLAY_I2C_TIMEOUT_MS 100
+#define DISPLAY_SPAN_HEADER_SIZE 7 // 3 address commands + data control byte
+
+// Display service task (streams submitted frames to the panel)
+#define DISPLAY_TASK_STACK_SIZE 3072
+#define DISPLAY_TASK_PRIORITY 4 // Below the UI task, input stays on time
 
 // Display dimensions and optimization
 #define DISPLAY_WIDTH 128
 #define DISPLAY_HEIGHT 64
-#define CHAR_WIDTH 6 // 5px font + 1px spacing
+#define CHAR_WIDTH 6 // 5px font + 1px spacing (font6x8.h)
 #define MAX_CHARS_PER_LINE (DISPLAY_WIDTH / CHAR_WIDTH) // ~21 chars
 #define MAX_DISPLAY_LINES 8
 
+// Async transfers in flight: one per page plus the start line of a scroll
+// frame. Also the max count of the completion semaphore, so every transfer
+// of a frame can be given before the task waits for them.
+#define DISPLAY_I2C_QUEUE_DEPTH (MAX_DISPLAY_LINES + 1)
+
 // Display modes
 typedef enum {
   DISPLAY_MODE_MENU,
@@ -26,6 +37,18 @@ typedef enum {
   DISPLAY_MODE_CHAT
 } display_mode_t;
 
+// I2C traffic of display_update() flushes
+typedef struct {
+  uint32_t flushes;           // Frames that sent anything
+  uint32_t frames_dropped;    // Superseded before the task could send them
+  uint32_t transactions;      // I2C transactions (one per changed span)
+  uint32_t bytes;             // I2C payload bytes incl. control bytes
+  uint32_t scrolls;           // Flushes that moved the display start line
+  uint32_t last_transactions; // Of the most recent flush
+  uint32_t last_bytes;
+  uint32_t max_bytes; // Largest single flush
+} display_stats_t;
+
 // Function declarations
 void display_init(void);
 void display_clear(void);
@@ -43,6 +66,15 @@ void display_show_list_screen(const char *title, const char *list_items[],
                               int item_count, int cursor_pos,
                               int scroll_offset);
 
+// Formats row index of a list into buf (len bytes, null-terminated)
+typedef void (*display_row_fn_t)(int index, char *buf, size_t len);
+
+// List screen that asks row_fn for the visible rows only, so the cost does
+// not depend on item_count
+void display_show_list_rows(const char *title, int item_count,
+                            int cursor_pos, int scroll_offset,
+                            display_row_fn_t row_fn);
+
 // Chat functions
 void display_show_chat_screen(const char *contact_name, const char *messages[],
                               int msg_count, int scroll_offset);
@@ -50,10 +82,24 @@ void display_show_chat_screen(const char *contact_name, const char *messages[],
 // Text alignment helpers
 void display_center_text(int line, const char *text, bool large_font);
 void display_left_text(int line, const char *text, bool large_font);
+// Full-width inverted line with centered text, drawn over what is there
+void display_banner_text(int line, const char *text);
 
 // Smooth cursor operations (thread-safe)
 void display_move_cursor(int old_line, int new_line);
 
 // Generic functions
+// Drawing only changes the local framebuffer; display_update() hands a
+// snapshot of the changes to the display task and returns immediately.
+// If the task is still busy, the previous unsent snapshot is replaced.
 void display_update(void);
+// Content is being redrawn shifted up by pages (negative: down). The next
+// flush moves the panel's display start line instead, so only pages whose
+// content differs after the shift (e.g. a fixed header/footer and the newly
+// exposed line) are resent.
+void display_scroll(int pages);
+void display_get_stats(display_stats_t *out);
+// Print the framebuffer as a plain PBM (P1) image to stdout, in screen
+// orientation, to compare renderings without looking at the panel
+void display_print_pbm(void);
 bool display_is_ready(void);
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <stdint.h>
+
+/*
+ * 6x8 font for printable ASCII (0x20..0x7E): 5 glyph columns + 1 blank
+ * column, one byte per column in SSD1306 page layout (LSB = top pixel).
+ */
+#define FONT6X8_WIDTH 6
+#define FONT6X8_FIRST 0x20
+#define FONT6X8_COUNT 95
+#define FONT6X8_FALLBACK '?' // Drawn for characters outside the table
+
+extern const uint8_t font6x8[FONT6X8_COUNT][FONT6X8_WIDTH];
+
+// Same glyphs mirrored vertically, for panels mounted upside down (_flip)
+extern const uint8_t font6x8_flipped[FONT6X8_COUNT][FONT6X8_WIDTH];
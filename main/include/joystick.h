@@ -1,5 +1,7 @@
 #pragma once
 #include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "nvs.h"
 #include "nvs_flash.h"
 
@@ -24,3 +26,10 @@ void joystick_init(void);
 void joystick_force_calibrate(void); // Manual calibration
 joystick_action_t joystick_get_action(void);
 bool joystick_is_calibrated(void);
+
+// True while the last sample saw the stick off center or the button held
+bool joystick_is_active(void);
+
+// Notify task (xTaskNotifyGive) from the button interrupt, so a press is
+// seen without polling. The stick itself is analog and has to be sampled.
+void joystick_enable_wakeup(TaskHandle_t task);
@@ -1,22 +1,98 @@
 #pragma once
 
 #include "esp_ble_mesh_defs.h"
+#include "sdkconfig.h"
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
 /**
  * @brief Callback type for raw incoming messages
+ *
+ * src_addr is the unicast source address from the mesh network header.
  */
-typedef void (*mesh_receive_cb_t)(const uint8_t *data, size_t len);
+typedef void (*mesh_receive_cb_t)(uint16_t src_addr, const uint8_t *data,
+                                  size_t len);
+
+// Outbound TX queue configuration
+#define MESH_TX_QUEUE_LEN 8
+// Largest frame incl. CRC: RX SDU minus vendor opcode (3) and TransMIC (4)
+#define MESH_TX_FRAME_MAX (CONFIG_BLE_MESH_RX_SDU_MAX - 7)
+#define MESH_TX_TASK_STACK_SIZE 3072
+#define MESH_TX_TASK_PRIORITY 4
+#define MESH_TX_COMPLETE_TIMEOUT_MS 5000
+
+// Inbound ring between the BLE stack callback and the mesh RX task
+#define MESH_RX_RING_LEN 8 // Slots, power of two
+#define MESH_RX_TASK_STACK_SIZE 4096
+#define MESH_RX_TASK_PRIORITY 5
 
 /**
- * @brief Send a raw buffer through BLE Mesh vendor model
+ * @brief Callback type for TX completion (runs in the mesh TX task)
+ *
+ * @param receiver_add Destination the frame was sent to.
+ * @param tx_id        Id passed to mesh_send_async().
+ * @param err          0 when the stack reported the frame as sent.
+ */
+typedef void (*mesh_tx_done_cb_t)(uint16_t receiver_add, uint32_t tx_id,
+                                  int err);
+
+/**
+ * @brief Send a raw buffer through BLE Mesh vendor model (blocking)
  */
 int mesh_send_raw(const uint8_t *data, size_t data_len, uint16_t receiver_add);
 
 /**
- * @brief Register a callback for raw incoming data
+ * @brief Create the outbound queue and the mesh TX task
+ */
+void mesh_tx_init(void);
+
+/**
+ * @brief Create the inbound ring and the mesh RX task.
+ *
+ * Afterwards received frames are only copied in the BLE stack callback and
+ * the receive callbacks run in the RX task. Before, they run synchronously
+ * in the stack callback.
+ */
+void mesh_rx_init(void);
+
+/**
+ * @brief Queue a pre-serialized frame for the mesh TX task.
+ *
+ * Returns immediately; the result is reported through the TX done callback.
+ *
+ * @param data         Frame bytes (copied into the queue).
+ * @param data_len     Frame length (<= MESH_TX_FRAME_MAX).
+ * @param receiver_add Unicast destination or 0xFFFF for broadcast.
+ * @param tx_id        Caller-chosen id echoed in the done callback.
+ * @return 0 if queued, -1 if the queue is full or arguments are invalid.
+ */
+int mesh_send_async(const uint8_t *data, size_t data_len,
+                    uint16_t receiver_add, uint32_t tx_id);
+
+/**
+ * @brief Queue a frame on the ACK opcode (fire-and-forget, tx_id 0)
+ */
+int mesh_send_ack_async(const uint8_t *data, size_t data_len,
+                        uint16_t receiver_add);
+
+/**
+ * @brief Register a callback for frames received on the ACK opcode
+ */
+void mesh_register_ack_cb(mesh_receive_cb_t cb);
+
+/**
+ * @brief Register a callback for TX completion/failure
+ */
+void mesh_register_tx_done_cb(mesh_tx_done_cb_t cb);
+
+/**
+ * @brief Called from the vendor model callback on SEND_COMP events
+ */
+void mesh_on_send_complete(int err_code);
+
+/**
+ * @brief Register a callback for raw incoming data (runs in the RX task)
  */
 void mesh_register_receive_cb(mesh_receive_cb_t cb);
 
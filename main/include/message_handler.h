@@ -4,10 +4,25 @@
 #include <stddef.h>
 #include <stdint.h>
 
+// Outgoing aggregation: messages for the same destination sent within
+// MSG_AGG_WINDOW_MS are packed into one batch SDU (0 disables batching)
+#ifndef MSG_AGG_WINDOW_MS
+#define MSG_AGG_WINDOW_MS 40
+#endif
+#define MSG_AGG_MAX_RECORDS 16 // Also the most msg ids in one ACK frame
+
 /**
- * Application-level callback (receives fully processed MeshMessage)
+ * Application-level callback (receives a CRC-checked view of the frame that
+ * points into the mesh receive buffer, valid only during the call)
  */
-typedef void (*app_receive_cb_t)(const MeshMessage *msg);
+typedef void (*app_receive_cb_t)(const MeshMessageView *view);
+
+/**
+ * Application-level TX result callback (runs in the mesh TX task)
+ * tx_id is the value returned by message_handler_send()/broadcast().
+ */
+typedef void (*app_tx_done_cb_t)(uint16_t receiver_add, uint32_t tx_id,
+                                 int err);
 
 /**
  * Initialize the message handler and hook into mesh
@@ -15,24 +30,55 @@ typedef void (*app_receive_cb_t)(const MeshMessage *msg);
 void message_handler_init(void);
 
 /**
- * Send a fully processed MeshMessage
+ * Queue a fully processed MeshMessage for sending (non-blocking)
+ * If msg->msg_id is non-zero the message is retransmitted until the
+ * receiver ACKs it (see delivery.h).
+ * Returns a tx id (> 0) reported back through the TX callback, or a
+ * negative value if the frame could not be queued or all
+ * DELIVERY_MAX_PENDING tracking slots are taken (nothing is sent then).
  */
 int message_handler_send(const MeshMessage *msg, uint16_t receiver_add);
 
 /**
  * Internal: receive raw data from mesh (not for app use)
  */
-void message_handler_receive_raw(const uint8_t *data, size_t len);
+void message_handler_receive_raw(uint16_t src_addr, const uint8_t *data,
+                                 size_t len);
+
+/**
+ * Internal: receive an ACK frame from mesh (not for app use)
+ */
+void message_handler_receive_ack(uint16_t src_addr, const uint8_t *data,
+                                 size_t len);
+
+/**
+ * Received frames dropped as duplicates (relayed copies, retransmissions)
+ */
+uint32_t message_handler_get_duplicates(void);
 
 /**
- * Process an incoming raw buffer (verify CRC, deserialize)
+ * Internal: allocate a mesh TX id (used for retransmissions)
  */
-int message_handler_process_incoming(const uint8_t *data, size_t len,
-                                     MeshMessage *out_msg);
+uint32_t message_handler_next_tx_id(void);
 
 /**
  * Register app callback for processed messages
  */
 void message_handler_register_app_cb(app_receive_cb_t cb);
 
-void message_handler_broadcast(MeshMessage *msg);
+/**
+ * Register app callback for TX completion/failure
+ */
+void message_handler_register_tx_cb(app_tx_done_cb_t cb);
+
+/**
+ * Internal: TX result from the mesh TX task (not for app use)
+ */
+void message_handler_on_tx_done(uint16_t receiver_add, uint32_t tx_id,
+                                int err);
+
+/**
+ * Queue a broadcast (non-blocking), same return value as
+ * message_handler_send()
+ */
+int message_handler_broadcast(MeshMessage *msg);
@@ -1,14 +1,40 @@
 #pragma once
 #include "constants.h"
+#include <stdbool.h>
 #include <stdint.h>
 
 #define MAX_PAYLOAD_SIZE 255
 
+// Message types
+#define MSG_TYPE_TEXT 1
+#define MSG_TYPE_BROADCAST 2
+#define MSG_TYPE_ACK 3    // Delivery ACK (sent on VENDOR_OPCODE_ACK)
+#define MSG_TYPE_BATCH 4  // Several frames aggregated into one SDU
+#define MSG_TYPE_PHRASE 5 // Text message as a 1-byte phrasebook id
+
 typedef struct {
   uint8_t type;                       // 1 = text 2 = broadcast
+  uint8_t msg_id;                     // Per-sender id for ACKs (0 = none)
   uint64_t timestamp;                 // Time (seconds)
   char sender_name[USERNAME_MAX_LEN]; // sender name
   uint16_t addr;                      // Sender address
   uint8_t payload_len;                // Size of message
   uint8_t payload[MAX_PAYLOAD_SIZE];  // Data
 } MeshMessage;
+
+/**
+ * Read-only view of a received frame. Pointers reference the receive buffer
+ * and are only valid for the duration of the receive callback; strings are
+ * NOT null-terminated.
+ */
+typedef struct {
+  uint8_t type;               // 1 = text 2 = broadcast
+  uint8_t msg_id;             // Per-sender id for ACKs (0 = none)
+  uint64_t timestamp;         // Local esp_timer time (us)
+  const char *sender_name;    // Sender name (may be empty)
+  uint8_t sender_name_len;    // Length of sender_name
+  uint16_t addr;              // Sender address
+  uint8_t payload_len;        // Size of message
+  const uint8_t *payload;     // Data
+  bool compressed;            // Payload still text_compress()ed
+} MeshMessageView;
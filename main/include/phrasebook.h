@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdint.h>
+
+/*
+ * Shared table of canned phrases. A phrase is sent as its 1-byte id in a
+ * MSG_TYPE_PHRASE frame (one unsegmented PDU) and expanded on receipt.
+ *
+ * The id order is part of the wire format: append new phrases and bump
+ * PHRASEBOOK_VERSION. Nodes announce phrasebook_hash() in their address
+ * broadcast and only get phrase ids from peers whose hash matches.
+ */
+#define PHRASEBOOK_VERSION 1
+#define PHRASEBOOK_SIZE 7
+
+/**
+ * @brief Phrase for an id, or NULL if the id is not in the table.
+ */
+const char *phrasebook_get(uint8_t id);
+
+/**
+ * @brief Id of a phrase (exact match), or -1 if it is not in the table.
+ */
+int phrasebook_find(const char *text);
+
+/**
+ * @brief CRC16 over the version and all phrases, never 0.
+ */
+uint16_t phrasebook_hash(void);
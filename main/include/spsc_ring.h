@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Lock-free single-producer / single-consumer ring of fixed-size slots.
+ *
+ * The producer fills the slot from spsc_ring_write_slot() in place and
+ * publishes it with spsc_ring_commit(); the consumer reads the slot from
+ * spsc_ring_read_slot() in place and frees it with spsc_ring_release().
+ * Exactly one task may produce and one task may consume.
+ */
+typedef struct {
+  uint8_t *slots;      // slot_count * slot_size bytes
+  size_t slot_size;
+  uint32_t slot_count; // Power of two
+  atomic_uint head;    // Next slot to write (producer only)
+  atomic_uint tail;    // Next slot to read (consumer only)
+} spsc_ring_t;
+
+/**
+ * @brief Set up a ring over caller-provided storage.
+ *
+ * @return 0 on success, -1 if slot_count is not a power of two.
+ */
+int spsc_ring_init(spsc_ring_t *ring, void *storage, size_t slot_size,
+                   uint32_t slot_count);
+
+/**
+ * @brief Free slot to fill, or NULL if the ring is full (producer).
+ */
+void *spsc_ring_write_slot(spsc_ring_t *ring);
+
+/**
+ * @brief Publish the slot returned by spsc_ring_write_slot() (producer).
+ */
+void spsc_ring_commit(spsc_ring_t *ring);
+
+/**
+ * @brief Oldest published slot, or NULL if the ring is empty (consumer).
+ */
+void *spsc_ring_read_slot(spsc_ring_t *ring);
+
+/**
+ * @brief Free the slot returned by spsc_ring_read_slot() (consumer).
+ */
+void spsc_ring_release(spsc_ring_t *ring);
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Static-dictionary coder for short English chat text (smaz style).
+ *
+ *   0x20..0x7E  literal printable ASCII character
+ *   0x80..0xFF  entry (byte - 0x80) of the built-in 128-entry dictionary
+ *   0x01 b      escaped raw byte b (anything else)
+ *
+ * The dictionary is part of the wire format and must never change; a new
+ * table needs a new frame flag.
+ */
+#define TEXT_CODEC_ESCAPE 0x01
+#define TEXT_CODEC_DICT_BASE 0x80
+
+/**
+ * @brief Compress text (greedy longest dictionary match).
+ *
+ * @return Compressed length, or 0 if the result would not be smaller than
+ *         in_len or does not fit out_max (send the text as is).
+ */
+size_t text_compress(const uint8_t *in, size_t in_len, uint8_t *out,
+                     size_t out_max);
+
+/**
+ * @brief Expand data produced by text_compress().
+ *
+ * @return Text length, or -1 if the data is malformed or exceeds out_max.
+ */
+int text_decompress(const uint8_t *in, size_t in_len, uint8_t *out,
+                    size_t out_max);
@@ -1,4 +1,9 @@
 #pragma once
+#include <stdint.h>
+
+// Handle of a peer in the user directory, see user_table.h
+typedef uint16_t peer_id_t;
+#define PEER_NONE 0 // No peer / peer no longer known
 
 // Application screens
 typedef enum {
@@ -11,3 +16,11 @@ typedef enum {
 } screen_t;
 // Generic status
 typedef enum { STATUS_OK, STATUS_ERROR, STATUS_BUSY } status_t;
+// Delivery state of an outgoing chat message
+typedef enum {
+  DELIVERY_NONE,   // Incoming message / not tracked
+  DELIVERY_QUEUED, // Waiting in the mesh TX queue
+  DELIVERY_SENT,   // Handed to the mesh, waiting for ACK
+  DELIVERY_ACKED,  // Receiver confirmed delivery
+  DELIVERY_FAILED  // No ACK after all retransmissions
+} delivery_state_t;
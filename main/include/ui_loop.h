@@ -11,8 +11,17 @@
 #define UI_TASK_NAME "ui_task"
 #define UI_TASK_STACK_SIZE 4096
 #define UI_TASK_PRIORITY 5
-#define UI_UPDATE_INTERVAL_MS 50 // 20 FPS
-#define UI_INPUT_DEBOUNCE_MS 20  // Input debounce time
+#define UI_INPUT_DEBOUNCE_MS 20 // Input debounce time
+
+// The UI task sleeps until notified (message, delivery update, button) or
+// until the joystick has to be sampled again / a UI timeout expires
+#define UI_POLL_ACTIVE_MS 20   // Joystick sampling while it is in use
+#define UI_POLL_IDLE_MS 150    // Joystick sampling at rest
+#define UI_ACTIVE_HOLD_MS 1000 // Keep the active rate after the last input
+// Untouched for this long, the task mostly sleeps on the button interrupt
+// and only glances at the stick every UI_POLL_DORMANT_MS
+#define UI_DORMANT_AFTER_MS 30000
+#define UI_POLL_DORMANT_MS 1000
 
 // Task handle for external control
 extern TaskHandle_t ui_task_handle;
@@ -24,6 +33,9 @@ void ui_loop_pause(void);
 void ui_loop_resume(void);
 bool ui_loop_is_running(void);
 
+// Wake the UI task now (safe from any task, not from ISRs)
+void ui_loop_wake(void);
+
 // Core loop functions
 void ui_process_input(void);
 void ui_process_timeouts(void);
@@ -2,16 +2,22 @@
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "constants.h"
 #include "joystick.h"
+#include "phrasebook.h"
 #include "types_common.h"
 #include <stdbool.h>
 #include <stdint.h>
 
 // UI Configuration
-#define UI_PREDEFINED_MSG_COUNT 7
+#define UI_PREDEFINED_MSG_COUNT PHRASEBOOK_SIZE
 #define UI_BROADCAST_TIMEOUT_MS 3000
 #define UI_MESSAGE_SENT_DISPLAY_MS 1000
+#define UI_TOAST_LINE 3 // Display line the toast overlay covers
 #define UI_CHAT_HISTORY_LINES 6
+#define UI_CHAT_READ_ATTEMPTS 3 // Reads of the history racing an append
+#define UI_LIST_VISIBLE_ITEMS 7 // Lines 1-7 below the title
+#define UI_DELIVERY_QUEUE_LEN 8 // Delivery updates waiting for the UI task
 
 // Internal UI state (separate from global app_state)
 typedef struct {
@@ -20,6 +26,14 @@ typedef struct {
   bool screen_needs_update;
   bool broadcast_active;
   int64_t broadcast_start_time;
+  // Toast overlay, drawn over the current screen until toast_until
+  bool toast_active;
+  int64_t toast_until;
+  const char *toast_text;
+  // Sent-message toast: follows the delivery state of the last message
+  bool toast_delivery;
+  delivery_state_t toast_state;
+  peer_id_t toast_peer;
 } ui_internal_state_t;
 
 // Core UI functions
@@ -36,7 +50,7 @@ screen_t ui_get_current_screen(void);
 // Screen rendering functions
 void ui_show_home_screen(void);
 void ui_show_chat_screen(void);
-void ui_show_individual_chat_screen(const char *contact_name);
+void ui_show_individual_chat_screen(peer_id_t peer);
 void ui_show_send_message_screen(void);
 void ui_show_broadcast_screen(void);
 void ui_show_about_screen();
@@ -51,16 +65,26 @@ void ui_send_selected_message(void);
 void ui_handle_joystick(joystick_action_t action);
 
 // Message callback for API integration
-void ui_on_message_received(const char *sender, const char *message);
+void ui_on_message_received(peer_id_t sender, const char *message);
+void ui_on_delivery_update(peer_id_t receiver, delivery_state_t state);
+// Apply the delivery updates queued by ui_on_delivery_update() (UI task)
+void ui_process_delivery_updates(void);
 
 // State management helpers
 bool ui_needs_update(void);
 void ui_mark_dirty(void);
 void ui_clear_dirty(void);
 
+// Toast overlay (dismissed by ui_process_timeouts())
+// text is kept by reference and must outlive the toast (e.g. a literal)
+void ui_show_toast(const char *text, uint32_t duration_ms);
+void ui_check_toast_timeout(void);
+
 // Broadcast management
 void ui_start_broadcast(void);
 void ui_check_broadcast_timeout(void);
+// Milliseconds until the next UI timeout is due (UINT32_MAX if none)
+uint32_t ui_next_timeout_ms(void);
 
 // Utility functions
 const char *ui_get_predefined_message(int index);
@@ -1,24 +1,104 @@
 #pragma once
+#include "constants.h"
 #include "esp_err.h"
+#include "types_common.h"
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 typedef struct {
-  char username[32];     // Username of node
+  char username[USERNAME_MAX_LEN]; // Username of node
   uint16_t unicast_addr; // Mesh unicast address
   bool valid;            // Mark if entry is active
+  uint16_t phrasebook;   // Peer's phrasebook hash (0 = unknown, not saved)
+  uint32_t last_seen;    // LRU clock of the last contact (not saved)
+  uint8_t generation;    // Bumped when the entry is given to another peer
 } user_t;
 
-#define MAX_USERS 3 // Maximum known users
+/*
+ * Directory of up to MAX_USERS peers. Lookups by address and by name go
+ * through two open-addressing (linear probing) hash indices of
+ * USER_TABLE_HASH_SIZE slots, kept at most half full.
+ *
+ * When the table is full, a new peer replaces the least recently seen one
+ * in its slot, so the valid entries are always
+ * user_table[0 .. user_table_count() - 1]. An index stays the same peer
+ * until that peer is evicted; the evict callback is told first.
+ *
+ * The rest of the app refers to peers by peer_id_t handle,
+ * (generation << 8) | index, and only looks up names to render them. A
+ * handle of an evicted peer no longer resolves (user_table_index_of()
+ * returns -1), even though its index now holds another peer.
+ *
+ * The RX task adds and renames peers while the UI task renders them, so
+ * the table is guarded by a recursive mutex. The functions below take it
+ * themselves; code reading user_table[] directly must hold
+ * user_table_lock() for as long as it uses the entry. The evict callback
+ * runs with the lock held. NVS is written after the lock is released.
+ *
+ * Entries are saved to the NVS partition USER_TABLE_NVS_PARTITION, which
+ * nvs_flash_init_partition() must have set up. A full directory takes
+ * about 770 NVS entries; the default "nvs" partition (shared with BLE Mesh)
+ * holds 630.
+ */
+#define USER_TABLE_HASH_BITS 9
+#define USER_TABLE_HASH_SIZE (1u << USER_TABLE_HASH_BITS)
+#define USER_TABLE_NVS_PARTITION "users"
 
 extern user_t user_table[MAX_USERS];
 
+// Called before the entry of peer is given to another peer
+typedef void (*user_table_evict_cb_t)(peer_id_t peer);
+
+void user_table_register_evict_cb(user_table_evict_cb_t cb);
+
+/**
+ * @brief Create the table lock. Call once before any other task starts.
+ */
+void user_table_init(void);
+
+/**
+ * @brief Take / release the table lock (recursive).
+ */
+void user_table_lock(void);
+void user_table_unlock(void);
+
+/**
+ * @brief Handle of the peer at idx, PEER_NONE if idx is not valid.
+ */
+peer_id_t user_table_peer_id(int idx);
+
 /**
- * @brief Add a user to the table if not already present.
+ * @brief Table index of a peer, -1 if the handle is stale or PEER_NONE.
+ */
+int user_table_index_of(peer_id_t peer);
+
+/**
+ * @brief Mark a peer as just seen (keeps it from LRU eviction).
+ */
+void user_table_touch(int idx);
+
+/**
+ * @brief Copy the username at idx into out.
+ *
+ * @return false if idx is not a valid entry (out is left untouched)
+ */
+bool user_table_copy_name(int idx, char *out, size_t len);
+
+/**
+ * @brief Number of valid entries.
+ */
+int user_table_count(void);
+
+/**
+ * @brief Add a user, or rename the user with this address.
+ *
+ * A full table evicts the least recently seen peer. Only the changed entry
+ * is written to NVS.
  *
  * @param username     Username (string)
  * @param unicast_addr Mesh unicast address
- * @return true if added, false if already exists or table full
+ * @return true if the user is in the table, false on invalid arguments
  */
 bool user_table_set(const char *username, uint16_t unicast_addr);
 
@@ -29,6 +109,8 @@ uint16_t user_table_get_addr(const char *username);
 
 /**
  * @brief Get username for a given unicast address.
+ *
+ * The pointer is into the table: hold user_table_lock() while using it.
  */
 const char *user_table_get_name(uint16_t unicast_addr);
 
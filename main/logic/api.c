@@ -1,83 +1,202 @@
 #include "api.h"
 #include "app_state.h"
+#include "binary_serial.h"
 #include "chat_log.h"
+#include "chat_store.h"
 #include "constants.h"
+#include "delivery.h"
 #include "esp_log.h"
 #include "esp_log_timestamp.h"
 #include "esp_timer.h"
 #include "message_handler.h"
 #include "message_struct.h"
 #include "node_config.h"
+#include "phrasebook.h"
 #include "user_table.h"
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include <time.h>
 
-// Keep UI callback pointer
+// Keep UI callback pointers
 static ui_receive_cb_t ui_cb = NULL;
+static ui_delivery_cb_t ui_delivery_cb = NULL;
 
 static const char *TAG = "API";
 
+/**
+ * TX result from the message handler (runs in the mesh TX task).
+ */
+static void api_on_tx_done(uint16_t receiver_add, uint32_t tx_id, int err) {
+  if (err != 0) {
+    ESP_LOGW(TAG, "Message %lu to 0x%04X was not sent", (unsigned long)tx_id,
+             receiver_add);
+  } else {
+    ESP_LOGI(TAG, "Message %lu to 0x%04X sent", (unsigned long)tx_id,
+             receiver_add);
+  }
+}
+
+/**
+ * Delivery state change of an outgoing message → chat log → UI.
+ */
+static void api_on_delivery(uint16_t dst, uint8_t msg_id,
+                            delivery_state_t state) {
+  peer_id_t peer = user_table_peer_id(user_table_find_index_by_addr(dst));
+  if (!chat_log_set_delivery(peer, msg_id, state)) {
+    return;
+  }
+
+  if (ui_delivery_cb) {
+    ui_delivery_cb(peer, state);
+  }
+}
+
+/**
+ * A full user table gives the entry of peer to a new one: forget it.
+ */
+static void api_on_user_evicted(peer_id_t peer) {
+  chat_log_clear_peer(peer);
+  app_state_clear_new_message(peer);
+}
+
 /**
  * Initialize API and register UI callback.
  */
-void api_init(ui_receive_cb_t cb) { ui_cb = cb; }
+void api_init(ui_receive_cb_t cb) {
+  ui_cb = cb;
+  message_handler_register_tx_cb(api_on_tx_done);
+  delivery_register_cb(api_on_delivery);
+  user_table_register_evict_cb(api_on_user_evicted);
+}
+
+void api_register_delivery_cb(ui_delivery_cb_t cb) { ui_delivery_cb = cb; }
+
+/**
+ * Refill the chat log of every known user from the persistent store.
+ */
+void api_load_chat_history(void) {
+  chat_store_msg_t msgs[MAX_CHAT_PER_USER];
+
+  // Runs at boot before the mesh is up, but the RX task may be running
+  // when called later: hold the table lock so no entry changes underneath
+  user_table_lock();
+  chat_store_lock();
+  for (int idx = 0; idx < user_table_count(); idx++) {
+    int n = chat_store_read_page(user_table[idx].unicast_addr, 0, msgs,
+                                 MAX_CHAT_PER_USER);
+    for (int i = 0; i < n; i++) {
+      chat_log_add(user_table_peer_id(idx), msgs[i].text, msgs[i].outgoing);
+    }
+    if (n > 0) {
+      ESP_LOGI(TAG, "Restored %d messages of %s", n, user_table[idx].username);
+    }
+  }
+  chat_store_unlock();
+  user_table_unlock();
+}
 
 /**
  * Convert plain text to MeshMessage and send via message_handler.
  */
-void api_send_text(const char *receiver_name, const char *msg) {
+int api_send_text(peer_id_t receiver, const char *msg) {
 
   ESP_LOGI(TAG, "Message recieved from UI");
-  int idx = user_table_find_index_by_name(receiver_name);
-  if (idx >= 0) {
-    chat_log_add(idx, msg, true); // true = outgoing
+
+  // Read what we need of the entry in one go: the RX task may evict it
+  user_table_lock();
+  int idx = user_table_index_of(receiver);
+  if (idx < 0 || !msg) {
+    user_table_unlock();
+    ESP_LOGW(TAG, "Peer 0x%04X is no longer known", receiver);
+    return -1;
   }
+  uint16_t receiver_add = user_table[idx].unicast_addr;
+  uint16_t peer_phrasebook = user_table[idx].phrasebook;
+  user_table_touch(idx);
+  user_table_unlock();
 
   MeshMessage m;
   memset(&m, 0, sizeof(MeshMessage));
 
   m.type = 1; // 1 = text message
+  m.msg_id = delivery_next_msg_id();
+
+  // Logged before sending so the delivery callback always finds the entry
+  chat_log_add_outgoing(receiver, msg, m.msg_id);
+
   m.timestamp = esp_timer_get_time();
 
+  // Name is left empty so the v2 frame omits it: peers learn our name from
+  // broadcasts and resolve it from the source address.
   const node_config_t *cfg = node_config_get();
-  strncpy(m.sender_name, cfg->name, USERNAME_MAX_LEN);
   m.addr = cfg->address;
 
-  size_t msg_len = strlen(msg);
-  if (msg_len > MAX_MESSAGE_LEN) {
-    msg_len = MAX_MESSAGE_LEN; // truncate
+  size_t msg_len = field_len(msg, MAX_MESSAGE_LEN); // Truncates longer text
+
+  // Canned phrases go out as their id if the peer has the same phrasebook
+  int phrase_id = phrasebook_find(msg);
+  if (phrase_id >= 0 && peer_phrasebook == phrasebook_hash()) {
+    m.type = MSG_TYPE_PHRASE;
+    m.payload_len = 1;
+    m.payload[0] = (uint8_t)phrase_id;
+  } else {
+    m.payload_len = msg_len;
+    memcpy(m.payload, msg, msg_len);
   }
-  m.payload_len = msg_len;
-  memcpy(m.payload, msg, msg_len);
 
-  uint16_t receiver_add = user_table_get_addr(receiver_name);
+  chat_store_append_async(receiver_add, true, msg, msg_len);
   ESP_LOGI(TAG, "Structured message sent to message handler");
 
-  message_handler_send(&m, receiver_add);
+  if (message_handler_send(&m, receiver_add) < 0) {
+    chat_log_set_delivery(receiver, m.msg_id, DELIVERY_FAILED);
+    return -1;
+  }
+  return 0;
 }
 
 /**
  * Called by message_handler when a new message is received.
- * Converts MeshMessage → (sender_id, text) → UI callback.
+ * Consumes the zero-copy view: the payload goes straight from the mesh
+ * buffer into the chat log, and the UI gets the stored entry.
  */
-void api_on_message_received(const MeshMessage *m) {
+void api_on_message_view(const MeshMessageView *v) {
 
   const node_config_t *cfg = node_config_get();
 
   ESP_LOGI(TAG, "Structured message recieved from message handler");
-  if (m->addr == cfg->address) {
-    ESP_LOGI(TAG, "Ignoring self-message from address 0x%04X", m->addr);
+  if (v->addr == cfg->address) {
+    ESP_LOGI(TAG, "Ignoring self-message from address 0x%04X", v->addr);
     return;
   }
-  uint16_t sender_addr = m->addr;
-  const char *sender_name = m->sender_name;
+  uint16_t sender_addr = v->addr;
+
+  // Null-terminated copy of the name, only needed to (re)register the peer.
+  // v2 frames usually omit it: use a placeholder until the peer's broadcast
+  // tells us its real name.
+  char sender_name[USERNAME_MAX_LEN];
+  if (v->sender_name_len > 0) {
+    memcpy(sender_name, v->sender_name, v->sender_name_len);
+    sender_name[v->sender_name_len] = '\0';
+  } else {
+    snprintf(sender_name, sizeof(sender_name), "Node-%04X", sender_addr);
+  }
 
   // --- Handle broadcast messages ---
-  if (m->type == 2) {                         // 2 = broadcast
+  if (v->type == 2) {                         // 2 = broadcast
     user_table_set(sender_name, sender_addr); // add/update user table
 
+    // Payload carries the sender's phrasebook hash (absent on old nodes)
+    user_table_lock();
+    int peer_idx = user_table_find_index_by_addr(sender_addr);
+    if (peer_idx >= 0) {
+      user_table[peer_idx].phrasebook =
+          v->payload_len >= 2
+              ? (uint16_t)((v->payload[0] << 8) | v->payload[1])
+              : 0;
+    }
+    user_table_unlock();
+
     ESP_LOGI(TAG, "Brodcast recieved");
     return; // no further processing needed
   }
@@ -102,32 +221,41 @@ void api_on_message_received(const MeshMessage *m) {
              sender_name, idx);
   }
 
+  user_table_lock();
+  peer_id_t peer = user_table_peer_id(idx);
+  user_table_touch(idx);
+  user_table_unlock();
+
   // --- Normal chat message ---
-  if (idx >= 0) {
-    if (g_app_state.selected_user[0] == '\0' ||
-        strcmp(g_app_state.selected_user, sender_name) != 0) {
-      g_app_state.new_message_flags[idx] = true; // mark new message
-    }
+  if (app_state_get_selected_peer() != peer) {
+    app_state_set_new_message(peer); // mark new message
   }
 
-  // 1. Copy payload into buffer (if any)
-  static char buffer[MAX_MESSAGE_LEN + 1];
-  size_t copy_len =
-      (m->payload_len > MAX_MESSAGE_LEN) ? MAX_MESSAGE_LEN : m->payload_len;
-  if (copy_len > 0) {
-    memcpy(buffer, m->payload, copy_len);
+  // Canned phrase: expand the id from our copy of the phrasebook
+  const char *text = (const char *)v->payload;
+  size_t text_len = v->payload_len;
+  if (v->type == MSG_TYPE_PHRASE) {
+    const char *phrase = v->payload_len == 1 ? phrasebook_get(v->payload[0])
+                                             : NULL;
+    if (!phrase) {
+      ESP_LOGW(TAG, "Unknown phrase from 0x%04X", sender_addr);
+      phrase = "?";
+    }
+    text = phrase;
+    text_len = strlen(phrase);
   }
-  buffer[copy_len] = '\0';
 
-  // <-- store in chat log -->
-  if (idx >= 0 && copy_len > 0) {
-    chat_log_add(idx, buffer, false);
+  // 1. Store payload in chat log directly from the mesh buffer
+  const char *stored = NULL;
+  if (text_len > 0) {
+    stored = chat_log_add_n(peer, text, text_len, false);
+    chat_store_append_async(sender_addr, false, text, text_len);
   }
 
   ESP_LOGI(TAG, "message stored");
   // 2. Notify UI if registered
   if (ui_cb) {
-    ui_cb(sender_name, buffer);
+    ui_cb(peer, stored ? stored : "");
 
     ESP_LOGI(TAG, "message sent to UI");
   }
@@ -136,38 +264,61 @@ void api_on_message_received(const MeshMessage *m) {
 void api_broadcast_addr(void) {
   const node_config_t *cfg = node_config_get();
   MeshMessage msg;
+  memset(&msg, 0, sizeof(msg));
 
   msg.type = 2; // broadcast
   msg.timestamp = esp_timer_get_time();
-  strncpy(msg.sender_name, cfg->name, USERNAME_MAX_LEN);
+  // Fixed-width wire field: a full-length name carries no terminator
+  memcpy(msg.sender_name, cfg->name, field_len(cfg->name, USERNAME_MAX_LEN));
   msg.addr = cfg->address; // directly store the address
-  msg.payload_len = 0;
-  // Store own address in payload (little-endian)
+
+  // Announce our phrasebook so peers know they can send us phrase ids
+  uint16_t phrasebook = phrasebook_hash();
+  msg.payload[0] = phrasebook >> 8;
+  msg.payload[1] = phrasebook & 0xFF;
+  msg.payload_len = 2;
 
   message_handler_broadcast(&msg); // hand off to mesh
 }
 
-int api_get_contact_names(char names[][USERNAME_MAX_LEN], int max_contacts) {
+int api_get_contact_count(void) { return user_table_count(); }
 
-  int count = 0;
-  for (int i = 0; i < MAX_USERS && count < max_contacts; i++) {
-    if (user_table[i].valid) {
-      strncpy(names[count], user_table[i].username, USERNAME_MAX_LEN);
-      names[count][USERNAME_MAX_LEN - 1] = '\0';
-      count++;
-    }
-  }
-  return count;
+bool api_get_contact_name(int contact_idx, char *name, size_t len) {
+  return user_table_copy_name(contact_idx, name, len);
+}
+
+peer_id_t api_get_contact_peer(int contact_idx) {
+  return user_table_peer_id(contact_idx);
+}
+
+bool api_get_peer_name(peer_id_t peer, char *name, size_t len) {
+  user_table_lock();
+  bool found = user_table_copy_name(user_table_index_of(peer), name, len);
+  user_table_unlock();
+  return found;
+}
+
+bool api_chat_iter_begin(peer_id_t peer, chat_log_iter_t *it) {
+  if (!it)
+    return false;
+
+  chat_log_iter_begin(peer, it);
+  return user_table_index_of(peer) >= 0;
 }
 
-int api_get_chat_log(const char *username, char out_buf[][MAX_MESSAGE_LEN + 1],
-                     int max_msgs) {
-  if (!username || !out_buf || max_msgs <= 0)
-    return 0;
+uint32_t api_get_chat_generation(void) { return chat_log_generation(); }
+
+bool api_chat_unchanged(uint32_t gen) { return chat_log_unchanged(gen); }
 
-  int user_idx = user_table_find_index_by_name(username);
-  if (user_idx < 0)
-    return 0;
+int api_get_chat_line_count(peer_id_t peer) {
+  return chat_log_line_count(peer);
+}
+
+uint32_t api_get_chat_evicted_lines(peer_id_t peer) {
+  return chat_log_evicted_lines(peer);
+}
 
-  return chat_log_get(user_idx, out_buf, max_msgs);
+int api_get_chat_lines(peer_id_t peer, int first, chat_log_line_t out[],
+                       int max_lines) {
+  return chat_log_get_lines(peer, first, out, max_lines);
 }
@@ -1,4 +1,5 @@
 #include "app_state.h"
+#include "user_table.h"
 #include <string.h>
 
 // Global state instance
@@ -9,7 +10,7 @@ app_state_t g_app_state;
  */
 void app_state_init(void) {
   g_app_state.current_screen = SCREEN_HOME;
-  g_app_state.selected_user[0] = '\0';
+  g_app_state.selected_peer = PEER_NONE;
   memset(g_app_state.new_message_flags, 0,
          sizeof(g_app_state.new_message_flags));
 }
@@ -22,30 +23,41 @@ void app_state_set_screen(screen_t screen) {
   g_app_state.current_screen = screen;
 }
 
-// Get selected user
-const char *app_state_get_selected_user(void) {
-  return g_app_state.selected_user;
+// Get selected peer
+peer_id_t app_state_get_selected_peer(void) {
+  return g_app_state.selected_peer;
 }
 
-// Set selected user
-void app_state_set_selected_user(const char *username) {
-  if (username) {
-    strncpy(g_app_state.selected_user, username, USERNAME_MAX_LEN);
-    g_app_state.selected_user[USERNAME_MAX_LEN - 1] = '\0';
-  } else {
-    g_app_state.selected_user[0] = '\0';
-  }
+// Set selected peer
+void app_state_set_selected_peer(peer_id_t peer) {
+  g_app_state.selected_peer = peer;
 }
 
 // Get unread message flag
-bool app_state_has_new_message(int user_idx) {
-  if (user_idx < 0 || user_idx >= MAX_USERS)
-    return false;
-  return g_app_state.new_message_flags[user_idx];
+// The flags are indexed like the user table: hold its lock so the slot
+// can't be handed to another peer between the lookup and the access.
+bool app_state_has_new_message(peer_id_t peer) {
+  user_table_lock();
+  int user_idx = user_table_index_of(peer);
+  bool flag = user_idx >= 0 && g_app_state.new_message_flags[user_idx];
+  user_table_unlock();
+  return flag;
+}
+
+// Set unread flag
+void app_state_set_new_message(peer_id_t peer) {
+  user_table_lock();
+  int user_idx = user_table_index_of(peer);
+  if (user_idx >= 0)
+    g_app_state.new_message_flags[user_idx] = true;
+  user_table_unlock();
 }
 
 // Clear unread flag
-void app_state_clear_new_message(int user_idx) {
-  if (user_idx >= 0 && user_idx < MAX_USERS)
+void app_state_clear_new_message(peer_id_t peer) {
+  user_table_lock();
+  int user_idx = user_table_index_of(peer);
+  if (user_idx >= 0)
     g_app_state.new_message_flags[user_idx] = false;
+  user_table_unlock();
 }
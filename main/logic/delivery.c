@@ -0,0 +1,340 @@
+#include "delivery.h"
+#include "esp_log.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "mesh.h"
+#include "message_handler.h"
+#include <string.h>
+
+static const char *TAG = "DELIVERY";
+
+// Message waiting for an ACK
+typedef struct {
+  bool in_use;
+  bool in_flight;     // Queued for TX, waiting for the TX result
+  uint16_t dst;
+  uint8_t msg_id;
+  uint8_t attempts;   // Transmissions so far
+  uint32_t tx_id;     // Mesh TX id of the latest transmission
+  uint32_t rto_ms;    // Timeout for the latest transmission (backed off)
+  int64_t sent_at;    // esp_timer time of the latest transmission
+  int64_t deadline;   // Retransmit / give-up time (valid when !in_flight)
+  uint16_t len;
+  uint8_t frame[DELIVERY_FRAME_MAX];
+} pending_msg_t;
+
+// Per-peer RTT estimate (RFC 6298 style, in ms)
+typedef struct {
+  bool valid;
+  uint16_t addr;
+  uint32_t srtt_ms;
+  uint32_t rttvar_ms;
+  uint32_t rto_ms;
+  int64_t last_used;
+} peer_rtt_t;
+
+// State change collected under the lock, reported after releasing it
+typedef struct {
+  uint16_t dst;
+  uint8_t msg_id;
+  delivery_state_t state;
+} delivery_event_t;
+
+static pending_msg_t pending[DELIVERY_MAX_PENDING];
+static peer_rtt_t peers[DELIVERY_MAX_PEERS];
+static delivery_cb_t delivery_cb = NULL;
+static SemaphoreHandle_t delivery_mutex = NULL;
+static esp_timer_handle_t rto_timer = NULL;
+static uint8_t next_msg_id = 1;
+
+static uint32_t clamp_rto(uint32_t rto_ms) {
+  if (rto_ms < DELIVERY_RTO_MIN_MS)
+    return DELIVERY_RTO_MIN_MS;
+  if (rto_ms > DELIVERY_RTO_MAX_MS)
+    return DELIVERY_RTO_MAX_MS;
+  return rto_ms;
+}
+
+// Find or create (evicting the least recently used) the entry for a peer
+static peer_rtt_t *peer_get(uint16_t addr) {
+  peer_rtt_t *victim = &peers[0];
+  for (int i = 0; i < DELIVERY_MAX_PEERS; i++) {
+    if (peers[i].valid && peers[i].addr == addr) {
+      return &peers[i];
+    }
+    if (!peers[i].valid) {
+      victim = &peers[i];
+    } else if (victim->valid && peers[i].last_used < victim->last_used) {
+      victim = &peers[i];
+    }
+  }
+
+  memset(victim, 0, sizeof(*victim));
+  victim->valid = true;
+  victim->addr = addr;
+  victim->rto_ms = DELIVERY_RTO_INITIAL_MS;
+  return victim;
+}
+
+static void peer_add_rtt_sample(uint16_t addr, uint32_t rtt_ms) {
+  peer_rtt_t *p = peer_get(addr);
+
+  if (p->srtt_ms == 0) {
+    // First measurement
+    p->srtt_ms = rtt_ms;
+    p->rttvar_ms = rtt_ms / 2;
+  } else {
+    uint32_t delta =
+        (p->srtt_ms > rtt_ms) ? p->srtt_ms - rtt_ms : rtt_ms - p->srtt_ms;
+    p->rttvar_ms = (3 * p->rttvar_ms + delta) / 4;
+    p->srtt_ms = (7 * p->srtt_ms + rtt_ms) / 8;
+  }
+  p->rto_ms = clamp_rto(p->srtt_ms + 4 * p->rttvar_ms);
+
+  ESP_LOGD(TAG, "RTT 0x%04X: sample=%lu srtt=%lu rttvar=%lu rto=%lu", addr,
+           (unsigned long)rtt_ms, (unsigned long)p->srtt_ms,
+           (unsigned long)p->rttvar_ms, (unsigned long)p->rto_ms);
+}
+
+// Arm the timer for the earliest deadline (call with the lock held)
+static void rearm_timer_locked(int64_t now) {
+  int64_t earliest = 0;
+  for (int i = 0; i < DELIVERY_MAX_PENDING; i++) {
+    if (pending[i].in_use && !pending[i].in_flight &&
+        (earliest == 0 || pending[i].deadline < earliest)) {
+      earliest = pending[i].deadline;
+    }
+  }
+
+  esp_timer_stop(rto_timer);
+  if (earliest != 0) {
+    int64_t wait_us = earliest - now;
+    esp_timer_start_once(rto_timer, wait_us > 1000 ? wait_us : 1000);
+  }
+}
+
+static void report_events(const delivery_event_t *events, int count) {
+  for (int i = 0; i < count; i++) {
+    if (delivery_cb) {
+      delivery_cb(events[i].dst, events[i].msg_id, events[i].state);
+    }
+  }
+}
+
+// (Re)transmit a pending frame (call with the lock held)
+static void transmit_locked(pending_msg_t *p, int64_t now) {
+  p->attempts++;
+  p->tx_id = message_handler_next_tx_id();
+  p->in_flight = true;
+  p->sent_at = now;
+
+  if (mesh_send_async(p->frame, p->len, p->dst, p->tx_id) != 0) {
+    // Queue full: count it as a lost transmission and retry after the RTO
+    p->in_flight = false;
+    p->deadline = now + (int64_t)p->rto_ms * 1000;
+  }
+}
+
+static void rto_timer_cb(void *arg) {
+  delivery_event_t events[DELIVERY_MAX_PENDING];
+  int event_count = 0;
+
+  xSemaphoreTake(delivery_mutex, portMAX_DELAY);
+  int64_t now = esp_timer_get_time();
+
+  for (int i = 0; i < DELIVERY_MAX_PENDING; i++) {
+    pending_msg_t *p = &pending[i];
+    if (!p->in_use || p->in_flight || p->deadline > now) {
+      continue;
+    }
+
+    if (p->attempts >= DELIVERY_MAX_ATTEMPTS) {
+      ESP_LOGW(TAG, "Message %u to 0x%04X failed after %u attempts",
+               p->msg_id, p->dst, p->attempts);
+      events[event_count++] =
+          (delivery_event_t){p->dst, p->msg_id, DELIVERY_FAILED};
+      p->in_use = false;
+      continue;
+    }
+
+    // Exponential backoff for this message
+    p->rto_ms = clamp_rto(p->rto_ms * 2);
+    ESP_LOGI(TAG, "Retransmitting message %u to 0x%04X (attempt %u)",
+             p->msg_id, p->dst, p->attempts + 1);
+    transmit_locked(p, now);
+  }
+
+  rearm_timer_locked(now);
+  xSemaphoreGive(delivery_mutex);
+
+  report_events(events, event_count);
+}
+
+void delivery_init(void) {
+  if (delivery_mutex) {
+    return;
+  }
+
+  memset(pending, 0, sizeof(pending));
+  memset(peers, 0, sizeof(peers));
+
+  // Receivers drop (src, msg_id) pairs seen within the dedup window. A
+  // random start keeps the ids sent right after a reboot from repeating the
+  // ones sent right before it.
+  next_msg_id = (uint8_t)(esp_random() % 255) + 1;
+
+  delivery_mutex = xSemaphoreCreateMutex();
+  if (!delivery_mutex) {
+    ESP_LOGE(TAG, "Failed to create delivery mutex");
+    return;
+  }
+
+  const esp_timer_create_args_t timer_args = {
+      .callback = rto_timer_cb,
+      .name = "delivery_rto",
+  };
+  if (esp_timer_create(&timer_args, &rto_timer) != ESP_OK) {
+    ESP_LOGE(TAG, "Failed to create RTO timer");
+  }
+}
+
+void delivery_register_cb(delivery_cb_t cb) { delivery_cb = cb; }
+
+uint8_t delivery_next_msg_id(void) {
+  uint8_t id = next_msg_id++;
+  if (next_msg_id == 0) {
+    next_msg_id = 1;
+  }
+  return id;
+}
+
+int delivery_track(uint16_t dst, uint8_t msg_id, const uint8_t *frame,
+                   size_t len, uint32_t tx_id) {
+  if (!delivery_mutex || !frame || len > DELIVERY_FRAME_MAX) {
+    return -1;
+  }
+
+  int ret = -1;
+  xSemaphoreTake(delivery_mutex, portMAX_DELAY);
+  for (int i = 0; i < DELIVERY_MAX_PENDING; i++) {
+    pending_msg_t *p = &pending[i];
+    if (p->in_use) {
+      continue;
+    }
+
+    p->in_use = true;
+    p->in_flight = true;
+    p->dst = dst;
+    p->msg_id = msg_id;
+    p->attempts = 1;
+    p->tx_id = tx_id;
+    p->rto_ms = peer_get(dst)->rto_ms;
+    p->sent_at = esp_timer_get_time();
+    p->deadline = 0;
+    p->len = (uint16_t)len;
+    memcpy(p->frame, frame, len);
+    ret = 0;
+    break;
+  }
+  xSemaphoreGive(delivery_mutex);
+
+  if (ret != 0) {
+    ESP_LOGW(TAG, "Pending table full, message %u not sent", msg_id);
+  }
+  return ret;
+}
+
+bool delivery_on_tx_done(uint32_t tx_id, int err) {
+  if (!delivery_mutex) {
+    return false;
+  }
+
+  delivery_event_t events[DELIVERY_MAX_PENDING];
+  int event_count = 0;
+  bool tracked = false;
+
+  // Several messages share a tx id when they were sent as one batch
+  xSemaphoreTake(delivery_mutex, portMAX_DELAY);
+  int64_t now = esp_timer_get_time();
+  for (int i = 0; i < DELIVERY_MAX_PENDING; i++) {
+    pending_msg_t *p = &pending[i];
+    if (!p->in_use || !p->in_flight || p->tx_id != tx_id) {
+      continue;
+    }
+
+    tracked = true;
+    p->in_flight = false;
+    // RTT is measured from the moment the frame actually left the node
+    if (err == 0) {
+      p->sent_at = now;
+    }
+    p->deadline = now + (int64_t)p->rto_ms * 1000;
+
+    if (err == 0 && p->attempts == 1) {
+      events[event_count++] =
+          (delivery_event_t){p->dst, p->msg_id, DELIVERY_SENT};
+    }
+  }
+  if (tracked) {
+    rearm_timer_locked(now);
+  }
+  xSemaphoreGive(delivery_mutex);
+
+  report_events(events, event_count);
+  return tracked;
+}
+
+void delivery_on_ack(uint16_t src, uint8_t msg_id) {
+  if (!delivery_mutex) {
+    return;
+  }
+
+  delivery_event_t event;
+  bool acked = false;
+
+  xSemaphoreTake(delivery_mutex, portMAX_DELAY);
+  int64_t now = esp_timer_get_time();
+  for (int i = 0; i < DELIVERY_MAX_PENDING; i++) {
+    pending_msg_t *p = &pending[i];
+    if (!p->in_use || p->dst != src || p->msg_id != msg_id) {
+      continue;
+    }
+
+    // Karn's rule: only unambiguous (never retransmitted) samples
+    if (p->attempts == 1) {
+      peer_add_rtt_sample(src, (uint32_t)((now - p->sent_at) / 1000));
+    }
+    peer_get(src)->last_used = now;
+
+    acked = true;
+    event = (delivery_event_t){p->dst, p->msg_id, DELIVERY_ACKED};
+    p->in_use = false;
+    rearm_timer_locked(now);
+    break;
+  }
+  xSemaphoreGive(delivery_mutex);
+
+  if (acked) {
+    ESP_LOGI(TAG, "Message %u ACKed by 0x%04X", msg_id, src);
+    report_events(&event, 1);
+  }
+}
+
+uint32_t delivery_get_rto_ms(uint16_t peer) {
+  uint32_t rto = DELIVERY_RTO_INITIAL_MS;
+  if (!delivery_mutex) {
+    return rto;
+  }
+
+  xSemaphoreTake(delivery_mutex, portMAX_DELAY);
+  for (int i = 0; i < DELIVERY_MAX_PEERS; i++) {
+    if (peers[i].valid && peers[i].addr == peer) {
+      rto = peers[i].rto_ms;
+      break;
+    }
+  }
+  xSemaphoreGive(delivery_mutex);
+  return rto;
+}
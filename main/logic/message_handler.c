@@ -1,78 +1,437 @@
 #include "message_handler.h"
 #include "binary_serial.h"
 #include "crc16.h"
+#include "dedup_filter.h"
+#include "delivery.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include "mesh.h"
 #include <stdint.h>
-#include <stdio.h>
 #include <string.h>
 
 static app_receive_cb_t app_receive_cb = NULL; // app-level callback
+static app_tx_done_cb_t app_tx_done_cb = NULL; // app-level TX result
+static uint32_t next_tx_id = 1;
+static portMUX_TYPE tx_id_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t rx_duplicates = 0; // Frames dropped by the dedup filter
+
+// Outgoing batch, collects messages for one destination at a time
+typedef struct {
+  uint16_t dst;
+  uint32_t tx_id;    // Shared by every message in the batch
+  uint8_t count;
+  size_t len;        // Bytes used in buf (batch header included)
+  size_t first_off;  // First record, sent as a plain frame if it stays alone
+  size_t first_len;
+  uint8_t buf[MESH_TX_FRAME_MAX];
+} msg_batch_t;
+
+static msg_batch_t batch;
+static SemaphoreHandle_t batch_mutex = NULL;
+static esp_timer_handle_t batch_timer = NULL;
+
+static void message_handler_batch_timer_cb(void *arg);
 
 static const char *TAG = "Message_handler";
 /**
  * @brief Initialize message handler and hook into mesh
  */
 void message_handler_init(void) {
-  // Register our raw receive handler with mesh
+  // Register our raw receive handlers with mesh
   mesh_register_receive_cb(message_handler_receive_raw);
+  mesh_register_ack_cb(message_handler_receive_ack);
+
+  // ACK tracking / retransmission of outgoing messages
+  delivery_init();
+
+  // Relayed duplicates and retransmissions are dropped before parsing
+  dedup_filter_init(esp_timer_get_time());
+
+  // Received frames are processed in the mesh RX task, not the BLE stack
+  mesh_rx_init();
+
+  // Outbound frames go through the mesh TX task
+  mesh_register_tx_done_cb(message_handler_on_tx_done);
+  mesh_tx_init();
+
+  // Short aggregation window for outgoing messages
+  if (MSG_AGG_WINDOW_MS > 0 && !batch_mutex) {
+    batch_mutex = xSemaphoreCreateMutex();
+    const esp_timer_create_args_t timer_args = {
+        .callback = message_handler_batch_timer_cb,
+        .name = "msg_batch",
+    };
+    if (!batch_mutex ||
+        esp_timer_create(&timer_args, &batch_timer) != ESP_OK) {
+      ESP_LOGE(TAG, "Batching disabled, init failed");
+      batch_timer = NULL;
+    }
+  }
 }
 
 /**
- * @brief Called by mesh.c whenever a raw buffer arrives
+ * @brief Called by the mesh TX task once a queued frame is sent or failed
  */
-void message_handler_receive_raw(const uint8_t *data, size_t len) {
+void message_handler_on_tx_done(uint16_t receiver_add, uint32_t tx_id,
+                                int err) {
+  if (tx_id == 0) {
+    return; // ACK frame, nothing to report
+  }
 
-  ESP_LOGI(TAG, "Message recieved from Mesh");
-  if (!data || len < 3) {
-    return;
+  if (err != 0) {
+    ESP_LOGW(TAG, "TX %lu to 0x%04X failed", (unsigned long)tx_id,
+             receiver_add);
   }
 
-  MeshMessage msg;
-  int ret = message_handler_process_incoming(data, len, &msg);
-  if (ret == 0) {
-    // Pass processed message to application Api
-    if (app_receive_cb) {
-      ESP_LOGI(TAG, "Message sent to API");
-      app_receive_cb(&msg);
-    }
+  // Starts the retransmission timer of ACK-tracked messages
+  delivery_on_tx_done(tx_id, err);
+
+  if (app_tx_done_cb) {
+    app_tx_done_cb(receiver_add, tx_id, err);
   }
 }
 
-/**
- * @brief Fully process an incoming raw buffer
- * - Verify CRC
- * - Deserialize into MeshMessage
- */
-int message_handler_process_incoming(const uint8_t *data, size_t len,
-                                     MeshMessage *out_msg) {
+// Serialize + CRC into buffer, returns frame length or 0 on error
+static size_t message_handler_encode(const MeshMessage *msg, uint8_t *buffer) {
+  size_t buffer_len = 0;
 
-  if (!data || len < 3 || !out_msg) {
+  // Serialize (without CRC)
+  int ret =
+      serialize_message_v2(msg, esp_timer_get_time(), buffer, &buffer_len);
+  if (ret != 0) {
+    return 0;
+  }
+
+  // Append CRC16
+  uint16_t crc = crc16(buffer, buffer_len);
+  buffer[buffer_len++] = (crc >> 8) & 0xFF;
+  buffer[buffer_len++] = crc & 0xFF;
+
+  return buffer_len;
+}
+
+uint32_t message_handler_next_tx_id(void) {
+  portENTER_CRITICAL(&tx_id_lock);
+  uint32_t tx_id = next_tx_id++;
+  if (next_tx_id > INT32_MAX) {
+    next_tx_id = 1;
+  }
+  portEXIT_CRITICAL(&tx_id_lock);
+  return tx_id;
+}
+
+// Verify the trailing CRC16, returns 0 on success
+static int message_handler_check_crc(const uint8_t *data, size_t len) {
+  if (!data || len < 3) {
     return -1;
   }
 
-  // Extract CRC16 (last two bytes)
   uint16_t recv_crc = ((uint16_t)data[len - 2] << 8) | data[len - 1];
   uint16_t calc_crc = crc16(data, len - 2);
-
   if (recv_crc != calc_crc) {
-    printf("CRC mismatch: recv=0x%04X calc=0x%04X\n", recv_crc, calc_crc);
+    ESP_LOGW(TAG, "CRC mismatch: recv=0x%04X calc=0x%04X", recv_crc,
+             calc_crc);
     return -2;
   }
+  return 0;
+}
 
-  // Deserialize (excluding CRC bytes)
-  int ret = deserialize_message(data, len - 2, out_msg);
-  if (ret != 0) {
+// Parse a CRC-checked frame (CRC stripped) into a view of data. Only a
+// compressed payload is copied, expanded into text_buf.
+static int message_handler_decode(const uint8_t *data, size_t len,
+                                  uint16_t src_addr, MeshMessageView *view,
+                                  uint8_t *text_buf) {
+  if (deserialize_message_view(data, len, esp_timer_get_time(), view) != 0 ||
+      deserialize_view_payload(view, text_buf) != 0) {
     return -3;
   }
-  ESP_LOGI(TAG, "incoming message handled success");
+
+  // v2 frames don't carry the sender address, take it from the mesh header
+  if (view->addr == 0) {
+    view->addr = src_addr;
+  }
   return 0;
 }
 
+// Queue one ACK for the msg_ids back to the sender. The first id goes in
+// the header, the others (messages received in the same batch) as payload.
+static void message_handler_send_ack(uint16_t receiver_add,
+                                     const uint8_t *msg_ids, size_t count) {
+  MeshMessage ack;
+  memset(&ack, 0, sizeof(ack));
+  ack.type = MSG_TYPE_ACK;
+  ack.msg_id = msg_ids[0];
+  ack.timestamp = esp_timer_get_time();
+  ack.payload_len = (uint8_t)(count - 1);
+  memcpy(ack.payload, &msg_ids[1], count - 1);
+
+  uint8_t buffer[MSG_V2_MAX_HEADER_SIZE + MSG_AGG_MAX_RECORDS + 2];
+  size_t buffer_len = message_handler_encode(&ack, buffer);
+  if (buffer_len > 0) {
+    mesh_send_ack_async(buffer, buffer_len, receiver_add);
+  }
+}
+
+// Queue the pending batch for the mesh TX task (call with the lock held).
+// Returns 0 on success, or -1 with the batch destination / tx id set so the
+// caller can report the failure once the lock is released.
+static int message_handler_flush_locked(uint16_t *dst, uint32_t *tx_id) {
+  if (batch.count == 0) {
+    return 0;
+  }
+
+  uint8_t *frame = batch.buf;
+  size_t len = batch.len;
+  if (batch.count == 1) {
+    // Nothing to aggregate with, send the record as a plain frame
+    frame = &batch.buf[batch.first_off];
+    len = batch.first_len;
+  }
+
+  uint16_t crc = crc16(frame, len);
+  frame[len++] = (crc >> 8) & 0xFF;
+  frame[len++] = crc & 0xFF;
+
+  ESP_LOGI(TAG, "%u message(s) queued for mesh, len=%u segments=%u",
+           batch.count, (unsigned)len,
+           (unsigned)mesh_frame_segment_count(len));
+  int ret = mesh_send_async(frame, len, batch.dst, batch.tx_id);
+  *dst = batch.dst;
+  *tx_id = batch.tx_id;
+  batch.count = 0;
+  batch.len = 0;
+  return ret != 0 ? -1 : 0;
+}
+
+// Queue the pending batch for the mesh TX task
+static void message_handler_flush_batch(void) {
+  uint16_t dst;
+  uint32_t tx_id;
+
+  xSemaphoreTake(batch_mutex, portMAX_DELAY);
+  int ret = message_handler_flush_locked(&dst, &tx_id);
+  xSemaphoreGive(batch_mutex);
+
+  if (ret != 0) {
+    // Tracked messages stay pending and are retried once the RTO expires
+    message_handler_on_tx_done(dst, tx_id, -1);
+  }
+}
+
+static void message_handler_batch_timer_cb(void *arg) {
+  message_handler_flush_batch();
+}
+
+// Append a frame (without its CRC) to the outgoing batch, returns tx id or
+// negative if it needs tracking and the pending table is full
+static int message_handler_batch_add(const uint8_t *buffer, size_t buffer_len,
+                                     uint16_t receiver_add, uint8_t msg_id) {
+  size_t record_len = buffer_len - 2;
+  uint16_t failed_dst = 0;
+  uint32_t failed_tx_id = 0;
+  int ret = 0;
+
+  xSemaphoreTake(batch_mutex, portMAX_DELAY);
+
+  // A batch goes to a single destination and must fit in one SDU
+  if (batch.count > 0 &&
+      (batch.dst != receiver_add || batch.count >= MSG_AGG_MAX_RECORDS ||
+       batch.len + MSG_BATCH_RECORD_OVERHEAD + record_len + 2 >
+           MESH_TX_FRAME_MAX)) {
+    esp_timer_stop(batch_timer);
+    ret = message_handler_flush_locked(&failed_dst, &failed_tx_id);
+  }
+
+  // Track before the batch is queued so the TX result can't race it. With
+  // the pending table full the message is refused rather than sent without
+  // delivery tracking.
+  uint32_t tx_id =
+      batch.count > 0 ? batch.tx_id : message_handler_next_tx_id();
+  if (msg_id != 0 && receiver_add != 0xFFFF &&
+      delivery_track(receiver_add, msg_id, buffer, buffer_len, tx_id) != 0) {
+    xSemaphoreGive(batch_mutex);
+    if (ret != 0) {
+      message_handler_on_tx_done(failed_dst, failed_tx_id, -1);
+    }
+    return -4;
+  }
+
+  if (batch.count == 0) {
+    batch.dst = receiver_add;
+    batch.tx_id = tx_id;
+    batch.buf[0] = MSG_BATCH_HEADER;
+    batch.len = 1;
+    esp_timer_start_once(batch_timer, MSG_AGG_WINDOW_MS * 1000);
+  }
+
+  size_t n = serialize_batch_record(buffer, record_len, &batch.buf[batch.len]);
+  if (batch.count == 0) {
+    batch.first_off = batch.len + n - record_len;
+    batch.first_len = record_len;
+  }
+  batch.len += n;
+  batch.count++;
+  xSemaphoreGive(batch_mutex);
+
+  if (ret != 0) {
+    message_handler_on_tx_done(failed_dst, failed_tx_id, -1);
+  }
+  return (int)tx_id;
+}
+
+// Add a frame to the outgoing batch, returns tx id or negative on error.
+// Frames carrying a msg_id are tracked until the receiver ACKs them.
+static int message_handler_enqueue(const uint8_t *buffer, size_t buffer_len,
+                                   uint16_t receiver_add, uint8_t msg_id) {
+  if (batch_timer) {
+    // Batch header, record length and CRC around the record (the frame
+    // without its own CRC) must fit in one SDU
+    if (1 + MSG_BATCH_RECORD_OVERHEAD + buffer_len <= MESH_TX_FRAME_MAX) {
+      return message_handler_batch_add(buffer, buffer_len, receiver_add,
+                                       msg_id);
+    }
+    // Too big to be batched: send it plain, after what is already batched
+    esp_timer_stop(batch_timer);
+    message_handler_flush_batch();
+  }
+
+  uint32_t tx_id = message_handler_next_tx_id();
+
+  // Track before queueing so the TX result can't race the registration
+  bool tracked = msg_id != 0 && receiver_add != 0xFFFF;
+  if (tracked &&
+      delivery_track(receiver_add, msg_id, buffer, buffer_len, tx_id) != 0) {
+    return -4; // Pending table full
+  }
+
+  ESP_LOGI(TAG, "Message queued for mesh, len=%u segments=%u",
+           (unsigned)buffer_len,
+           (unsigned)mesh_frame_segment_count(buffer_len));
+  if (mesh_send_async(buffer, buffer_len, receiver_add, tx_id) != 0) {
+    if (tracked) {
+      // Stays tracked: retried once the RTO expires
+      delivery_on_tx_done(tx_id, -1);
+      return (int)tx_id;
+    }
+    return -3;
+  }
+  return (int)tx_id;
+}
+
+// Handle one frame of a received SDU (CRC checked and stripped). Text
+// message ids are collected in ack_ids to be confirmed in a single ACK.
+static void message_handler_receive_record(uint16_t src_addr,
+                                           const uint8_t *data, size_t len,
+                                           uint8_t *ack_ids,
+                                           size_t *ack_count) {
+  uint8_t type = 0;
+  uint8_t msg_id = frame_peek_msg_id(data, len, &type);
+  if (type == MSG_TYPE_BATCH) {
+    return; // Batches don't nest
+  }
+
+  uint32_t dedup_key = msg_id;
+  if (msg_id != 0) {
+    // Confirm delivery to the sender, also for repeats: the ACK may be lost.
+    // Senders start their ids at a random value every boot, so a repeat
+    // within the dedup window is a retransmission, not a new message.
+    if ((type == MSG_TYPE_TEXT || type == MSG_TYPE_PHRASE) &&
+        *ack_count < MSG_AGG_MAX_RECORDS) {
+      ack_ids[(*ack_count)++] = msg_id;
+    }
+  } else {
+    // No id to go by (broadcasts, v1 frames): relayed copies are identical
+    dedup_key = DEDUP_KEY_CONTENT | crc16(data, len);
+  }
+
+  if (dedup_filter_seen(src_addr, dedup_key, esp_timer_get_time())) {
+    rx_duplicates++;
+    ESP_LOGI(TAG, "Duplicate 0x%05lX from 0x%04X dropped (%lu so far)",
+             (unsigned long)dedup_key, src_addr, (unsigned long)rx_duplicates);
+    return;
+  }
+
+  MeshMessageView view;
+  uint8_t text_buf[MAX_PAYLOAD_SIZE];
+  if (message_handler_decode(data, len, src_addr, &view, text_buf) != 0) {
+    return;
+  }
+
+  // Pass processed message to application Api
+  if (app_receive_cb) {
+    ESP_LOGI(TAG, "Message sent to API");
+    app_receive_cb(&view);
+  }
+}
+
+uint32_t message_handler_get_duplicates(void) { return rx_duplicates; }
+
+/**
+ * @brief Called by mesh.c whenever a raw buffer arrives
+ */
+void message_handler_receive_raw(uint16_t src_addr, const uint8_t *data,
+                                 size_t len) {
+
+  ESP_LOGI(TAG, "Message recieved from Mesh");
+
+  // Verify CRC once, then hand out views into the mesh buffer (no copy)
+  if (message_handler_check_crc(data, len) != 0) {
+    return;
+  }
+
+  uint8_t ack_ids[MSG_AGG_MAX_RECORDS];
+  size_t ack_count = 0;
+
+  if (data[0] == MSG_BATCH_HEADER) {
+    size_t offset = 0;
+    const uint8_t *record;
+    size_t record_len;
+    while (deserialize_batch_record(data, len - 2, &offset, &record,
+                                    &record_len) > 0) {
+      message_handler_receive_record(src_addr, record, record_len, ack_ids,
+                                     &ack_count);
+    }
+  } else {
+    message_handler_receive_record(src_addr, data, len - 2, ack_ids,
+                                   &ack_count);
+  }
+
+  // One ACK confirms every text message of the SDU
+  if (ack_count > 0) {
+    message_handler_send_ack(src_addr, ack_ids, ack_count);
+  }
+}
+
+/**
+ * @brief Called by mesh.c whenever a frame arrives on the ACK opcode
+ */
+void message_handler_receive_ack(uint16_t src_addr, const uint8_t *data,
+                                 size_t len) {
+  MeshMessageView view;
+  uint8_t text_buf[MAX_PAYLOAD_SIZE];
+  if (message_handler_check_crc(data, len) != 0 ||
+      message_handler_decode(data, len - 2, src_addr, &view, text_buf) != 0) {
+    return;
+  }
+
+  if (view.type != MSG_TYPE_ACK || view.msg_id == 0) {
+    return;
+  }
+
+  // Header id, then the ids of other messages ACKed by the same frame
+  delivery_on_ack(src_addr, view.msg_id);
+  for (size_t i = 0; i < view.payload_len; i++) {
+    delivery_on_ack(src_addr, view.payload[i]);
+  }
+}
+
 /**
  * @brief Send a processed MeshMessage
  * - Serialize
  * - Append CRC
- * - Forward to mesh.c
+ * - Queue for the mesh TX task (returns without waiting for the stack)
  */
 int message_handler_send(const MeshMessage *msg, uint16_t receiver_add) {
 
@@ -81,42 +440,30 @@ int message_handler_send(const MeshMessage *msg, uint16_t receiver_add) {
     return -1;
   }
 
-  uint8_t buffer[sizeof(MeshMessage) + 4];
-  size_t buffer_len = 0;
-
-  // Serialize (without CRC)
-  int ret = serialize_message(msg, buffer, &buffer_len);
-  if (ret != 0) {
+  uint8_t buffer[MESH_TX_FRAME_MAX];
+  size_t buffer_len = message_handler_encode(msg, buffer);
+  if (buffer_len == 0) {
     return -2;
   }
 
-  // Append CRC16
-  uint16_t crc = crc16(buffer, buffer_len);
-  buffer[buffer_len++] = (crc >> 8) & 0xFF;
-  buffer[buffer_len++] = crc & 0xFF;
-
-  ESP_LOGI(TAG, "Message send to mesh");
-  // Pass to mesh for transport
-  return mesh_send_raw(buffer, buffer_len, receiver_add);
+  return message_handler_enqueue(buffer, buffer_len, receiver_add,
+                                 msg->msg_id);
 }
 
-void message_handler_broadcast(MeshMessage *msg) {
+int message_handler_broadcast(MeshMessage *msg) {
 
   ESP_LOGI(TAG, "Broadcast recieved from API");
+  if (!msg) {
+    return -1;
+  }
 
-  uint8_t buffer[sizeof(MeshMessage) + 4];
-  size_t buffer_len = 0;
-
-  // Serialize (without CRC)
-  int ret = serialize_message(msg, buffer, &buffer_len);
-
-  // Append CRC16
-  uint16_t crc = crc16(buffer, buffer_len);
-  buffer[buffer_len++] = (crc >> 8) & 0xFF;
-  buffer[buffer_len++] = crc & 0xFF;
+  uint8_t buffer[MESH_TX_FRAME_MAX];
+  size_t buffer_len = message_handler_encode(msg, buffer);
+  if (buffer_len == 0) {
+    return -2;
+  }
 
-  // Pass to mesh for transport
-  mesh_broadcast_self(buffer, buffer_len);
+  return message_handler_enqueue(buffer, buffer_len, 0xFFFF, 0);
 }
 
 /**
@@ -125,3 +472,10 @@ void message_handler_broadcast(MeshMessage *msg) {
 void message_handler_register_app_cb(app_receive_cb_t cb) {
   app_receive_cb = cb;
 }
+
+/**
+ * @brief Register application callback for TX completion/failure
+ */
+void message_handler_register_tx_cb(app_tx_done_cb_t cb) {
+  app_tx_done_cb = cb;
+}
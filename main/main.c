@@ -15,12 +15,13 @@
 // --- Project includes ---
 #include "api.h"
 #include "app_state.h"       // app_state_init()
+#include "chat_log.h"        // chat_log_init()
+#include "chat_store.h"      // chat_store_init(), chat_store_task_init()
 #include "display.h"         // display_init()
 #include "joystick.h"        // joystick_init()
 #include "mesh_init.h"       // mesh_init()
 #include "message_handler.h" // message_handler_init()
 #include "ui_loop.h" // ui_loop_start(), ui_loop_is_running(), ui_print_loop_stats()
-#include "ui_screens.h" // ui_init()
 #include "user_table.h"
 
 static const char *TAG = "MAIN";
@@ -38,6 +39,20 @@ static void nvs_init(void) {
     ret = nvs_flash_init();
   }
   ESP_ERROR_CHECK(ret);
+
+  // The user directory lives in a partition of its own
+  ret = nvs_flash_init_partition(USER_TABLE_NVS_PARTITION);
+  if (ret == ESP_ERR_NVS_NO_FREE_PAGES ||
+      ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+    ESP_LOGW(TAG, "'%s' partition truncated, erasing...",
+             USER_TABLE_NVS_PARTITION);
+    ESP_ERROR_CHECK(nvs_flash_erase_partition(USER_TABLE_NVS_PARTITION));
+    ret = nvs_flash_init_partition(USER_TABLE_NVS_PARTITION);
+  }
+  if (ret != ESP_OK) {
+    ESP_LOGW(TAG, "No '%s' partition (%s), users are not persisted",
+             USER_TABLE_NVS_PARTITION, esp_err_to_name(ret));
+  }
   ESP_LOGI(TAG, "NVS initialized successfully");
 }
 
@@ -68,9 +83,17 @@ static esp_err_t app_layer_init(void) {
   message_handler_init();
   ESP_LOGI(TAG, "Message handler ready");
 
-  message_handler_register_app_cb(api_on_message_received);
+  message_handler_register_app_cb(api_on_message_view);
   ESP_LOGI(TAG, "API callback registered with message handler");
 
+  chat_log_init();
+
+  // History is optional: without the partition chats start empty
+  if (chat_store_init(chat_store_partition_flash()) == 0) {
+    api_load_chat_history();
+    chat_store_task_init();
+  }
+
   return ESP_OK;
 }
 
@@ -104,6 +127,7 @@ void app_main(void) {
   nvs_init();
 
   // Load user data from nvs
+  user_table_init();
   user_table_load_from_nvs();
 
   // Step 2: Hardware
@@ -118,8 +142,7 @@ void app_main(void) {
     return;
   }
 
-  // Step 4: UI system (calls api_init internally)
-  ui_init();
+  // Step 4: UI system (ui_loop_start() runs ui_init(), which calls api_init)
   ui_loop_start();
   ESP_LOGI(TAG, "UI system initialized");
 
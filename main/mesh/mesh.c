@@ -1,7 +1,11 @@
 #include "mesh.h"
 #include "esp_ble_mesh_networking_api.h"
 #include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
 #include "mesh_init.h"
+#include "spsc_ring.h"
 #include "vendor_model.h"
 #include <stdint.h>
 #include <stdio.h>
@@ -11,19 +15,65 @@
 static const char *TAG = "MESH";
 
 static mesh_receive_cb_t app_receive_cb = NULL;
+static mesh_receive_cb_t ack_receive_cb = NULL;
+static mesh_tx_done_cb_t tx_done_cb = NULL;
+
+// Outbound queue item (frame is copied so callers can return immediately)
+typedef struct {
+  uint32_t opcode;
+  uint16_t receiver_add;
+  uint16_t len;
+  uint32_t tx_id;
+  uint8_t data[MESH_TX_FRAME_MAX];
+} mesh_tx_item_t;
+
+static QueueHandle_t tx_queue = NULL;
+static TaskHandle_t tx_task_handle = NULL;
+static volatile int last_send_err = 0;
+
+// Inbound ring slot (frame copied out of the stack's buffer)
+typedef struct {
+  uint32_t opcode;
+  uint16_t src_addr;
+  uint16_t len;
+  uint8_t data[MESH_TX_FRAME_MAX];
+} mesh_rx_item_t;
+
+static mesh_rx_item_t rx_slots[MESH_RX_RING_LEN];
+static spsc_ring_t rx_ring;
+static TaskHandle_t rx_task_handle = NULL;
+static uint32_t rx_dropped = 0; // Frames lost to a full ring
 
 extern esp_ble_mesh_model_t vendor_models[];
 
 /* -------------------------------------------------------------------------- */
 /*                   Vendor model callback (receive handler)                  */
 /* -------------------------------------------------------------------------- */
+
+// Hand a received frame to whoever registered for its opcode
+static void mesh_dispatch_frame(uint32_t opcode, uint16_t src_addr,
+                                const uint8_t *data, size_t data_len) {
+  if (opcode == VENDOR_OPCODE_ACK) {
+    if (ack_receive_cb) {
+      ack_receive_cb(src_addr, data, data_len);
+    }
+    return;
+  }
+
+  // Forward raw data to whoever registered
+  if (app_receive_cb) {
+    app_receive_cb(src_addr, data, data_len);
+  }
+}
+
 void mesh_vendor_model_cb(esp_ble_mesh_model_cb_event_t event,
                           esp_ble_mesh_model_cb_param_t *param) {
   if (event != ESP_BLE_MESH_MODEL_OPERATION_EVT) {
     return;
   }
 
-  if (param->model_operation.opcode != VENDOR_OPCODE_MESSAGE) {
+  uint32_t opcode = param->model_operation.opcode;
+  if (opcode != VENDOR_OPCODE_MESSAGE && opcode != VENDOR_OPCODE_ACK) {
     return;
   }
 
@@ -37,9 +87,55 @@ void mesh_vendor_model_cb(esp_ble_mesh_model_cb_event_t event,
 
   ESP_LOGI("MESH", "Raw message received, len=%u", (unsigned)data_len);
 
-  // Forward raw data to whoever registered
-  if (app_receive_cb) {
-    app_receive_cb(data, data_len);
+  uint16_t src_addr = param->model_operation.ctx->addr;
+  if (!rx_task_handle) {
+    mesh_dispatch_frame(opcode, src_addr, data, data_len);
+    return;
+  }
+
+  // Only copy the frame here, the RX task does the processing
+  mesh_rx_item_t *item = spsc_ring_write_slot(&rx_ring);
+  if (!item || data_len > sizeof(item->data)) {
+    rx_dropped++;
+    ESP_LOGW(TAG, "RX frame from 0x%04X dropped (%lu so far)", src_addr,
+             (unsigned long)rx_dropped);
+    return;
+  }
+
+  item->opcode = opcode;
+  item->src_addr = src_addr;
+  item->len = (uint16_t)data_len;
+  memcpy(item->data, data, data_len);
+  spsc_ring_commit(&rx_ring);
+  xTaskNotifyGive(rx_task_handle);
+}
+
+static void mesh_rx_task(void *pvParameters) {
+  while (1) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    // Drain everything that arrived, processing frames in place
+    mesh_rx_item_t *item;
+    while ((item = spsc_ring_read_slot(&rx_ring)) != NULL) {
+      mesh_dispatch_frame(item->opcode, item->src_addr, item->data,
+                          item->len);
+      spsc_ring_release(&rx_ring);
+    }
+  }
+}
+
+void mesh_rx_init(void) {
+  if (rx_task_handle) {
+    return;
+  }
+
+  spsc_ring_init(&rx_ring, rx_slots, sizeof(mesh_rx_item_t),
+                 MESH_RX_RING_LEN);
+
+  if (xTaskCreate(mesh_rx_task, "mesh_rx", MESH_RX_TASK_STACK_SIZE, NULL,
+                  MESH_RX_TASK_PRIORITY, &rx_task_handle) != pdPASS) {
+    ESP_LOGE(TAG, "Failed to create RX task");
+    rx_task_handle = NULL;
   }
 }
 
@@ -47,7 +143,8 @@ void mesh_vendor_model_cb(esp_ble_mesh_model_cb_event_t event,
 /*                            Message sending                                 */
 /* -------------------------------------------------------------------------- */
 
-int mesh_send_raw(const uint8_t *data, size_t data_len, uint16_t receiver_add) {
+static int mesh_send_opcode(uint32_t opcode, const uint8_t *data,
+                            size_t data_len, uint16_t receiver_add) {
   if (!is_provisioned()) {
     ESP_LOGE(TAG, "❌ Not provisioned - cannot send message");
     return -1;
@@ -65,8 +162,7 @@ int mesh_send_raw(const uint8_t *data, size_t data_len, uint16_t receiver_add) {
   ctx.send_ttl = 5;
 
   esp_err_t err = esp_ble_mesh_server_model_send_msg(
-      &vendor_models[0], &ctx, VENDOR_OPCODE_MESSAGE, (uint16_t)data_len,
-      (uint8_t *)data);
+      &vendor_models[0], &ctx, opcode, (uint16_t)data_len, (uint8_t *)data);
 
   if (err != ESP_OK) {
     ESP_LOGE(TAG, "Send failed (err=0x%04X)", err);
@@ -78,6 +174,10 @@ int mesh_send_raw(const uint8_t *data, size_t data_len, uint16_t receiver_add) {
   return 0;
 }
 
+int mesh_send_raw(const uint8_t *data, size_t data_len, uint16_t receiver_add) {
+  return mesh_send_opcode(VENDOR_OPCODE_MESSAGE, data, data_len, receiver_add);
+}
+
 bool mesh_broadcast_self(const uint8_t *buffer, size_t buffer_len) {
   if (!is_provisioned()) {
     ESP_LOGE("MESH", "❌ Not provisioned - cannot broadcast");
@@ -107,7 +207,112 @@ bool mesh_broadcast_self(const uint8_t *buffer, size_t buffer_len) {
   ESP_LOGI("MESH", "📢 Broadcasted self (%d bytes)", buffer_len);
   return true;
 }
+/* -------------------------------------------------------------------------- */
+/*                         Outbound TX queue / task                           */
+/* -------------------------------------------------------------------------- */
+void mesh_on_send_complete(int err_code) {
+  last_send_err = err_code;
+  if (tx_task_handle) {
+    xTaskNotifyGive(tx_task_handle);
+  }
+}
+
+static void mesh_tx_task(void *pvParameters) {
+  static mesh_tx_item_t item; // only touched by this task
+
+  while (1) {
+    if (xQueueReceive(tx_queue, &item, portMAX_DELAY) != pdTRUE) {
+      continue;
+    }
+
+    // Drop a completion left over from a previous timed-out send
+    ulTaskNotifyTake(pdTRUE, 0);
+
+    int err;
+    if (item.receiver_add == 0xFFFF) {
+      err = mesh_broadcast_self(item.data, item.len) ? 0 : -1;
+    } else {
+      err = mesh_send_opcode(item.opcode, item.data, item.len,
+                             item.receiver_add);
+    }
+
+    // Wait for the stack to finish (segmented) transmission before the next
+    // frame: only one segmented message can be in flight at a time.
+    if (err == 0) {
+      if (ulTaskNotifyTake(pdTRUE,
+                           pdMS_TO_TICKS(MESH_TX_COMPLETE_TIMEOUT_MS)) == 0) {
+        ESP_LOGW(TAG, "No send completion for tx %lu",
+                 (unsigned long)item.tx_id);
+        err = -1;
+      } else if (last_send_err != 0) {
+        ESP_LOGE(TAG, "Send completion error %d", last_send_err);
+        err = -1;
+      }
+    }
+
+    if (tx_done_cb) {
+      tx_done_cb(item.receiver_add, item.tx_id, err);
+    }
+  }
+}
+
+void mesh_tx_init(void) {
+  if (tx_queue) {
+    return;
+  }
+
+  tx_queue = xQueueCreate(MESH_TX_QUEUE_LEN, sizeof(mesh_tx_item_t));
+  if (!tx_queue) {
+    ESP_LOGE(TAG, "Failed to create TX queue");
+    return;
+  }
+
+  if (xTaskCreate(mesh_tx_task, "mesh_tx", MESH_TX_TASK_STACK_SIZE, NULL,
+                  MESH_TX_TASK_PRIORITY, &tx_task_handle) != pdPASS) {
+    ESP_LOGE(TAG, "Failed to create TX task");
+    vQueueDelete(tx_queue);
+    tx_queue = NULL;
+  }
+}
+
+static int mesh_queue_frame(uint32_t opcode, const uint8_t *data,
+                            size_t data_len, uint16_t receiver_add,
+                            uint32_t tx_id) {
+  if (!tx_queue || !data || data_len == 0 || data_len > MESH_TX_FRAME_MAX) {
+    ESP_LOGE(TAG, "Invalid arguments to mesh_send_async");
+    return -1;
+  }
+
+  mesh_tx_item_t item;
+  item.opcode = opcode;
+  item.receiver_add = receiver_add;
+  item.len = (uint16_t)data_len;
+  item.tx_id = tx_id;
+  memcpy(item.data, data, data_len);
+
+  if (xQueueSend(tx_queue, &item, 0) != pdTRUE) {
+    ESP_LOGW(TAG, "TX queue full, dropping frame to 0x%04X", receiver_add);
+    return -1;
+  }
+  return 0;
+}
+
+int mesh_send_async(const uint8_t *data, size_t data_len,
+                    uint16_t receiver_add, uint32_t tx_id) {
+  return mesh_queue_frame(VENDOR_OPCODE_MESSAGE, data, data_len, receiver_add,
+                          tx_id);
+}
+
+int mesh_send_ack_async(const uint8_t *data, size_t data_len,
+                        uint16_t receiver_add) {
+  return mesh_queue_frame(VENDOR_OPCODE_ACK, data, data_len, receiver_add, 0);
+}
+
 /* -------------------------------------------------------------------------- */
 /*                  Register callback for higher-level app                    */
 /* -------------------------------------------------------------------------- */
 void mesh_register_receive_cb(mesh_receive_cb_t cb) { app_receive_cb = cb; }
+
+void mesh_register_ack_cb(mesh_receive_cb_t cb) { ack_receive_cb = cb; }
+
+void mesh_register_tx_done_cb(mesh_tx_done_cb_t cb) { tx_done_cb = cb; }
@@ -23,6 +23,9 @@ void vendor_model_cb(esp_ble_mesh_model_cb_event_t event,
 
     // Just forward everything to mesh.c
     mesh_vendor_model_cb(event, param);
+  } else if (event == ESP_BLE_MESH_MODEL_SEND_COMP_EVT) {
+    // Unblocks the mesh TX task waiting on this frame
+    mesh_on_send_complete(param->model_send_comp.err_code);
   } else {
     ESP_LOGI(TAG, "Unhandled vendor model event %d", event);
   }
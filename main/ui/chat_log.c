@@ -1,67 +1,416 @@
 #include "chat_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include "user_table.h"
+#include <stdatomic.h>
 #include <stdio.h>
 #include <string.h>
 
-static user_chat_log_t chat_logs[MAX_USERS];
+// Record header, followed by line_count spans and the null-terminated text
+typedef struct {
+  uint16_t next; // Next newer record of the same user, CHAT_LOG_NONE if last
+  uint8_t user;
+  uint8_t len; // Text length without the terminator
+  uint8_t msg_id; // Outgoing msg id (0 = none)
+  uint8_t state;  // delivery_state_t
+  uint8_t line_count;
+  uint8_t flags;
+} chat_log_rec_t;
+
+#define REC_FLAG_DEAD 0x01 // User cleared, only waiting to be evicted
+
+_Static_assert(MAX_USERS <= 256, "chat_log_rec_t.user is 8 bits");
+
+#define REC_SIZE(lines, len)                                                   \
+  ((sizeof(chat_log_rec_t) + (lines) * sizeof(chat_log_span_t) + (len) + 2) &  \
+   ~(size_t)1)
+
+static uint8_t arena[CHAT_LOG_ARENA_SIZE] __attribute__((aligned(2)));
+static uint16_t arena_head = 0; // Where the next record goes
+static uint16_t arena_tail = 0; // Oldest record
+static uint16_t arena_wrap = 0; // End of the records before the head wrapped
+static bool arena_wrapped = false; // Records run tail..wrap, then 0..head
+static int arena_records = 0;
+static user_chat_log_t chat_logs[MAX_USERS] = {
+    [0 ... MAX_USERS - 1] = {.first = CHAT_LOG_NONE, .last = CHAT_LOG_NONE}};
+static SemaphoreHandle_t log_mutex = NULL; // Serializes writers
+static atomic_uint generation;             // Odd while a writer is active
+
+static chat_log_rec_t *rec_at(uint16_t off) {
+  return (chat_log_rec_t *)(arena + off);
+}
+
+static chat_log_span_t *rec_spans(chat_log_rec_t *rec) {
+  return (chat_log_span_t *)(rec + 1);
+}
+
+static char *rec_text(chat_log_rec_t *rec) {
+  return (char *)(rec_spans(rec) + rec->line_count);
+}
+
+// Enter / leave a change of the log (seqlock writer side)
+static void write_begin(void) {
+  if (log_mutex)
+    xSemaphoreTake(log_mutex, portMAX_DELAY);
+  atomic_fetch_add_explicit(&generation, 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+}
+
+static void write_end(void) {
+  atomic_fetch_add_explicit(&generation, 1, memory_order_release);
+  if (log_mutex)
+    xSemaphoreGive(log_mutex);
+}
 
 void chat_log_init(void) {
+  if (!log_mutex)
+    log_mutex = xSemaphoreCreateMutex();
+
+  write_begin();
+  arena_head = 0;
+  arena_tail = 0;
+  arena_wrap = 0;
+  arena_wrapped = false;
+  arena_records = 0;
   for (int i = 0; i < MAX_USERS; i++) {
-    chat_logs[i].head = 0;
+    chat_logs[i].first = CHAT_LOG_NONE;
+    chat_logs[i].last = CHAT_LOG_NONE;
     chat_logs[i].count = 0;
-    for (int j = 0; j < MAX_CHAT_PER_USER; j++) {
-      chat_logs[i].messages[j][0] = '\0';
+    chat_logs[i].total_lines = 0;
+    chat_logs[i].evicted_lines = 0;
+  }
+  write_end();
+}
+
+// Drop the oldest record in the arena; it is always the first of its user
+static void arena_evict(void) {
+  chat_log_rec_t *rec = rec_at(arena_tail);
+  if (!(rec->flags & REC_FLAG_DEAD)) {
+    user_chat_log_t *log = &chat_logs[rec->user];
+    log->first = rec->next;
+    if (log->first == CHAT_LOG_NONE)
+      log->last = CHAT_LOG_NONE;
+    log->count--;
+    log->total_lines -= rec->line_count;
+    log->evicted_lines += rec->line_count;
+  }
+
+  arena_tail += REC_SIZE(rec->line_count, rec->len);
+  arena_records--;
+  if (arena_records == 0) {
+    arena_head = arena_tail = 0;
+    arena_wrapped = false;
+  } else if (arena_wrapped && arena_tail == arena_wrap) {
+    arena_tail = 0;
+    arena_wrapped = false;
+  }
+}
+
+// Reserve size bytes, evicting the oldest records until they fit
+static uint16_t arena_alloc(size_t size) {
+  for (;;) {
+    if (arena_wrapped) {
+      if (arena_head + size <= arena_tail)
+        break;
+    } else if (arena_head + size <= CHAT_LOG_ARENA_SIZE) {
+      break;
+    } else if (size <= arena_tail) {
+      // Not enough room at the end: continue at the start
+      arena_wrap = arena_head;
+      arena_head = 0;
+      arena_wrapped = true;
+      break;
+    }
+    arena_evict();
+  }
+
+  uint16_t off = arena_head;
+  arena_head += size;
+  arena_records++;
+  return off;
+}
+
+// Word-wrap text into at most CHAT_LOG_MAX_LINES lines of
+// CHAT_LOG_WRAP_WIDTH columns, keeping reserve columns free on the last line.
+// Words longer than a line are split.
+static uint8_t chat_log_layout(const char *text, size_t len, size_t reserve,
+                               chat_log_span_t lines[]) {
+  const size_t width = CHAT_LOG_WRAP_WIDTH;
+  uint8_t n = 0;
+  size_t pos = 0;
+
+  while (pos < len && n < CHAT_LOG_MAX_LINES) {
+    size_t rest = len - pos;
+    size_t take = 0;
+
+    if (rest + reserve <= width || n == CHAT_LOG_MAX_LINES - 1) {
+      // Last line (truncated if the line budget ran out)
+      take = (rest < width - reserve) ? rest : width - reserve;
+    } else {
+      // Break at the last space that keeps the line within the width; when
+      // the rest would fit but for the reserve, leave its last word over
+      size_t limit = (rest > width) ? width : rest - 1;
+      for (size_t i = limit; i > 0; i--) {
+        if (text[pos + i] == ' ') {
+          take = i;
+          break;
+        }
+      }
+      if (take == 0)
+        take = (rest > width) ? width : width - reserve;
     }
+
+    lines[n].start = (uint8_t)pos;
+    lines[n].len = (uint8_t)take;
+    n++;
+
+    pos += take;
+    while (pos < len && text[pos] == ' ')
+      pos++;
+  }
+
+  if (n == 0) {
+    // Empty message still takes one line
+    lines[0].start = 0;
+    lines[0].len = 0;
+    n = 1;
   }
+  return n;
 }
 
-void chat_log_add(int user_idx, const char *msg, bool outgoing) {
-  if (user_idx < 0 || user_idx >= MAX_USERS || !msg)
+void chat_log_clear_peer(peer_id_t peer) {
+  user_table_lock(); // Already held when called for an eviction
+  int user_idx = user_table_index_of(peer);
+  if (user_idx < 0) {
+    user_table_unlock();
     return;
+  }
 
+  write_begin();
   user_chat_log_t *log = &chat_logs[user_idx];
+  for (uint16_t off = log->first; off != CHAT_LOG_NONE;
+       off = rec_at(off)->next) {
+    rec_at(off)->flags |= REC_FLAG_DEAD;
+  }
+  log->first = CHAT_LOG_NONE;
+  log->last = CHAT_LOG_NONE;
+  log->count = 0;
+  log->total_lines = 0;
+  log->evicted_lines = 0;
+  write_end();
+  user_table_unlock();
+}
+
+void chat_log_add(peer_id_t peer, const char *msg, bool outgoing) {
+  if (!msg)
+    return;
+
+  chat_log_add_n(peer, msg, strlen(msg), outgoing);
+}
+
+// Append a record (writer lock held)
+static const char *chat_log_append(int user_idx, const char *msg, size_t len,
+                                   bool outgoing, uint8_t msg_id,
+                                   delivery_state_t state) {
+  // Format and lay out on the stack first: the record size depends on both
+  char entry[MAX_MESSAGE_LEN];
   if (outgoing) {
-    snprintf(log->messages[log->head], MAX_MESSAGE_LEN, "You: %s", msg);
+    snprintf(entry, sizeof(entry), "You: %.*s", (int)len, msg);
+    len = strlen(entry);
   } else {
-    strncpy(log->messages[log->head], msg, MAX_MESSAGE_LEN);
-    log->messages[log->head][MAX_MESSAGE_LEN - 1] =
-        '\0'; // ensure null termination
+    if (len > MAX_MESSAGE_LEN - 1)
+      len = MAX_MESSAGE_LEN - 1;
+    memcpy(entry, msg, len);
   }
 
-  log->head = (log->head + 1) % MAX_CHAT_PER_USER;
-  if (log->count < MAX_CHAT_PER_USER)
-    log->count++;
-}
+  // Outgoing messages get a delivery marker after their last line
+  chat_log_span_t layout[CHAT_LOG_MAX_LINES];
+  uint8_t line_count = chat_log_layout(
+      entry, len, outgoing ? CHAT_LOG_MARKER_WIDTH : 0, layout);
 
-int chat_log_get(int user_idx, char out_buf[][MAX_MESSAGE_LEN + 1],
-                 int max_msgs) {
-  if (user_idx < 0 || user_idx >= MAX_USERS || !out_buf || max_msgs <= 0)
-    return 0;
+  uint16_t off = arena_alloc(REC_SIZE(line_count, len));
+  chat_log_rec_t *rec = rec_at(off);
+  rec->next = CHAT_LOG_NONE;
+  rec->user = (uint8_t)user_idx;
+  rec->len = (uint8_t)len;
+  rec->msg_id = msg_id;
+  rec->state = state;
+  rec->line_count = line_count;
+  rec->flags = 0;
+  memcpy(rec_spans(rec), layout, line_count * sizeof(chat_log_span_t));
+  char *text = rec_text(rec);
+  memcpy(text, entry, len);
+  text[len] = '\0';
 
+  // Allocation may have evicted records of this user, so link last
   user_chat_log_t *log = &chat_logs[user_idx];
+  if (log->last == CHAT_LOG_NONE)
+    log->first = off;
+  else
+    rec_at(log->last)->next = off;
+  log->last = off;
+  log->count++;
+  log->total_lines += line_count;
 
-  if (log->count == 0)
-    return 0;
+  return text;
+}
 
-  // Number of messages to return (min of max_msgs or log->count)
-  int num_to_copy = (log->count < max_msgs) ? log->count : max_msgs;
+// Writers hold the user table lock from resolving the handle until the
+// record is linked, so the entry cannot be given to another peer (whose
+// log the record would land in) in between. Lock order: table, then log.
 
-  // Calculate start index for last N messages
-  int start_idx;
-  if (log->count < MAX_CHAT_PER_USER) {
-    start_idx = log->count - num_to_copy;
-  } else {
-    // log full, use circular buffer math
-    start_idx =
-        (log->head + MAX_CHAT_PER_USER - num_to_copy) % MAX_CHAT_PER_USER;
+const char *chat_log_add_n(peer_id_t peer, const char *msg, size_t len,
+                           bool outgoing) {
+  if (!msg)
+    return NULL;
+
+  const char *text = NULL;
+  user_table_lock();
+  int user_idx = user_table_index_of(peer);
+  if (user_idx >= 0) {
+    write_begin();
+    text = chat_log_append(user_idx, msg, len, outgoing, 0, DELIVERY_NONE);
+    write_end();
+  }
+  user_table_unlock();
+  return text;
+}
+
+void chat_log_add_outgoing(peer_id_t peer, const char *msg, uint8_t msg_id) {
+  if (!msg)
+    return;
+
+  user_table_lock();
+  int user_idx = user_table_index_of(peer);
+  if (user_idx >= 0) {
+    write_begin();
+    chat_log_append(user_idx, msg, strlen(msg), true, msg_id,
+                    DELIVERY_QUEUED);
+    write_end();
+  }
+  user_table_unlock();
+}
+
+bool chat_log_set_delivery(peer_id_t peer, uint8_t msg_id,
+                           delivery_state_t state) {
+  if (msg_id == 0)
+    return false;
+
+  bool found = false;
+  user_table_lock();
+  int user_idx = user_table_index_of(peer);
+  if (user_idx >= 0) {
+    write_begin();
+    for (uint16_t off = chat_logs[user_idx].first; off != CHAT_LOG_NONE;
+         off = rec_at(off)->next) {
+      chat_log_rec_t *rec = rec_at(off);
+      if (rec->msg_id == msg_id && rec->state != DELIVERY_NONE) {
+        rec->state = state;
+        found = true;
+        break;
+      }
+    }
+    write_end();
   }
+  user_table_unlock();
+  return found;
+}
+
+uint32_t chat_log_generation(void) {
+  return atomic_load_explicit(&generation, memory_order_acquire);
+}
 
-  // Copy in order
-  for (int i = 0; i < num_to_copy; i++) {
-    int idx = (start_idx + i) % MAX_CHAT_PER_USER;
-    strncpy(out_buf[i], log->messages[idx], MAX_MESSAGE_LEN);
-    out_buf[i][MAX_MESSAGE_LEN] = '\0';
+bool chat_log_unchanged(uint32_t gen) {
+  atomic_thread_fence(memory_order_acquire);
+  return (gen & 1) == 0 &&
+         atomic_load_explicit(&generation, memory_order_relaxed) == gen;
+}
+
+void chat_log_iter_begin(peer_id_t peer, chat_log_iter_t *it) {
+  // Generation first: evicting the peer clears its log, so an eviction
+  // after the handle resolved makes the cursor invalid
+  it->gen = chat_log_generation();
+  int user_idx = user_table_index_of(peer);
+  it->next = (user_idx >= 0) ? chat_logs[user_idx].first : CHAT_LOG_NONE;
+}
+
+bool chat_log_iter_next(chat_log_iter_t *it, chat_log_entry_t *out) {
+  // A writer may be reusing the arena under us: never follow an offset out
+  // of it. What was read is then stale, which chat_log_iter_valid() tells.
+  uint16_t off = it->next;
+  if (off == CHAT_LOG_NONE || (off & 1) ||
+      off > CHAT_LOG_ARENA_SIZE - sizeof(chat_log_rec_t))
+    return false;
+
+  chat_log_rec_t *rec = rec_at(off);
+  uint8_t line_count = rec->line_count;
+  uint8_t len = rec->len;
+  if (line_count > CHAT_LOG_MAX_LINES || len >= MAX_MESSAGE_LEN ||
+      off + REC_SIZE(line_count, len) > CHAT_LOG_ARENA_SIZE)
+    return false;
+
+  out->lines = rec_spans(rec);
+  out->line_count = line_count;
+  out->text = (const char *)(out->lines + line_count);
+  out->len = len;
+  out->state = (delivery_state_t)rec->state;
+  it->next = rec->next;
+  return true;
+}
+
+bool chat_log_iter_valid(const chat_log_iter_t *it) {
+  return chat_log_unchanged(it->gen);
+}
+
+int chat_log_line_count(peer_id_t peer) {
+  user_table_lock();
+  int user_idx = user_table_index_of(peer);
+  int lines = (user_idx >= 0) ? chat_logs[user_idx].total_lines : 0;
+  user_table_unlock();
+  return lines;
+}
+
+uint32_t chat_log_evicted_lines(peer_id_t peer) {
+  user_table_lock();
+  int user_idx = user_table_index_of(peer);
+  uint32_t lines = (user_idx >= 0) ? chat_logs[user_idx].evicted_lines : 0;
+  user_table_unlock();
+  return lines;
+}
+
+int chat_log_get_lines(peer_id_t peer, int first, chat_log_line_t out[],
+                       int max_lines) {
+  if (!out || max_lines <= 0 || first < 0)
+    return 0;
+
+  chat_log_iter_t it;
+  chat_log_entry_t entry;
+  int n = 0;
+
+  // Skip whole messages before the window, then walk their cached lines
+  chat_log_iter_begin(peer, &it);
+  while (n < max_lines && chat_log_iter_next(&it, &entry)) {
+    if (first >= entry.line_count) {
+      first -= entry.line_count;
+      continue;
+    }
+
+    for (int l = first; l < entry.line_count && n < max_lines; l++) {
+      // Spans are clamped: the record may be rewritten while we read it
+      uint8_t start = entry.lines[l].start;
+      uint8_t len = entry.lines[l].len;
+      if (start > entry.len)
+        start = entry.len;
+      if (len > entry.len - start)
+        len = entry.len - start;
+      out[n].text = entry.text + start;
+      out[n].len = len;
+      out[n].last = (l == entry.line_count - 1);
+      out[n].state = entry.state;
+      n++;
+    }
+    first = 0;
   }
 
-  return num_to_copy;
+  return n;
 }
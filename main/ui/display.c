@@ -1,5 +1,8 @@
 #include "display.h"
+#include "esp_attr.h"
+#include "font6x8.h"
 #include "ssd1306.h"
+#include <stdio.h>
 #include <string.h>
 
 static const char *TAG = "DISPLAY";
@@ -11,15 +14,94 @@ static display_mode_t current_mode = DISPLAY_MODE_MENU;
 static char current_lines[MAX_DISPLAY_LINES][MAX_CHARS_PER_LINE + 1];
 static bool line_has_cursor[MAX_DISPLAY_LINES] = {false};
 
+// Local framebuffer in SSD1306 page layout (one byte = 8 vertical pixels)
+static uint8_t framebuffer[MAX_DISPLAY_LINES][DISPLAY_WIDTH];
+// Columns drawn since the last display_update(), per page (lo > hi = clean)
+static uint8_t dirty_lo[MAX_DISPLAY_LINES];
+static uint8_t dirty_hi[MAX_DISPLAY_LINES];
+// Pages the content moved up (negative: down) since the last display_update()
+static int scroll_pages = 0;
+
+// Snapshot handed from the UI to the display task. Only the bytes inside
+// the dirty range of a page are valid.
+typedef struct {
+  uint8_t pages[MAX_DISPLAY_LINES][DISPLAY_WIDTH];
+  uint8_t dirty_lo[MAX_DISPLAY_LINES];
+  uint8_t dirty_hi[MAX_DISPLAY_LINES];
+  int scroll; // Pages to shift the panel up before sending the spans
+} display_frame_t;
+
+// Double buffering: the UI fills *pending while the task streams *active
+static display_frame_t frames[2];
+static display_frame_t *pending = &frames[0];
+static display_frame_t *active = &frames[1];
+static bool pending_ready = false;
+
+// Owned by the display task: what the panel shows, so unchanged columns are
+// never resent, and one I2C buffer per page for queued transactions
+static uint8_t panel[MAX_DISPLAY_LINES][DISPLAY_WIDTH];
+static bool panel_valid = false;
+static uint8_t span_buf[MAX_DISPLAY_LINES]
+                       [DISPLAY_SPAN_HEADER_SIZE + DISPLAY_WIDTH];
+// Display start line, in pages: RAM page shown on physical page p is
+// (p + panel_offset) % 8
+static int panel_offset = 0;
+static uint8_t start_line_buf[2];
+
+static TaskHandle_t display_task_handle = NULL;
+static SemaphoreHandle_t i2c_done_sem = NULL; // Given per finished transfer
+static bool i2c_async = false;
+
+static display_stats_t stats;
+
 // ✅ Concurrency safety
 static SemaphoreHandle_t display_mutex = NULL;
 
-// ✅ Thread-safe SSD1306 wrapper functions
+static void mark_range(uint8_t *lo_arr, uint8_t *hi_arr, int page, int lo,
+                       int hi) {
+  if (lo < lo_arr[page])
+    lo_arr[page] = lo;
+  if (hi > hi_arr[page])
+    hi_arr[page] = hi;
+}
+
+static void fb_mark_dirty(int page, int lo, int hi) {
+  mark_range(dirty_lo, dirty_hi, page, lo, hi);
+}
+
+// Glyph table matching the panel orientation, chosen once at init
+static const uint8_t (*font)[FONT6X8_WIDTH] = font6x8;
+
+// ✅ Thread-safe framebuffer drawing (6x8 font, 21 chars per page)
 static esp_err_t safe_ssd1306_display_text(int page, const char *text,
                                            size_t len, bool invert) {
+  if (len > MAX_CHARS_PER_LINE)
+    len = MAX_CHARS_PER_LINE;
+  if (len == 0)
+    return ESP_OK;
+
   esp_err_t ret = ESP_FAIL;
   if (xSemaphoreTake(display_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-    ssd1306_display_text(&dev, page, text, len, invert);
+    uint8_t mask = invert ? 0xFF : 0x00;
+    uint8_t *dst = framebuffer[page];
+    for (size_t i = 0; i < len; i++) {
+      unsigned idx = (uint8_t)text[i] - FONT6X8_FIRST;
+      if (idx >= FONT6X8_COUNT)
+        idx = FONT6X8_FALLBACK - FONT6X8_FIRST;
+
+      const uint8_t *glyph = font[idx];
+      for (int col = 0; col < FONT6X8_WIDTH; col++) {
+        *dst++ = glyph[col] ^ mask;
+      }
+    }
+    // 21 cells cover 126 of the 128 columns: a full line also owns the
+    // two right-edge columns, so banners stay solid and nothing is stale
+    int hi = len * CHAR_WIDTH - 1;
+    if (len == MAX_CHARS_PER_LINE) {
+      memset(dst, mask, DISPLAY_WIDTH - len * CHAR_WIDTH);
+      hi = DISPLAY_WIDTH - 1;
+    }
+    fb_mark_dirty(page, 0, hi);
     ret = ESP_OK;
     xSemaphoreGive(display_mutex);
   } else {
@@ -31,7 +113,10 @@ static esp_err_t safe_ssd1306_display_text(int page, const char *text,
 static esp_err_t safe_ssd1306_clear_screen(bool invert) {
   esp_err_t ret = ESP_FAIL;
   if (xSemaphoreTake(display_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-    ssd1306_clear_screen(&dev, invert);
+    memset(framebuffer, invert ? 0xFF : 0x00, sizeof(framebuffer));
+    for (int page = 0; page < MAX_DISPLAY_LINES; page++) {
+      fb_mark_dirty(page, 0, DISPLAY_WIDTH - 1);
+    }
     ret = ESP_OK;
     xSemaphoreGive(display_mutex);
   } else {
@@ -40,6 +125,189 @@ static esp_err_t safe_ssd1306_clear_screen(bool invert) {
   return ret;
 }
 
+// Queue one column span of a page as a single I2C transaction: the address
+// commands are sent as single commands (Co = 1) ahead of the data stream.
+// In async mode span_buf[page] must stay untouched until the transfer ends.
+static esp_err_t display_send_span(int page, int seg, int width,
+                                   const uint8_t *data, size_t *sent) {
+  uint8_t *out_buf = span_buf[page];
+
+  int col = seg + CONFIG_OFFSETX;
+  int out_page = dev._flip ? (MAX_DISPLAY_LINES - 1 - page) : page;
+  out_page = (out_page + panel_offset) % MAX_DISPLAY_LINES;
+
+  size_t idx = 0;
+  out_buf[idx++] = OLED_CONTROL_BYTE_CMD_SINGLE;
+  out_buf[idx++] = 0x00 | (col & 0x0F); // lower column start address
+  out_buf[idx++] = OLED_CONTROL_BYTE_CMD_SINGLE;
+  out_buf[idx++] = 0x10 | ((col >> 4) & 0x0F); // higher column start address
+  out_buf[idx++] = OLED_CONTROL_BYTE_CMD_SINGLE;
+  out_buf[idx++] = 0xB0 | out_page; // page start address
+  out_buf[idx++] = OLED_CONTROL_BYTE_DATA_STREAM;
+  memcpy(&out_buf[idx], data, width);
+  idx += width;
+
+  *sent = idx;
+  return i2c_master_transmit(dev._i2c_dev_handle, out_buf, idx,
+                             DISPLAY_I2C_TIMEOUT_MS);
+}
+
+static void panel_reverse(int lo, int hi) {
+  uint8_t tmp[DISPLAY_WIDTH];
+  for (; lo < hi; lo++, hi--) {
+    memcpy(tmp, panel[lo], DISPLAY_WIDTH);
+    memcpy(panel[lo], panel[hi], DISPLAY_WIDTH);
+    memcpy(panel[hi], tmp, DISPLAY_WIDTH);
+  }
+}
+
+// Shift the panel view up by pages (negative: down) with one start line
+// command. The shadow is rotated to match, so only pages whose content
+// really changed are resent.
+static esp_err_t display_send_start_line(int pages, size_t *sent) {
+  // Flipped panels are mirrored in software: logical up is physical down
+  int step = dev._flip ? -pages : pages;
+  int offset = ((panel_offset + step) % MAX_DISPLAY_LINES + MAX_DISPLAY_LINES) %
+               MAX_DISPLAY_LINES;
+
+  start_line_buf[0] = OLED_CONTROL_BYTE_CMD_SINGLE;
+  start_line_buf[1] = OLED_CMD_SET_DISPLAY_START_LINE | (offset * 8);
+  *sent = sizeof(start_line_buf);
+  esp_err_t ret =
+      i2c_master_transmit(dev._i2c_dev_handle, start_line_buf,
+                          sizeof(start_line_buf), DISPLAY_I2C_TIMEOUT_MS);
+  if (ret != ESP_OK)
+    return ret;
+
+  // Rotate the shadow left by r pages (three reversals, no page-sized copy)
+  int r = ((pages % MAX_DISPLAY_LINES) + MAX_DISPLAY_LINES) % MAX_DISPLAY_LINES;
+  panel_offset = offset;
+  panel_reverse(0, r - 1);
+  panel_reverse(r, MAX_DISPLAY_LINES - 1);
+  panel_reverse(0, MAX_DISPLAY_LINES - 1);
+  return ESP_OK;
+}
+
+// Completion of a queued transfer (ISR context)
+static bool IRAM_ATTR display_i2c_done_cb(i2c_master_dev_handle_t i2c_dev,
+                                          const i2c_master_event_data_t *evt,
+                                          void *arg) {
+  BaseType_t woken = pdFALSE;
+  xSemaphoreGiveFromISR(i2c_done_sem, &woken);
+  return woken == pdTRUE;
+}
+
+// Send the changed spans of a snapshot, all queued before waiting
+static void display_stream_frame(const display_frame_t *frame) {
+  int queued = 0;
+  uint32_t bytes = 0;
+
+  // Queued ahead of the spans, which are addressed with the new offset
+  if (frame->scroll % MAX_DISPLAY_LINES != 0) {
+    size_t sent = 0;
+    if (display_send_start_line(frame->scroll, &sent) == ESP_OK) {
+      queued++;
+      bytes += sent;
+    } else {
+      // Panel keeps the old offset; the spans below resend every change
+      ESP_LOGE(TAG, "I2C write of start line failed");
+    }
+  }
+
+  for (int page = 0; page < MAX_DISPLAY_LINES; page++) {
+    int lo = frame->dirty_lo[page];
+    int hi = frame->dirty_hi[page];
+    if (lo > hi)
+      continue;
+
+    // Trim the span to the columns that differ from the panel
+    if (panel_valid) {
+      while (lo <= hi && frame->pages[page][lo] == panel[page][lo])
+        lo++;
+      while (hi >= lo && frame->pages[page][hi] == panel[page][hi])
+        hi--;
+      if (lo > hi)
+        continue;
+    }
+
+    size_t sent = 0;
+    if (display_send_span(page, lo, hi - lo + 1, &frame->pages[page][lo],
+                          &sent) != ESP_OK) {
+      ESP_LOGE(TAG, "I2C write of page %d failed", page);
+      // Resent with the next frame the UI submits
+      xSemaphoreTake(display_mutex, portMAX_DELAY);
+      fb_mark_dirty(page, lo, hi);
+      xSemaphoreGive(display_mutex);
+      continue;
+    }
+    memcpy(&panel[page][lo], &frame->pages[page][lo], hi - lo + 1);
+    queued++;
+    bytes += sent;
+  }
+  panel_valid = true;
+
+  // Span buffers are reused by the next frame
+  for (int i = 0; i2c_async && i < queued; i++) {
+    if (xSemaphoreTake(i2c_done_sem,
+                       pdMS_TO_TICKS(DISPLAY_I2C_TIMEOUT_MS)) != pdTRUE) {
+      ESP_LOGW(TAG, "I2C transfer did not complete");
+      break;
+    }
+  }
+
+  if (queued > 0) {
+    xSemaphoreTake(display_mutex, portMAX_DELAY);
+    stats.flushes++;
+    if (frame->scroll % MAX_DISPLAY_LINES != 0)
+      stats.scrolls++;
+    stats.transactions += queued;
+    stats.bytes += bytes;
+    stats.last_transactions = queued;
+    stats.last_bytes = bytes;
+    if (bytes > stats.max_bytes)
+      stats.max_bytes = bytes;
+    xSemaphoreGive(display_mutex);
+    ESP_LOGD(TAG, "Flush: %d transactions, %lu bytes", queued,
+             (unsigned long)bytes);
+  }
+}
+
+// Display service task: the only user of the SSD1306 handle after init
+static void display_task(void *pvParameters) {
+  while (1) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    xSemaphoreTake(display_mutex, portMAX_DELAY);
+    if (!pending_ready) {
+      xSemaphoreGive(display_mutex);
+      continue;
+    }
+    display_frame_t *frame = pending;
+    pending = active;
+    active = frame;
+    pending_ready = false;
+    xSemaphoreGive(display_mutex);
+
+    display_stream_frame(active);
+  }
+}
+
+// Own the I2C bus (the library's i2c_master_init() has no transaction
+// queue, which async transfers need)
+static void display_i2c_init(void) {
+  i2c_master_bus_config_t bus_config = {
+      .clk_source = I2C_CLK_SRC_DEFAULT,
+      .glitch_ignore_cnt = 7,
+      .i2c_port = I2C_MASTER_NUM,
+      .scl_io_num = I2C_MASTER_SCL_IO,
+      .sda_io_num = I2C_MASTER_SDA_IO,
+      .trans_queue_depth = DISPLAY_I2C_QUEUE_DEPTH,
+      .flags.enable_internal_pullup = true,
+  };
+  ESP_ERROR_CHECK(i2c_new_master_bus(&bus_config, &dev._i2c_bus_handle));
+  i2c_device_add(&dev, I2C_MASTER_NUM, -1, SSD1306_I2C_ADDRESS);
+}
+
 void display_init(void) {
   ESP_LOGI(TAG, "Initializing SSD1306 display for MeshTalk...");
 
@@ -50,24 +318,44 @@ void display_init(void) {
     return;
   }
 
-  // Let SSD1306 library handle all I2C initialization (ESP-IDF v5+ compatible)
-  ESP_LOGI(
-      TAG,
-      "Using SSD1306 library I2C initialization (ESP-IDF v5+ compatible)...");
-
-  // Initialize SSD1306 - library handles I2C setup automatically
-  i2c_master_init(&dev, I2C_MASTER_SDA_IO, I2C_MASTER_SCL_IO, -1);
-  ESP_LOGI(TAG, "✅ SSD1306 I2C initialized by library");
+  display_i2c_init();
+  ESP_LOGI(TAG, "✅ SSD1306 I2C initialized");
 
+  // Library init runs with blocking transfers, before the callback exists
   ssd1306_init(&dev, DISPLAY_WIDTH, DISPLAY_HEIGHT);
   ESP_LOGI(TAG, "✅ SSD1306 display initialized");
+  font = dev._flip ? font6x8_flipped : font6x8;
+
+  // From here on transfers are queued and complete in the background
+  i2c_done_sem = xSemaphoreCreateCounting(DISPLAY_I2C_QUEUE_DEPTH, 0);
+  const i2c_master_event_callbacks_t i2c_cbs = {
+      .on_trans_done = display_i2c_done_cb,
+  };
+  if (i2c_done_sem && i2c_master_register_event_callbacks(
+                          dev._i2c_dev_handle, &i2c_cbs, NULL) == ESP_OK) {
+    i2c_async = true;
+  } else {
+    ESP_LOGW(TAG, "Async I2C unavailable, using blocking transfers");
+  }
+
+  if (xTaskCreate(display_task, "display", DISPLAY_TASK_STACK_SIZE, NULL,
+                  DISPLAY_TASK_PRIORITY, &display_task_handle) != pdPASS) {
+    ESP_LOGE(TAG, "Failed to create display task");
+    return;
+  }
 
   // Clear and initialize tracking
+  memset(dirty_lo, 0xFF, sizeof(dirty_lo));
+  memset(dirty_hi, 0x00, sizeof(dirty_hi));
+  memset(frames[0].dirty_lo, 0xFF, sizeof(frames[0].dirty_lo));
+  memset(frames[1].dirty_lo, 0xFF, sizeof(frames[1].dirty_lo));
+  panel_valid = false;
   safe_ssd1306_clear_screen(false);
   memset(current_lines, 0, sizeof(current_lines));
   memset(line_has_cursor, false, sizeof(line_has_cursor));
 
   display_initialized = true;
+  display_update();
   ESP_LOGI(TAG, "✅ SSD1306 display ready for MeshTalk");
 }
 
@@ -89,6 +377,11 @@ void display_set_mode(display_mode_t mode) {
 
 display_mode_t display_get_mode(void) { return current_mode; }
 
+// Remember what a line shows, for cursor moves (truncated, terminated)
+static void display_track_line(int line, const char *text) {
+  snprintf(current_lines[line], sizeof(current_lines[line]), "%s", text);
+}
+
 // ✅ TEXT ALIGNMENT HELPERS - Normal font only
 void display_center_text(int line, const char *text, bool large_font) {
   if (!display_initialized || line < 0 || line >= MAX_DISPLAY_LINES)
@@ -108,7 +401,28 @@ void display_center_text(int line, const char *text, bool large_font) {
   safe_ssd1306_display_text(line, centered_text, strlen(centered_text), false);
 
   // Update tracking
-  strncpy(current_lines[line], centered_text, MAX_CHARS_PER_LINE);
+  display_track_line(line, centered_text);
+}
+
+void display_banner_text(int line, const char *text) {
+  if (!display_initialized || line < 0 || line >= MAX_DISPLAY_LINES)
+    return;
+  int text_len = strlen(text);
+  if (text_len > MAX_CHARS_PER_LINE)
+    text_len = MAX_CHARS_PER_LINE;
+  int padding = (MAX_CHARS_PER_LINE - text_len) / 2;
+  char banner_text[MAX_CHARS_PER_LINE + 1];
+
+  // Pad both sides so the whole line is inverted
+  memset(banner_text, ' ', MAX_CHARS_PER_LINE);
+  memcpy(banner_text + padding, text, text_len);
+  banner_text[MAX_CHARS_PER_LINE] = '\0';
+
+  safe_ssd1306_display_text(line, banner_text, MAX_CHARS_PER_LINE, true);
+
+  // Update tracking
+  display_track_line(line, banner_text);
+  line_has_cursor[line] = false;
 }
 
 void display_left_text(int line, const char *text, bool large_font) {
@@ -119,7 +433,7 @@ void display_left_text(int line, const char *text, bool large_font) {
   safe_ssd1306_display_text(line, text, strlen(text), false);
 
   // Update tracking
-  strncpy(current_lines[line], text, MAX_CHARS_PER_LINE);
+  display_track_line(line, text);
 }
 
 // ✅ MENU FUNCTIONS - Normal font
@@ -141,7 +455,7 @@ void display_menu_line_large(int line, const char *text, bool has_cursor) {
   }
 
   // Update tracking
-  strncpy(current_lines[line], display_text, MAX_CHARS_PER_LINE);
+  display_track_line(line, display_text);
   line_has_cursor[line] = has_cursor;
   ESP_LOGD(TAG, "Menu line %d: %s %s", line, text,
            has_cursor ? "[CURSOR]" : "");
@@ -184,7 +498,7 @@ void display_list_line(int line, const char *text, bool has_cursor) {
   safe_ssd1306_display_text(line, display_text, strlen(display_text), false);
 
   // Update tracking
-  strncpy(current_lines[line], display_text, MAX_CHARS_PER_LINE);
+  display_track_line(line, display_text);
   line_has_cursor[line] = has_cursor;
 }
 
@@ -214,6 +528,33 @@ void display_show_list_screen(const char *title, const char *list_items[],
            item_count, cursor_pos, scroll_offset);
 }
 
+void display_show_list_rows(const char *title, int item_count,
+                            int cursor_pos, int scroll_offset,
+                            display_row_fn_t row_fn) {
+  if (!display_initialized || !row_fn)
+    return;
+  display_clear();
+
+  // Line 0: Centered title
+  display_center_text(0, title, false);
+
+  // Lines 1-7: the visible window, formatted on demand
+  int visible_items = 7;
+  for (int i = 0; i < visible_items; i++) {
+    int item_index = scroll_offset + i;
+    if (item_index < item_count) {
+      char row[MAX_CHARS_PER_LINE + 1];
+      row_fn(item_index, row, sizeof(row));
+      display_list_line(i + 1, row, item_index == cursor_pos);
+    } else {
+      display_list_line(i + 1, "", false); // Empty line
+    }
+  }
+
+  ESP_LOGD(TAG, "List rows: %s, %d items, cursor at %d, scroll %d", title,
+           item_count, cursor_pos, scroll_offset);
+}
+
 void display_show_chat_screen(const char *contact_name, const char *messages[],
                               int msg_count, int scroll_offset) {
   if (!display_initialized)
@@ -250,9 +591,9 @@ void display_move_cursor(int old_line, int new_line) {
     // Extract text without cursor prefix
     const char *src = current_lines[old_line];
     if (src[0] == '>' && src[1] == ' ') {
-      strncpy(text_only, src + 2, MAX_CHARS_PER_LINE);
+      snprintf(text_only, sizeof(text_only), "%s", src + 2);
     } else {
-      strncpy(text_only, src, MAX_CHARS_PER_LINE);
+      snprintf(text_only, sizeof(text_only), "%s", src);
     }
     if (current_mode == DISPLAY_MODE_MENU && old_line <= 7) {
       display_menu_line_large(old_line, text_only, false);
@@ -267,9 +608,9 @@ void display_move_cursor(int old_line, int new_line) {
     // Extract text without cursor prefix
     const char *src = current_lines[new_line];
     if (src[0] == ' ' && src[1] == ' ') {
-      strncpy(text_only, src + 2, MAX_CHARS_PER_LINE);
+      snprintf(text_only, sizeof(text_only), "%s", src + 2);
     } else {
-      strncpy(text_only, src, MAX_CHARS_PER_LINE);
+      snprintf(text_only, sizeof(text_only), "%s", src);
     }
     if (current_mode == DISPLAY_MODE_MENU && new_line <= 7) {
       display_menu_line_large(new_line, text_only, true);
@@ -282,7 +623,99 @@ void display_move_cursor(int old_line, int new_line) {
 void display_update(void) {
   if (!display_initialized)
     return;
-  // Most SSD1306 libraries update immediately
+
+  if (xSemaphoreTake(display_mutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+    ESP_LOGW(TAG, "Display mutex timeout on flush");
+    return;
+  }
+
+  bool changed = false;
+  for (int page = 0; page < MAX_DISPLAY_LINES; page++) {
+    changed |= dirty_lo[page] <= dirty_hi[page];
+  }
+  if (!changed) {
+    xSemaphoreGive(display_mutex);
+    return;
+  }
+
+  // The task hasn't picked up the previous snapshot yet: replace it, keeping
+  // its dirty ranges so none of its changes are lost
+  if (pending_ready) {
+    stats.frames_dropped++;
+  } else {
+    memset(pending->dirty_lo, 0xFF, sizeof(pending->dirty_lo));
+    memset(pending->dirty_hi, 0x00, sizeof(pending->dirty_hi));
+    pending->scroll = 0;
+  }
+  pending->scroll += scroll_pages;
+  scroll_pages = 0;
+
+  for (int page = 0; page < MAX_DISPLAY_LINES; page++) {
+    if (dirty_lo[page] <= dirty_hi[page]) {
+      mark_range(pending->dirty_lo, pending->dirty_hi, page, dirty_lo[page],
+                 dirty_hi[page]);
+      dirty_lo[page] = 0xFF;
+      dirty_hi[page] = 0x00;
+    }
+
+    int lo = pending->dirty_lo[page];
+    int hi = pending->dirty_hi[page];
+    if (lo <= hi) {
+      memcpy(&pending->pages[page][lo], &framebuffer[page][lo], hi - lo + 1);
+    }
+  }
+  pending_ready = true;
+  xSemaphoreGive(display_mutex);
+
+  xTaskNotifyGive(display_task_handle);
+}
+
+void display_scroll(int pages) {
+  if (!display_initialized || pages == 0)
+    return;
+
+  if (xSemaphoreTake(display_mutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+    ESP_LOGW(TAG, "Display mutex timeout on scroll");
+    return;
+  }
+  scroll_pages += pages;
+  // Every page is compared against the shifted panel on the next flush
+  for (int page = 0; page < MAX_DISPLAY_LINES; page++) {
+    fb_mark_dirty(page, 0, DISPLAY_WIDTH - 1);
+  }
+  xSemaphoreGive(display_mutex);
+}
+
+void display_get_stats(display_stats_t *out) {
+  if (!out || !display_mutex)
+    return;
+
+  xSemaphoreTake(display_mutex, portMAX_DELAY);
+  *out = stats;
+  xSemaphoreGive(display_mutex);
+}
+
+void display_print_pbm(void) {
+  if (!display_initialized)
+    return;
+
+  if (xSemaphoreTake(display_mutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+    ESP_LOGW(TAG, "Display mutex timeout on dump");
+    return;
+  }
+
+  char row[DISPLAY_WIDTH + 1];
+  printf("P1\n%d %d\n", DISPLAY_WIDTH, DISPLAY_HEIGHT);
+  for (int y = 0; y < DISPLAY_HEIGHT; y++) {
+    // Flipped panels hold bit-reversed pages
+    int bit = dev._flip ? 7 - (y % 8) : y % 8;
+    for (int x = 0; x < DISPLAY_WIDTH; x++) {
+      row[x] = (framebuffer[y / 8][x] >> bit) & 1 ? '1' : '0';
+    }
+    row[DISPLAY_WIDTH] = '\0';
+    printf("%s\n", row);
+  }
+  xSemaphoreGive(display_mutex);
 }
 
 bool display_is_ready(void) { return display_initialized; }
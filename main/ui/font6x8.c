@@ -0,0 +1,115 @@
+#include "font6x8.h"
+
+// Glyph columns, expanded twice below (as is and bit-reversed)
+#define FONT6X8_GLYPHS(X)                                                      \
+  X(0x00, 0x00, 0x00, 0x00, 0x00) /* 0x20 space */                             \
+  X(0x00, 0x00, 0x5F, 0x00, 0x00) /* 0x21 ! */                                 \
+  X(0x00, 0x07, 0x00, 0x07, 0x00) /* 0x22 " */                                 \
+  X(0x14, 0x7F, 0x14, 0x7F, 0x14) /* 0x23 # */                                 \
+  X(0x24, 0x2A, 0x7F, 0x2A, 0x12) /* 0x24 $ */                                 \
+  X(0x23, 0x13, 0x08, 0x64, 0x62) /* 0x25 % */                                 \
+  X(0x36, 0x49, 0x55, 0x22, 0x50) /* 0x26 & */                                 \
+  X(0x00, 0x05, 0x03, 0x00, 0x00) /* 0x27 ' */                                 \
+  X(0x00, 0x1C, 0x22, 0x41, 0x00) /* 0x28 ( */                                 \
+  X(0x00, 0x41, 0x22, 0x1C, 0x00) /* 0x29 ) */                                 \
+  X(0x14, 0x08, 0x3E, 0x08, 0x14) /* 0x2A * */                                 \
+  X(0x08, 0x08, 0x3E, 0x08, 0x08) /* 0x2B + */                                 \
+  X(0x00, 0x50, 0x30, 0x00, 0x00) /* 0x2C , */                                 \
+  X(0x08, 0x08, 0x08, 0x08, 0x08) /* 0x2D - */                                 \
+  X(0x00, 0x60, 0x60, 0x00, 0x00) /* 0x2E . */                                 \
+  X(0x20, 0x10, 0x08, 0x04, 0x02) /* 0x2F / */                                 \
+  X(0x3E, 0x51, 0x49, 0x45, 0x3E) /* 0x30 0 */                                 \
+  X(0x00, 0x42, 0x7F, 0x40, 0x00) /* 0x31 1 */                                 \
+  X(0x42, 0x61, 0x51, 0x49, 0x46) /* 0x32 2 */                                 \
+  X(0x21, 0x41, 0x45, 0x4B, 0x31) /* 0x33 3 */                                 \
+  X(0x18, 0x14, 0x12, 0x7F, 0x10) /* 0x34 4 */                                 \
+  X(0x27, 0x45, 0x45, 0x45, 0x39) /* 0x35 5 */                                 \
+  X(0x3C, 0x4A, 0x49, 0x49, 0x30) /* 0x36 6 */                                 \
+  X(0x01, 0x71, 0x09, 0x05, 0x03) /* 0x37 7 */                                 \
+  X(0x36, 0x49, 0x49, 0x49, 0x36) /* 0x38 8 */                                 \
+  X(0x06, 0x49, 0x49, 0x29, 0x1E) /* 0x39 9 */                                 \
+  X(0x00, 0x36, 0x36, 0x00, 0x00) /* 0x3A : */                                 \
+  X(0x00, 0x56, 0x36, 0x00, 0x00) /* 0x3B ; */                                 \
+  X(0x08, 0x14, 0x22, 0x41, 0x00) /* 0x3C < */                                 \
+  X(0x14, 0x14, 0x14, 0x14, 0x14) /* 0x3D = */                                 \
+  X(0x00, 0x41, 0x22, 0x14, 0x08) /* 0x3E > */                                 \
+  X(0x02, 0x01, 0x51, 0x09, 0x06) /* 0x3F ? */                                 \
+  X(0x32, 0x49, 0x79, 0x41, 0x3E) /* 0x40 @ */                                 \
+  X(0x7E, 0x11, 0x11, 0x11, 0x7E) /* 0x41 A */                                 \
+  X(0x7F, 0x49, 0x49, 0x49, 0x36) /* 0x42 B */                                 \
+  X(0x3E, 0x41, 0x41, 0x41, 0x22) /* 0x43 C */                                 \
+  X(0x7F, 0x41, 0x41, 0x22, 0x1C) /* 0x44 D */                                 \
+  X(0x7F, 0x49, 0x49, 0x49, 0x41) /* 0x45 E */                                 \
+  X(0x7F, 0x09, 0x09, 0x09, 0x01) /* 0x46 F */                                 \
+  X(0x3E, 0x41, 0x49, 0x49, 0x7A) /* 0x47 G */                                 \
+  X(0x7F, 0x08, 0x08, 0x08, 0x7F) /* 0x48 H */                                 \
+  X(0x00, 0x41, 0x7F, 0x41, 0x00) /* 0x49 I */                                 \
+  X(0x20, 0x40, 0x41, 0x3F, 0x01) /* 0x4A J */                                 \
+  X(0x7F, 0x08, 0x14, 0x22, 0x41) /* 0x4B K */                                 \
+  X(0x7F, 0x40, 0x40, 0x40, 0x40) /* 0x4C L */                                 \
+  X(0x7F, 0x02, 0x0C, 0x02, 0x7F) /* 0x4D M */                                 \
+  X(0x7F, 0x04, 0x08, 0x10, 0x7F) /* 0x4E N */                                 \
+  X(0x3E, 0x41, 0x41, 0x41, 0x3E) /* 0x4F O */                                 \
+  X(0x7F, 0x09, 0x09, 0x09, 0x06) /* 0x50 P */                                 \
+  X(0x3E, 0x41, 0x51, 0x21, 0x5E) /* 0x51 Q */                                 \
+  X(0x7F, 0x09, 0x19, 0x29, 0x46) /* 0x52 R */                                 \
+  X(0x46, 0x49, 0x49, 0x49, 0x31) /* 0x53 S */                                 \
+  X(0x01, 0x01, 0x7F, 0x01, 0x01) /* 0x54 T */                                 \
+  X(0x3F, 0x40, 0x40, 0x40, 0x3F) /* 0x55 U */                                 \
+  X(0x1F, 0x20, 0x40, 0x20, 0x1F) /* 0x56 V */                                 \
+  X(0x3F, 0x40, 0x38, 0x40, 0x3F) /* 0x57 W */                                 \
+  X(0x63, 0x14, 0x08, 0x14, 0x63) /* 0x58 X */                                 \
+  X(0x07, 0x08, 0x70, 0x08, 0x07) /* 0x59 Y */                                 \
+  X(0x61, 0x51, 0x49, 0x45, 0x43) /* 0x5A Z */                                 \
+  X(0x00, 0x7F, 0x41, 0x41, 0x00) /* 0x5B [ */                                 \
+  X(0x02, 0x04, 0x08, 0x10, 0x20) /* 0x5C backslash */                         \
+  X(0x00, 0x41, 0x41, 0x7F, 0x00) /* 0x5D ] */                                 \
+  X(0x04, 0x02, 0x01, 0x02, 0x04) /* 0x5E ^ */                                 \
+  X(0x40, 0x40, 0x40, 0x40, 0x40) /* 0x5F _ */                                 \
+  X(0x00, 0x01, 0x02, 0x04, 0x00) /* 0x60 ` */                                 \
+  X(0x20, 0x54, 0x54, 0x54, 0x78) /* 0x61 a */                                 \
+  X(0x7F, 0x48, 0x44, 0x44, 0x38) /* 0x62 b */                                 \
+  X(0x38, 0x44, 0x44, 0x44, 0x20) /* 0x63 c */                                 \
+  X(0x38, 0x44, 0x44, 0x48, 0x7F) /* 0x64 d */                                 \
+  X(0x38, 0x54, 0x54, 0x54, 0x18) /* 0x65 e */                                 \
+  X(0x08, 0x7E, 0x09, 0x01, 0x02) /* 0x66 f */                                 \
+  X(0x0C, 0x52, 0x52, 0x52, 0x3E) /* 0x67 g */                                 \
+  X(0x7F, 0x08, 0x04, 0x04, 0x78) /* 0x68 h */                                 \
+  X(0x00, 0x44, 0x7D, 0x40, 0x00) /* 0x69 i */                                 \
+  X(0x20, 0x40, 0x44, 0x3D, 0x00) /* 0x6A j */                                 \
+  X(0x7F, 0x10, 0x28, 0x44, 0x00) /* 0x6B k */                                 \
+  X(0x00, 0x41, 0x7F, 0x40, 0x00) /* 0x6C l */                                 \
+  X(0x7C, 0x04, 0x18, 0x04, 0x78) /* 0x6D m */                                 \
+  X(0x7C, 0x08, 0x04, 0x04, 0x78) /* 0x6E n */                                 \
+  X(0x38, 0x44, 0x44, 0x44, 0x38) /* 0x6F o */                                 \
+  X(0x7C, 0x14, 0x14, 0x14, 0x08) /* 0x70 p */                                 \
+  X(0x08, 0x14, 0x14, 0x18, 0x7C) /* 0x71 q */                                 \
+  X(0x7C, 0x08, 0x04, 0x04, 0x08) /* 0x72 r */                                 \
+  X(0x48, 0x54, 0x54, 0x54, 0x20) /* 0x73 s */                                 \
+  X(0x04, 0x3F, 0x44, 0x40, 0x20) /* 0x74 t */                                 \
+  X(0x3C, 0x40, 0x40, 0x20, 0x7C) /* 0x75 u */                                 \
+  X(0x1C, 0x20, 0x40, 0x20, 0x1C) /* 0x76 v */                                 \
+  X(0x3C, 0x40, 0x30, 0x40, 0x3C) /* 0x77 w */                                 \
+  X(0x44, 0x28, 0x10, 0x28, 0x44) /* 0x78 x */                                 \
+  X(0x0C, 0x50, 0x50, 0x50, 0x3C) /* 0x79 y */                                 \
+  X(0x44, 0x64, 0x54, 0x4C, 0x44) /* 0x7A z */                                 \
+  X(0x00, 0x08, 0x36, 0x41, 0x00) /* 0x7B { */                                 \
+  X(0x00, 0x00, 0x7F, 0x00, 0x00) /* 0x7C | */                                 \
+  X(0x00, 0x41, 0x36, 0x08, 0x00) /* 0x7D } */                                 \
+  X(0x10, 0x08, 0x08, 0x10, 0x08) /* 0x7E ~ */
+
+// Reverse the bit order of a byte (constant expression)
+#define REV8(b)                                                                \
+  ((((b) & 0x01) << 7) | (((b) & 0x02) << 5) | (((b) & 0x04) << 3) |          \
+   (((b) & 0x08) << 1) | (((b) & 0x10) >> 1) | (((b) & 0x20) >> 3) |          \
+   (((b) & 0x40) >> 5) | (((b) & 0x80) >> 7))
+
+#define GLYPH(c0, c1, c2, c3, c4) {c0, c1, c2, c3, c4, 0x00},
+#define GLYPH_FLIPPED(c0, c1, c2, c3, c4)                                      \
+  {REV8(c0), REV8(c1), REV8(c2), REV8(c3), REV8(c4), 0x00},
+
+const uint8_t font6x8[FONT6X8_COUNT][FONT6X8_WIDTH] = {
+    FONT6X8_GLYPHS(GLYPH)};
+
+const uint8_t font6x8_flipped[FONT6X8_COUNT][FONT6X8_WIDTH] = {
+    FONT6X8_GLYPHS(GLYPH_FLIPPED)};
@@ -1,6 +1,7 @@
 #include "joystick.h"
 #include "driver/gpio.h"
 #include "esp_adc/adc_oneshot.h"
+#include "esp_attr.h"
 #include "esp_rom_gpio.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -30,6 +31,7 @@ int32_t joystick_threshold_y_low = 1317;
 int32_t joystick_threshold_y_high = 2545;
 // Debounce
 static volatile TickType_t last_action_time = 0;
+static bool active = false;
 // static const TickType_t DEBOUNCE_DELAY = pdMS_TO_TICKS(200);
 
 // ✅ Save calibration to NVS
@@ -252,6 +254,12 @@ joystick_action_t joystick_get_action(void) {
 
   int btn = gpio_get_level(JOY_BTN_PIN);
 
+  // Raw values react a few samples before the filtered ones cross over
+  active = btn == 0 || raw_x < joystick_threshold_x_low ||
+           raw_x > joystick_threshold_x_high ||
+           raw_y < joystick_threshold_y_low ||
+           raw_y > joystick_threshold_y_high;
+
   joystick_action_t current_action = JOY_NONE;
 
   if (btn == 0) {
@@ -302,3 +310,28 @@ bool joystick_is_calibrated(void) {
   nvs_close(nvs_handle);
   return result;
 }
+
+bool joystick_is_active(void) { return active; }
+
+static void IRAM_ATTR joystick_btn_isr(void *arg) {
+  BaseType_t woken = pdFALSE;
+  vTaskNotifyGiveFromISR((TaskHandle_t)arg, &woken);
+  portYIELD_FROM_ISR(woken);
+}
+
+void joystick_enable_wakeup(TaskHandle_t task) {
+  if (!task)
+    return;
+
+  // The ISR service may already be installed by another driver
+  esp_err_t err = gpio_install_isr_service(0);
+  if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+    ESP_LOGW(TAG, "Button wakeup unavailable: %s", esp_err_to_name(err));
+    return;
+  }
+
+  gpio_set_intr_type(JOY_BTN_PIN, GPIO_INTR_NEGEDGE);
+  if (gpio_isr_handler_add(JOY_BTN_PIN, joystick_btn_isr, task) != ESP_OK) {
+    ESP_LOGW(TAG, "Failed to add button ISR");
+  }
+}
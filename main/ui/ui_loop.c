@@ -1,4 +1,5 @@
 #include "ui_loop.h"
+#include "display.h"
 #include "esp_log.h"
 #include "esp_timer.h"
 #include <string.h>
@@ -14,25 +15,50 @@ static bool ui_running = false;
 static bool ui_paused = false;
 
 // Statistics
-static uint32_t frame_count = 0;
+static uint32_t frame_count = 0; // Wakeups processed
+static uint32_t notified_count = 0;
+static uint32_t redraw_count = 0; // ui_update() calls that rebuilt a screen
 static int64_t last_update_time = 0;
 
 // Input debouncing
 static int64_t last_input_time = 0;
 
+// How long the UI task may sleep: short while the joystick is in use, long
+// at rest, longer still once nobody has touched it for a while (a button
+// press still wakes it at once), and never past the next UI timeout
+static uint32_t ui_next_wait_ms(void) {
+  int64_t since_input_ms = (esp_timer_get_time() - last_input_time) / 1000;
+  uint32_t wait_ms = UI_POLL_IDLE_MS;
+  if (joystick_is_active() || since_input_ms < UI_ACTIVE_HOLD_MS)
+    wait_ms = UI_POLL_ACTIVE_MS;
+  else if (since_input_ms >= UI_DORMANT_AFTER_MS)
+    wait_ms = UI_POLL_DORMANT_MS;
+
+  uint32_t timeout_ms = ui_next_timeout_ms();
+  return (timeout_ms < wait_ms) ? timeout_ms : wait_ms;
+}
+
 // Main UI loop task
 void ui_main_loop(void *pvParameters) {
   ESP_LOGI(TAG, "UI main loop started");
 
-  TickType_t last_wake_time = xTaskGetTickCount();
+  joystick_enable_wakeup(xTaskGetCurrentTaskHandle());
 
   while (ui_running) {
+    // ✅ Sleep until an event or the next sampling point
+    if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(ui_next_wait_ms())) > 0) {
+      notified_count++;
+    }
+
     // Check if paused
     if (xSemaphoreTake(ui_loop_mutex, pdMS_TO_TICKS(10)) == pdTRUE) {
       if (!ui_paused) {
         // ✅ Process joystick input with debouncing
         ui_process_input();
 
+        // Delivery updates recorded by the TX/RX tasks
+        ui_process_delivery_updates();
+
         // ✅ Handle timeouts (broadcast timeout, etc.)
         ui_process_timeouts();
 
@@ -45,9 +71,6 @@ void ui_main_loop(void *pvParameters) {
       }
       xSemaphoreGive(ui_loop_mutex);
     }
-
-    // ✅ Maintain consistent frame rate (20 FPS)
-    vTaskDelayUntil(&last_wake_time, pdMS_TO_TICKS(UI_UPDATE_INTERVAL_MS));
   }
 
   ESP_LOGI(TAG, "UI main loop ended");
@@ -101,6 +124,7 @@ void ui_loop_stop(void) {
 
   // Stop the loop
   ui_running = false;
+  ui_loop_wake();
 
   // Wait for task to finish
   vTaskDelay(pdMS_TO_TICKS(100));
@@ -135,6 +159,12 @@ void ui_loop_resume(void) {
 
 bool ui_loop_is_running(void) { return ui_running && !ui_paused; }
 
+void ui_loop_wake(void) {
+  if (ui_task_handle) {
+    xTaskNotifyGive(ui_task_handle);
+  }
+}
+
 // ✅ INPUT PROCESSING with debouncing
 void ui_process_input(void) {
   int64_t current_time = esp_timer_get_time();
@@ -158,6 +188,9 @@ void ui_process_timeouts(void) {
   // Check broadcast timeout and other UI timeouts
   ui_check_broadcast_timeout();
 
+  // Dismiss the toast overlay once its time is up
+  ui_check_toast_timeout();
+
   // Add other timeout checks here if needed
   // e.g., screen saver timeout, auto-refresh, etc.
 }
@@ -166,7 +199,11 @@ void ui_process_timeouts(void) {
 void ui_update_display(void) {
   if (ui_needs_update()) {
     ui_update();
+    redraw_count++;
   }
+
+  // Send whatever changed in the framebuffer (no-op when nothing did)
+  display_update();
 }
 
 // ✅ DEBUG FUNCTIONS
@@ -174,8 +211,21 @@ void ui_print_loop_stats(void) {
   ESP_LOGI(TAG, "UI Loop Statistics:");
   ESP_LOGI(TAG, "  Running: %s", ui_running ? "YES" : "NO");
   ESP_LOGI(TAG, "  Paused: %s", ui_paused ? "YES" : "NO");
-  ESP_LOGI(TAG, "  Frame count: %lu", frame_count);
+  ESP_LOGI(TAG, "  Frame count: %lu (%lu notified)", frame_count,
+           notified_count);
   ESP_LOGI(TAG, "  Last update: %lld µs ago",
            esp_timer_get_time() - last_update_time);
   ESP_LOGI(TAG, "  Task handle: %p", ui_task_handle);
+
+  // Bus cost of what the UI drew
+  display_stats_t ds;
+  display_get_stats(&ds);
+  ESP_LOGI(TAG, "  Redraws: %lu, flushes: %lu (%lu dropped, %lu scrolled)",
+           redraw_count, ds.flushes, ds.frames_dropped, ds.scrolls);
+  if (ds.flushes > 0) {
+    ESP_LOGI(TAG, "  I2C per flush: %lu bytes / %lu transactions avg, "
+                  "%lu bytes max, last %lu bytes",
+             ds.bytes / ds.flushes, ds.transactions / ds.flushes,
+             ds.max_bytes, ds.last_bytes);
+  }
 }
@@ -5,34 +5,55 @@
 #include "display.h"
 #include "esp_log.h"
 #include "esp_timer.h"
+#include "freertos/queue.h"
 #include "node_config.h"
 #include "types_common.h"
-#include "user_table.h"
+#include "ui_loop.h"
 #include <string.h>
 
 static const char *TAG = "UI_SCREENS";
 
 // Pre-defined message options
-static const char *predefined_messages[UI_PREDEFINED_MSG_COUNT] = {
-    "Hello", "How are you?", "Thanks", "Yes", "No", "OK", "Goodbye"};
-
 // Internal UI state (separate from app_state)
 static ui_internal_state_t ui_internal = {.cursor_pos = 0,
                                           .scroll_offset = 0,
                                           .screen_needs_update = true,
                                           .broadcast_active = false,
-                                          .broadcast_start_time = 0};
+                                          .broadcast_start_time = 0,
+                                          .toast_active = false};
+
+
+// Delivery updates arrive from the TX, RX and esp_timer tasks: they are
+// queued here and applied to the toast by the UI task
+typedef struct {
+  peer_id_t receiver;
+  delivery_state_t state;
+} ui_delivery_event_t;
+
+static QueueHandle_t delivery_events = NULL;
+static uint32_t delivery_events_dropped = 0;
 
-// Screen data using constants
-static char contact_list[MAX_USERS][USERNAME_MAX_LEN];
-static int contact_count = 0;
-static char chat_messages[50][MAX_MESSAGE_LEN + USERNAME_MAX_LEN + 10];
-static int message_count = 0;
+// Absolute number of the first history line on the panel (-1: none), so the
+// next render can scroll the panel instead of redrawing it
+static int32_t chat_view_first = -1;
+
+_Static_assert(CHAT_LOG_WRAP_WIDTH + 2 == MAX_CHARS_PER_LINE,
+               "chat log must wrap to the list line width");
 
 void ui_init(void) {
   ESP_LOGI(TAG, "Initializing MeshTalk UI...");
 
+  // ui_init() may run more than once: keep the queue created first
+  if (!delivery_events) {
+    delivery_events =
+        xQueueCreate(UI_DELIVERY_QUEUE_LEN, sizeof(ui_delivery_event_t));
+    if (!delivery_events) {
+      ESP_LOGE(TAG, "Failed to create delivery event queue");
+    }
+  }
+
   api_init(ui_on_message_received);
+  api_register_delivery_cb(ui_on_delivery_update);
 
   // Use app_state for initial screen
   app_state_set_screen(SCREEN_HOME);
@@ -47,17 +68,11 @@ void ui_set_screen(screen_t screen) {
   ui_internal.cursor_pos = 0;
   ui_internal.scroll_offset = 0;
   ui_internal.screen_needs_update = true;
+  chat_view_first = -1;
 
   // Clear new message flag when opening individual chat
   if (screen == SCREEN_INDIVIDUAL_CHAT) {
-    const char *selected_user = app_state_get_selected_user();
-    if (selected_user[0] != '\0') {
-      int user_idx = user_table_find_index_by_name(selected_user);
-      if (user_idx >= 0) {
-        app_state_clear_new_message(user_idx);
-        ESP_LOGI(TAG, "Cleared new message flag for %s", selected_user);
-      }
-    }
+    app_state_clear_new_message(app_state_get_selected_peer());
   }
 
   ESP_LOGI(TAG, "Screen changed to: %d", screen);
@@ -84,6 +99,83 @@ void ui_check_broadcast_timeout(void) {
   }
 }
 
+uint32_t ui_next_timeout_ms(void) {
+  int64_t now = esp_timer_get_time();
+  int64_t left_ms = INT64_MAX;
+
+  // ui_check_broadcast_timeout() fires once elapsed exceeds the timeout
+  if (app_state_get_screen() == SCREEN_BROADCAST &&
+      ui_internal.broadcast_active) {
+    int64_t elapsed_ms = (now - ui_internal.broadcast_start_time) / 1000;
+    left_ms = UI_BROADCAST_TIMEOUT_MS + 1 - elapsed_ms;
+  }
+
+  if (ui_internal.toast_active) {
+    int64_t toast_ms = (ui_internal.toast_until - now + 999) / 1000;
+    if (toast_ms < left_ms)
+      left_ms = toast_ms;
+  }
+
+  if (left_ms == INT64_MAX)
+    return UINT32_MAX;
+  return (left_ms > 0) ? (uint32_t)left_ms : 0;
+}
+
+// TOAST OVERLAY
+static const char *toast_delivery_text(delivery_state_t state) {
+  switch (state) {
+  case DELIVERY_QUEUED:
+    return "Sending...";
+  case DELIVERY_SENT:
+    return "Message Sent!";
+  case DELIVERY_ACKED:
+    return "Delivered!";
+  case DELIVERY_FAILED:
+    return "Not delivered!";
+  case DELIVERY_NONE:
+    break;
+  }
+  return "Message Sent!";
+}
+
+// Composite the toast over whatever the screen drew
+static void ui_draw_toast(void) {
+  if (!ui_internal.toast_active)
+    return;
+
+  const char *text = ui_internal.toast_delivery
+                         ? toast_delivery_text(ui_internal.toast_state)
+                         : ui_internal.toast_text;
+  display_banner_text(UI_TOAST_LINE, text);
+}
+
+void ui_show_toast(const char *text, uint32_t duration_ms) {
+  ui_internal.toast_delivery = false;
+  ui_internal.toast_text = text;
+  ui_internal.toast_until =
+      esp_timer_get_time() + (int64_t)duration_ms * 1000;
+  ui_internal.toast_active = true;
+  ui_draw_toast();
+}
+
+// Toast that follows the delivery state of the message just sent to peer
+static void ui_show_delivery_toast(peer_id_t peer) {
+  ui_internal.toast_peer = peer;
+  ui_internal.toast_state = DELIVERY_QUEUED;
+  ui_internal.toast_delivery = true;
+  ui_internal.toast_until =
+      esp_timer_get_time() + (int64_t)UI_MESSAGE_SENT_DISPLAY_MS * 1000;
+  ui_internal.toast_active = true;
+}
+
+void ui_check_toast_timeout(void) {
+  if (ui_internal.toast_active &&
+      esp_timer_get_time() >= ui_internal.toast_until) {
+    ui_internal.toast_active = false;
+    ui_internal.screen_needs_update = true; // Redraw what it covered
+  }
+}
+
 // Also add the missing ui_start_broadcast() function
 void ui_start_broadcast(void) {
   ui_internal.broadcast_active = true;
@@ -122,6 +214,53 @@ void ui_go_back(void) {
 
 screen_t ui_get_current_screen(void) { return app_state_get_screen(); }
 
+// Keep the cursor inside the visible window of a list screen
+// Returns true if the window moved
+static bool ui_scroll_to_cursor(void) {
+  int old_offset = ui_internal.scroll_offset;
+  if (ui_internal.cursor_pos >=
+      ui_internal.scroll_offset + UI_LIST_VISIBLE_ITEMS) {
+    ui_internal.scroll_offset =
+        ui_internal.cursor_pos - UI_LIST_VISIBLE_ITEMS + 1;
+  } else if (ui_internal.cursor_pos < ui_internal.scroll_offset) {
+    ui_internal.scroll_offset = ui_internal.cursor_pos;
+  }
+  return ui_internal.scroll_offset != old_offset;
+}
+
+// Display line of a cursor position, -1 on screens without a line cursor
+static int ui_cursor_line(screen_t screen, int pos) {
+  switch (screen) {
+  case SCREEN_HOME:
+    return pos + 1;
+  case SCREEN_CHAT:
+  case SCREEN_SEND_MESSAGE:
+    return pos - ui_internal.scroll_offset + 1;
+  default:
+    return -1;
+  }
+}
+
+// Move the cursor by rewriting only the old and new cursor lines. Falls
+// back to a full redraw when the list window scrolls or one is pending.
+static void ui_set_cursor(int pos) {
+  screen_t current = app_state_get_screen();
+  int old_line = ui_cursor_line(current, ui_internal.cursor_pos);
+  ui_internal.cursor_pos = pos;
+
+  if (old_line < 0 || ui_internal.screen_needs_update) {
+    ui_internal.screen_needs_update = true;
+    return;
+  }
+  if (current != SCREEN_HOME && ui_scroll_to_cursor()) {
+    ui_internal.screen_needs_update = true;
+    return;
+  }
+
+  display_move_cursor(old_line, ui_cursor_line(current, pos));
+  ui_draw_toast(); // The cursor line may be under it
+}
+
 // HOME SCREEN (Menu mode)
 void ui_show_home_screen(void) {
   const char *menu_items[] = {"Chat", "Broadcast", "About"};
@@ -161,88 +300,120 @@ void ui_show_about_screen(void) {
 }
 
 // CHAT LIST SCREEN with new message indicators
+// Row source for the contact list: contact index = user/app_state index, so
+// rows are formatted without any name lookups
+static void contact_row(int index, char *buf, size_t len) {
+  char name[USERNAME_MAX_LEN];
+  if (!api_get_contact_name(index, name, sizeof(name))) {
+    buf[0] = '\0';
+  } else if (app_state_has_new_message(api_get_contact_peer(index))) {
+    snprintf(buf, len, "%s %s", name, SYMBOL_NEW_MESSAGE);
+  } else {
+    snprintf(buf, len, "%s", name);
+  }
+}
+
 void ui_show_chat_screen(void) {
-  contact_count = api_get_contact_names(contact_list, MAX_USERS);
-  ESP_LOGI(TAG, "Count %d", contact_count);
+  int contact_count = api_get_contact_count();
 
+  display_set_mode(DISPLAY_MODE_LIST);
   if (contact_count == 0) {
     const char *empty_list[] = {"No contacts found"};
-    display_set_mode(DISPLAY_MODE_LIST);
     display_show_list_screen("Chat", empty_list, 1, 0, 0);
     return;
   }
 
-  // Create contact display names with new message indicators using
-  // SYMBOL_NEW_MESSAGE
-  static char display_names[MAX_USERS][USERNAME_MAX_LEN + 5];
-  for (int i = 0; i < contact_count; i++) {
-    int user_idx = user_table_find_index_by_name(contact_list[i]);
-    if (user_idx >= 0 && app_state_has_new_message(user_idx)) {
-      snprintf(display_names[i], sizeof(display_names[i]), "%s %s",
-               contact_list[i], SYMBOL_NEW_MESSAGE);
-    } else {
-      strncpy(display_names[i], contact_list[i], sizeof(display_names[i]) - 1);
-      display_names[i][sizeof(display_names[i]) - 1] = '\0';
-    }
-  }
+  ui_scroll_to_cursor();
+  display_show_list_rows("Chat", contact_count, ui_internal.cursor_pos,
+                         ui_internal.scroll_offset, contact_row);
 
-  // Calculate scroll offset for smooth scrolling
-  int visible_items = 7;
-  if (ui_internal.cursor_pos >= ui_internal.scroll_offset + visible_items) {
-    ui_internal.scroll_offset = ui_internal.cursor_pos - visible_items + 1;
-  } else if (ui_internal.cursor_pos < ui_internal.scroll_offset) {
-    ui_internal.scroll_offset = ui_internal.cursor_pos;
-  }
+  ESP_LOGD(TAG, "Chat screen displayed: %d contacts", contact_count);
+}
 
-  const char *contact_names[MAX_USERS];
-  for (int i = 0; i < contact_count; i++) {
-    contact_names[i] = display_names[i];
+// INDIVIDUAL CHAT SCREEN
+static const char *delivery_marker(delivery_state_t state) {
+  switch (state) {
+  case DELIVERY_QUEUED:
+    return " " SYMBOL_DELIVERY_QUEUED;
+  case DELIVERY_SENT:
+    return " " SYMBOL_DELIVERY_SENT;
+  case DELIVERY_ACKED:
+    return " " SYMBOL_DELIVERY_ACKED;
+  case DELIVERY_FAILED:
+    return " " SYMBOL_DELIVERY_FAILED;
+  case DELIVERY_NONE:
+    break;
   }
+  return "";
+}
 
-  display_set_mode(DISPLAY_MODE_LIST);
-  display_show_list_screen("Chat", contact_names, contact_count,
-                           ui_internal.cursor_pos, ui_internal.scroll_offset);
-
-  ESP_LOGD(TAG, "Chat screen displayed: %d contacts", contact_count);
+// Lines the history can scroll up from the newest message
+static int chat_max_scroll(peer_id_t peer) {
+  int total = api_get_chat_line_count(peer);
+  return (total > UI_CHAT_HISTORY_LINES) ? total - UI_CHAT_HISTORY_LINES : 0;
 }
 
-// INDIVIDUAL CHAT SCREEN
-void ui_show_individual_chat_screen(const char *contact_name) {
-  static char raw_messages[50][MAX_MESSAGE_LEN + 1];
-  message_count = api_get_chat_log(contact_name, raw_messages, 50);
+void ui_show_individual_chat_screen(peer_id_t peer) {
+  char texts[UI_CHAT_HISTORY_LINES][MAX_CHARS_PER_LINE + 1];
+  int line_count = 0;
+  int32_t view_first = 0;
+
+  // Lines point into the log: format them, then make sure no append reused
+  // the records while we read (try again, at worst show what was read)
+  for (int attempt = 0; attempt < UI_CHAT_READ_ATTEMPTS; attempt++) {
+    uint32_t gen = api_get_chat_generation();
+
+    // scroll_offset counts lines up from the bottom of the history
+    int max_scroll = chat_max_scroll(peer);
+    if (ui_internal.scroll_offset > max_scroll)
+      ui_internal.scroll_offset = max_scroll;
+
+    // Only the visible window is fetched; line breaks come from the log cache
+    int first = max_scroll - ui_internal.scroll_offset;
+    chat_log_line_t lines[UI_CHAT_HISTORY_LINES];
+    line_count =
+        api_get_chat_lines(peer, first, lines, UI_CHAT_HISTORY_LINES);
+    for (int i = 0; i < line_count; i++) {
+      snprintf(texts[i], sizeof(texts[i]), "%.*s%s", lines[i].len,
+               lines[i].text,
+               lines[i].last ? delivery_marker(lines[i].state) : "");
+    }
+    view_first = (int32_t)api_get_chat_evicted_lines(peer) + first;
 
-  // Safe message formatting with null termination
-  for (int i = 0; i < message_count; i++) {
-    strncpy(chat_messages[i], raw_messages[i], sizeof(chat_messages[i]) - 1);
-    chat_messages[i][sizeof(chat_messages[i]) - 1] = '\0';
+    if (api_chat_unchanged(gen))
+      break;
   }
 
   display_set_mode(DISPLAY_MODE_CHAT);
+
+  // Window moved by less than a screen (new message or scrolling): shift the
+  // panel so that lines still visible are not sent again
+  int32_t shift = view_first - chat_view_first;
+  if (chat_view_first >= 0 && shift != 0 && shift > -UI_CHAT_HISTORY_LINES &&
+      shift < UI_CHAT_HISTORY_LINES) {
+    display_scroll((int)shift);
+  }
+  chat_view_first = view_first;
+
   display_clear();
 
-  // Header with contact name
+  // Header with contact name, the only place it is needed
+  char contact_name[USERNAME_MAX_LEN];
+  if (!api_get_peer_name(peer, contact_name, sizeof(contact_name)))
+    snprintf(contact_name, sizeof(contact_name), "?");
   display_center_text(0, contact_name, false);
 
-  // Show recent messages (lines 1-6)
-  int start_msg = (message_count > UI_CHAT_HISTORY_LINES)
-                      ? message_count - UI_CHAT_HISTORY_LINES
-                      : 0;
-
+  // Show the history window (lines 1-6), delivery marker after the last line
   for (int i = 0; i < UI_CHAT_HISTORY_LINES; i++) {
-    int msg_index = start_msg + i;
-    if (msg_index < message_count) {
-      display_list_line(i + 1, chat_messages[msg_index], false);
-    } else {
-      display_list_line(i + 1, "", false);
-    }
+    display_list_line(i + 1, i < line_count ? texts[i] : "", false);
   }
 
   // Show "Send Message" option on line 7
   bool send_selected = (ui_internal.cursor_pos == 0);
   display_list_line(7, "Send Message", send_selected);
 
-  ESP_LOGD(TAG, "Individual chat displayed: %s, %d messages", contact_name,
-           message_count);
+  ESP_LOGD(TAG, "Individual chat displayed: 0x%04X, %d lines, scroll %d",
+           peer, line_count, ui_internal.scroll_offset);
 }
 
 // SEND MESSAGE SCREEN
@@ -252,17 +423,18 @@ void ui_show_send_message_screen(void) {
 
   // Header
   char header[32];
-  const char *selected_user = app_state_get_selected_user();
-  snprintf(header, sizeof(header), "%s", selected_user);
+  if (!api_get_peer_name(app_state_get_selected_peer(), header,
+                         sizeof(header)))
+    snprintf(header, sizeof(header), "?");
   display_center_text(0, header, false);
 
   // Show message options (lines 1-7)
-  int visible_options = 7;
-  for (int i = 0; i < visible_options && i < UI_PREDEFINED_MSG_COUNT; i++) {
+  ui_scroll_to_cursor();
+  for (int i = 0; i < UI_LIST_VISIBLE_ITEMS; i++) {
     int option_index = ui_internal.scroll_offset + i;
     if (option_index < UI_PREDEFINED_MSG_COUNT) {
       bool is_selected = (option_index == ui_internal.cursor_pos);
-      display_list_line(i + 1, predefined_messages[option_index], is_selected);
+      display_list_line(i + 1, phrasebook_get(option_index), is_selected);
     } else {
       display_list_line(i + 1, "", false);
     }
@@ -296,7 +468,7 @@ void ui_update(void) {
     ui_show_chat_screen();
     break;
   case SCREEN_INDIVIDUAL_CHAT:
-    ui_show_individual_chat_screen(app_state_get_selected_user());
+    ui_show_individual_chat_screen(app_state_get_selected_peer());
     break;
   case SCREEN_SEND_MESSAGE:
     ui_show_send_message_screen();
@@ -308,14 +480,24 @@ void ui_update(void) {
     ui_show_about_screen();
     break;
   }
+  ui_draw_toast();
 
   ui_internal.screen_needs_update = false;
 }
 
 void ui_navigate_up(void) {
+  // In a chat, up/down scroll the history; the cursor stays on Send Message
+  if (app_state_get_screen() == SCREEN_INDIVIDUAL_CHAT) {
+    if (ui_internal.scroll_offset <
+        chat_max_scroll(app_state_get_selected_peer())) {
+      ui_internal.scroll_offset++;
+      ui_internal.screen_needs_update = true;
+    }
+    return;
+  }
+
   if (ui_internal.cursor_pos > 0) {
-    ui_internal.cursor_pos--;
-    ui_internal.screen_needs_update = true;
+    ui_set_cursor(ui_internal.cursor_pos - 1);
   }
 }
 
@@ -328,11 +510,14 @@ void ui_navigate_down(void) {
     max_pos = 2; // Chat, Broadcast, About
     break;
   case SCREEN_CHAT:
-    max_pos = contact_count - 1;
+    max_pos = api_get_contact_count() - 1;
     break;
   case SCREEN_INDIVIDUAL_CHAT:
-    max_pos = 0; // Only Send Message option
-    break;
+    if (ui_internal.scroll_offset > 0) {
+      ui_internal.scroll_offset--; // Scroll towards the newest message
+      ui_internal.screen_needs_update = true;
+    }
+    return;
   case SCREEN_SEND_MESSAGE:
     max_pos = UI_PREDEFINED_MSG_COUNT - 1;
     break;
@@ -349,8 +534,7 @@ void ui_navigate_down(void) {
   }
 
   if (ui_internal.cursor_pos < max_pos) {
-    ui_internal.cursor_pos++;
-    ui_internal.screen_needs_update = true;
+    ui_set_cursor(ui_internal.cursor_pos + 1);
   }
 }
 
@@ -371,13 +555,15 @@ void ui_select_current_item(void) {
     }
     break;
 
-  case SCREEN_CHAT:
-    if (contact_count > 0 && ui_internal.cursor_pos < contact_count) {
-      // Use app_state to set selected user
-      app_state_set_selected_user(contact_list[ui_internal.cursor_pos]);
+  case SCREEN_CHAT: {
+    peer_id_t contact = api_get_contact_peer(ui_internal.cursor_pos);
+    if (contact != PEER_NONE) {
+      // Use app_state to set selected peer
+      app_state_set_selected_peer(contact);
       ui_set_screen(SCREEN_INDIVIDUAL_CHAT);
     }
     break;
+  }
 
   case SCREEN_INDIVIDUAL_CHAT:
     if (ui_internal.cursor_pos == 0) { // Send Message option
@@ -400,18 +586,17 @@ void ui_select_current_item(void) {
 
 void ui_send_selected_message(void) {
   if (ui_internal.cursor_pos < UI_PREDEFINED_MSG_COUNT) {
-    const char *message = predefined_messages[ui_internal.cursor_pos];
-    const char *selected_user = app_state_get_selected_user();
-
-    ESP_LOGI(TAG, "Sending message '%s' to %s", message, selected_user);
+    const char *message = phrasebook_get(ui_internal.cursor_pos);
+    peer_id_t selected_peer = app_state_get_selected_peer();
 
-    // Call API to send message
-    api_send_text(selected_user, message);
+    ESP_LOGI(TAG, "Sending message '%s' to 0x%04X", message, selected_peer);
 
-    // Show confirmation
-    display_clear();
-    display_center_text(2, "Message Sent!", true);
-    vTaskDelay(pdMS_TO_TICKS(UI_MESSAGE_SENT_DISPLAY_MS));
+    // Confirmation toast over the chat, updated by delivery callbacks (set
+    // up first, they may arrive before api_send_text() returns)
+    ui_show_delivery_toast(selected_peer);
+    if (api_send_text(selected_peer, message) < 0) {
+      ui_internal.toast_state = DELIVERY_FAILED;
+    }
 
     ui_set_screen(SCREEN_INDIVIDUAL_CHAT);
   }
@@ -440,43 +625,79 @@ void ui_handle_joystick(joystick_action_t action) {
 }
 
 // MESSAGE CALLBACK with app_state integration
-void ui_on_message_received(const char *sender, const char *message) {
-  ESP_LOGI(TAG, "New message from %s: %s", sender, message);
-
-  const char *current_user = app_state_get_selected_user();
+void ui_on_message_received(peer_id_t sender, const char *message) {
+  ESP_LOGI(TAG, "New message from 0x%04X: %s", sender, message);
 
   // If viewing this contact's chat, refresh and clear flag
   if (app_state_get_screen() == SCREEN_INDIVIDUAL_CHAT &&
-      strcmp(current_user, sender) == 0) {
+      app_state_get_selected_peer() == sender) {
     ui_internal.screen_needs_update = true;
-    int user_idx = user_table_find_index_by_name(sender);
-    if (user_idx >= 0) {
-      app_state_clear_new_message(user_idx);
-    }
+    ui_loop_wake();
+    app_state_clear_new_message(sender);
   } else {
     // Set new message flag
-    int user_idx = user_table_find_index_by_name(sender);
-    if (user_idx >= 0) {
-      g_app_state.new_message_flags[user_idx] = true;
-    }
+    app_state_set_new_message(sender);
   }
 
   // Refresh chat list if viewing it
   if (app_state_get_screen() == SCREEN_CHAT) {
     ui_internal.screen_needs_update = true;
+    ui_loop_wake();
+  }
+}
+
+// DELIVERY CALLBACK: runs in the sender's task, so only record the event
+void ui_on_delivery_update(peer_id_t receiver, delivery_state_t state) {
+  ESP_LOGD(TAG, "Delivery update for 0x%04X: %d", receiver, state);
+
+  ui_delivery_event_t evt = {.receiver = receiver, .state = state};
+  if (!delivery_events || xQueueSend(delivery_events, &evt, 0) != pdTRUE) {
+    // The chat log holds the state anyway, only the toast misses it
+    delivery_events_dropped++;
+    ESP_LOGW(TAG, "Delivery event for 0x%04X dropped (%lu so far)", receiver,
+             (unsigned long)delivery_events_dropped);
+    return;
+  }
+  ui_loop_wake();
+}
+
+// Apply queued delivery updates (UI task): refresh the open chat when a sent
+// message changes state
+void ui_process_delivery_updates(void) {
+  ui_delivery_event_t evt;
+  while (delivery_events && xQueueReceive(delivery_events, &evt, 0) == pdTRUE) {
+    bool refresh = app_state_get_screen() == SCREEN_INDIVIDUAL_CHAT &&
+                   app_state_get_selected_peer() == evt.receiver;
+
+    // Show the outcome in the sent toast, long enough to be read
+    if (ui_internal.toast_active && ui_internal.toast_delivery &&
+        ui_internal.toast_peer == evt.receiver) {
+      ui_internal.toast_state = evt.state;
+      if (evt.state == DELIVERY_ACKED || evt.state == DELIVERY_FAILED) {
+        ui_internal.toast_until =
+            esp_timer_get_time() + (int64_t)UI_MESSAGE_SENT_DISPLAY_MS * 1000;
+      }
+      refresh = true;
+    }
+
+    if (refresh)
+      ui_internal.screen_needs_update = true;
   }
 }
 
 // Utility functions
 bool ui_needs_update(void) { return ui_internal.screen_needs_update; }
 
-void ui_mark_dirty(void) { ui_internal.screen_needs_update = true; }
+void ui_mark_dirty(void) {
+  ui_internal.screen_needs_update = true;
+  ui_loop_wake();
+}
 
 void ui_clear_dirty(void) { ui_internal.screen_needs_update = false; }
 
 const char *ui_get_predefined_message(int index) {
   if (index >= 0 && index < UI_PREDEFINED_MSG_COUNT) {
-    return predefined_messages[index];
+    return phrasebook_get(index);
   }
   return NULL;
 }
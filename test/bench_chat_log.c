@@ -0,0 +1,167 @@
+// In-RAM chat log: the shared arena of variable-length records against the
+// layout it replaced, modelled below as MAX_CHAT_PER_USER fixed slots of
+// MAX_MESSAGE_LEN + 1 bytes per contact. Reports messages retained per KB
+// for a few traffic mixes and the cost of adding and reading messages.
+
+#include "bench_util.h"
+#include "chat_log.h"
+#include "host_shims.h"
+#include "phrasebook.h"
+#include "user_table.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define CONTACTS 8
+#define OLD_SLOT (MAX_MESSAGE_LEN + 1)
+#define OLD_BYTES (CONTACTS * MAX_CHAT_PER_USER * OLD_SLOT)
+
+// The old layout: a ring of fixed slots per contact, copied out on read
+typedef struct {
+  char messages[MAX_CHAT_PER_USER][OLD_SLOT];
+  int head;
+  int count;
+} old_log_t;
+
+static old_log_t old_logs[CONTACTS];
+static peer_id_t peers[CONTACTS];
+
+static void old_add(int user, const char *msg, bool outgoing) {
+  old_log_t *log = &old_logs[user];
+  if (outgoing)
+    snprintf(log->messages[log->head], OLD_SLOT, "You: %s", msg);
+  else
+    strncpy(log->messages[log->head], msg, MAX_MESSAGE_LEN);
+  log->messages[log->head][MAX_MESSAGE_LEN] = '\0';
+  log->head = (log->head + 1) % MAX_CHAT_PER_USER;
+  if (log->count < MAX_CHAT_PER_USER)
+    log->count++;
+}
+
+static int old_get(int user, char out[][OLD_SLOT]) {
+  old_log_t *log = &old_logs[user];
+  int start = (log->head - log->count + MAX_CHAT_PER_USER) % MAX_CHAT_PER_USER;
+  for (int i = 0; i < log->count; i++) {
+    strncpy(out[i], log->messages[(start + i) % MAX_CHAT_PER_USER],
+            OLD_SLOT);
+  }
+  return log->count;
+}
+
+// Read every message of a user through the cursor, as the UI does
+static int new_get(peer_id_t peer) {
+  chat_log_iter_t it;
+  chat_log_entry_t entry;
+  int n = 0;
+  chat_log_iter_begin(peer, &it);
+  while (chat_log_iter_next(&it, &entry)) {
+    bench_sink += entry.len + entry.text[0];
+    n++;
+  }
+  return n;
+}
+
+static const char *const typed[] = {
+    "Where are you?",
+    "At the north gate, come over",
+    "Battery low, switching off for an hour",
+    "Can you bring the spare radio to the camp by six?",
+    "ok",
+    "Thanks!",
+};
+
+// Phrases half of the time, typed messages otherwise
+static const char *next_message(void) {
+  if (rand() % 2)
+    return phrasebook_get((uint8_t)(rand() % PHRASEBOOK_SIZE));
+  return typed[rand() % (sizeof(typed) / sizeof(typed[0]))];
+}
+
+static void reset(void) {
+  host_nvs_reset();
+  user_table_clear();
+  chat_log_init();
+  memset(old_logs, 0, sizeof(old_logs));
+  for (int i = 0; i < CONTACTS; i++) {
+    char name[USERNAME_MAX_LEN];
+    snprintf(name, sizeof(name), "peer%d", i);
+    user_table_set(name, (uint16_t)(0x0010 + i));
+    peers[i] = user_table_peer_id(i);
+  }
+}
+
+// Run traffic to `active` of the contacts, then count what both layouts
+// still hold
+static void retained(const char *mix, int active) {
+  reset();
+  srand(1);
+  for (int i = 0; i < 2000; i++) {
+    int user = rand() % active;
+    const char *msg = next_message();
+    bool outgoing = rand() % 2;
+    chat_log_add(peers[user], msg, outgoing);
+    old_add(user, msg, outgoing);
+  }
+
+  int new_msgs = 0, old_msgs = 0;
+  for (int i = 0; i < CONTACTS; i++) {
+    new_msgs += new_get(peers[i]);
+    old_msgs += old_logs[i].count;
+  }
+  double new_kb = CHAT_LOG_ARENA_SIZE / 1024.0;
+  double old_kb = OLD_BYTES / 1024.0;
+  printf("%-16s %5d in %4d B %6.1f/KB   %5d in %4d B %6.1f/KB\n", mix,
+         new_msgs, CHAT_LOG_ARENA_SIZE, new_msgs / new_kb, old_msgs,
+         OLD_BYTES, old_msgs / old_kb);
+}
+
+static void report(const char *name, long iters, uint64_t ns) {
+  printf("%-28s %10.1f ns/op\n", name, (double)ns / (double)iters);
+}
+
+int main(int argc, char **argv) {
+  bench_parse_args(argc, argv);
+  esp_log_level_set("*", ESP_LOG_ERROR);
+  user_table_init();
+
+  printf("%d contacts, messages retained:\n", CONTACTS);
+  printf("%-16s %-25s   %s\n", "traffic", "arena", "fixed slots");
+  retained("one contact", 1);
+  retained("three contacts", 3);
+  retained("all contacts", CONTACTS);
+
+  reset();
+  const char *msgs[256];
+  srand(2);
+  for (int i = 0; i < 256; i++) {
+    msgs[i] = next_message();
+  }
+
+  long iters = bench_iters(1000000);
+  uint64_t start = bench_now_ns();
+  for (long i = 0; i < iters; i++) {
+    chat_log_add(peers[i % CONTACTS], msgs[i & 255], i & 1);
+  }
+  report("chat_log_add (arena)", iters, bench_now_ns() - start);
+
+  start = bench_now_ns();
+  for (long i = 0; i < iters; i++) {
+    old_add(i % CONTACTS, msgs[i & 255], i & 1);
+  }
+  report("add (fixed slots)", iters, bench_now_ns() - start);
+
+  iters = bench_iters(500000);
+  start = bench_now_ns();
+  for (long i = 0; i < iters; i++) {
+    bench_sink += new_get(peers[i % CONTACTS]);
+  }
+  report("read all (arena cursor)", iters, bench_now_ns() - start);
+
+  static char out[MAX_CHAT_PER_USER][OLD_SLOT];
+  start = bench_now_ns();
+  for (long i = 0; i < iters; i++) {
+    bench_sink += old_get(i % CONTACTS, out);
+    bench_sink += out[0][0];
+  }
+  report("read all (fixed slots copy)", iters, bench_now_ns() - start);
+  return 0;
+}
@@ -0,0 +1,90 @@
+// Chat store on the file-backed flash fake, sized like the "chatlog"
+// partition: append throughput, random page reads once the log has wrapped,
+// and what every message costs in flash bytes programmed and erases.
+//
+// Times are host CPU plus file I/O, good for comparing store changes; the
+// flash counts carry over to the device as they are.
+
+#include "bench_util.h"
+#include "chat_log.h"
+#include "chat_store.h"
+#include "flash_fake.h"
+#include "host_shims.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define FLASH_SIZE (64 * 1024) // partitions.csv
+#define PEERS 16
+#define PAGE_SIZE MAX_CHAT_PER_USER
+
+static void random_text(char *text, size_t *len) {
+  *len = 8 + rand() % (MAX_MESSAGE_LEN - 8 + 1);
+  for (size_t i = 0; i < *len; i++) {
+    text[i] = (char)('a' + rand() % 26);
+  }
+}
+
+int main(int argc, char **argv) {
+  bench_parse_args(argc, argv);
+  esp_log_level_set("*", ESP_LOG_ERROR);
+  srand(1);
+
+  const chat_store_flash_t *flash = host_flash_open(NULL, FLASH_SIZE);
+  if (!flash || chat_store_init(flash) != 0) {
+    fprintf(stderr, "No flash\n");
+    return 1;
+  }
+
+  // Enough to wrap the log a few times in the full run
+  long appends = bench_iters(20000);
+  uint64_t payload = 0;
+  char text[MAX_MESSAGE_LEN];
+  uint64_t start = bench_now_ns();
+  for (long i = 0; i < appends; i++) {
+    size_t len;
+    random_text(text, &len);
+    // One busy conversation, the rest now and then
+    uint16_t peer = (uint16_t)(0x0010 + (rand() % 4 ? 0 : rand() % PEERS));
+    if (chat_store_append(peer, i % 2, text, len) != 0) {
+      fprintf(stderr, "Append %ld failed\n", i);
+      return 1;
+    }
+    payload += len;
+  }
+  uint64_t append_ns = bench_now_ns() - start;
+  host_flash_stats_t fs;
+  host_flash_get_stats(&fs);
+
+  long reads = bench_iters(20000);
+  chat_store_msg_t msgs[PAGE_SIZE];
+  host_flash_stats_t after;
+  uint64_t returned = 0;
+  start = bench_now_ns();
+  for (long i = 0; i < reads; i++) {
+    uint16_t peer = (uint16_t)(0x0010 + rand() % PEERS);
+    returned += chat_store_read_page(peer, rand() % 4, msgs, PAGE_SIZE);
+  }
+  uint64_t read_ns = bench_now_ns() - start;
+  host_flash_get_stats(&after);
+
+  chat_store_stats_t stats;
+  chat_store_get_stats(&stats);
+
+  printf("%ld appends, %.0f B text on average, %d KB flash\n", appends,
+         (double)payload / appends, FLASH_SIZE / 1024);
+  printf("append: %.2f us, %.0f msgs/s\n", (double)append_ns / appends / 1000,
+         appends * 1e9 / append_ns);
+  printf("read page: %.2f us, %.1f msgs, %.0f flash bytes read\n",
+         (double)read_ns / reads / 1000, (double)returned / reads,
+         (double)(after.bytes_read - fs.bytes_read) / reads);
+  printf("flash per message: %.1f bytes programmed (%.2fx the text), "
+         "%.2f erases per 1000\n",
+         (double)fs.bytes_written / appends,
+         (double)fs.bytes_written / payload,
+         1000.0 * fs.erases / appends);
+  printf("store: %lu copied by compaction, %lu bytes written\n",
+         (unsigned long)stats.copied, (unsigned long)stats.bytes_written);
+
+  host_flash_close();
+  return 0;
+}
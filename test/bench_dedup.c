@@ -0,0 +1,77 @@
+// Duplicate filter under a steady message rate: an hour of virtual time,
+// every message delivered twice (relay copy shortly after the original).
+// Reports the false positive rate on new messages, missed repeats and the
+// cost of a lookup.
+
+#include "bench_util.h"
+#include "dedup_filter.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define SENDERS 20
+#define HOUR_US 3600000000LL
+#define REPEAT_DELAY_US 800000 // Relayed copy arrives 0.8 s later
+
+static void run(long per_hour) {
+  long total = bench_quick ? 200 : per_hour;
+  int64_t interval = HOUR_US / per_hour;
+  uint8_t next_id[SENDERS];
+  srand(1);
+  for (int s = 0; s < SENDERS; s++) {
+    next_id[s] = (uint8_t)(rand() % 255 + 1);
+  }
+
+  int64_t now = 1000000;
+  dedup_filter_init(now);
+  long false_positives = 0;
+  long missed_repeats = 0;
+  uint64_t lookup_ns = 0;
+
+  for (long i = 0; i < total; i++) {
+    uint16_t src = (uint16_t)(0x0100 + rand() % SENDERS);
+    int s = src - 0x0100;
+    uint8_t id = next_id[s];
+    next_id[s] = (uint8_t)(id == 255 ? 1 : id + 1);
+
+    uint64_t start = bench_now_ns();
+    bool first = dedup_filter_seen(src, id, now);
+    bool repeat = dedup_filter_seen(src, id, now + REPEAT_DELAY_US);
+    lookup_ns += bench_now_ns() - start;
+
+    if (first)
+      false_positives++;
+    if (!repeat)
+      missed_repeats++;
+    now += interval;
+  }
+
+  // Model: the older generation holds a full window of messages, the
+  // current one fills up over the window; a lookup tests both
+  double window_msgs = (double)per_hour * DEDUP_WINDOW_MS / 3600000.0;
+  double p_old = pow(1.0 - exp(-DEDUP_FILTER_HASHES * window_msgs /
+                               DEDUP_FILTER_BITS),
+                     DEDUP_FILTER_HASHES);
+  double expected = 0;
+  for (int step = 0; step < 100; step++) {
+    double cur = window_msgs * (step + 0.5) / 100;
+    double p_cur = pow(1.0 - exp(-DEDUP_FILTER_HASHES * cur /
+                                 DEDUP_FILTER_BITS),
+                       DEDUP_FILTER_HASHES);
+    expected += (1.0 - (1.0 - p_cur) * (1.0 - p_old)) / 100;
+  }
+  printf("%6ld msg/h: %ld new, false positives %ld (%.4f%%, ~%.4f%% "
+         "expected), repeats missed %ld, %.1f ns/lookup\n",
+         per_hour, total, false_positives, 100.0 * false_positives / total,
+         100.0 * expected, missed_repeats,
+         (double)lookup_ns / (2.0 * total));
+}
+
+int main(int argc, char **argv) {
+  bench_parse_args(argc, argv);
+  printf("dedup filter: %d bits x 2 generations, %d hashes, %d ms window\n",
+         DEDUP_FILTER_BITS, DEDUP_FILTER_HASHES, DEDUP_WINDOW_MS);
+  run(10000);
+  run(50000);
+  return 0;
+}
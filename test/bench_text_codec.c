@@ -0,0 +1,113 @@
+// Chat text compression on a corpus of typical messages: ratio, encode and
+// decode speed, and mesh segments saved per v2 frame.
+
+#include "bench_util.h"
+#include "binary_serial.h"
+#include "text_codec.h"
+#include <stdio.h>
+
+#define NOW_US 1000000
+
+static const char *const corpus[] = {
+    "hello",
+    "ok",
+    "where are you?",
+    "I am at the station now",
+    "thank you!",
+    "see you there in ten minutes",
+    "what time is the meeting?",
+    "can you call me when you get this",
+    "on my way",
+    "the battery is low, I will turn off the node",
+    "are you coming to the lunch?",
+    "yes",
+    "not sure yet, let me check with the others",
+    "Running late, start without me",
+    "Meet at the north entrance",
+    "do you have the keys for the car?",
+    "All good here. Signal is weak near the river",
+    "that was fast",
+    "Where should we go for dinner tonight?",
+    "I can't hear you, the wind is too strong",
+};
+
+#define CORPUS_SIZE (sizeof(corpus) / sizeof(corpus[0]))
+
+int main(int argc, char **argv) {
+  bench_parse_args(argc, argv);
+
+  size_t text_bytes = 0, packed_bytes = 0;
+  size_t segments_raw = 0, segments_packed = 0, unsegmented = 0;
+  for (size_t i = 0; i < CORPUS_SIZE; i++) {
+    const uint8_t *text = (const uint8_t *)corpus[i];
+    size_t len = strlen(corpus[i]);
+    uint8_t packed[MAX_PAYLOAD_SIZE];
+    size_t packed_len = text_compress(text, len, packed, sizeof(packed));
+    text_bytes += len;
+    packed_bytes += packed_len ? packed_len : len;
+
+    // Whole v2 frame with msg id and CRC, as message_handler sends it
+    MeshMessage msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.type = MSG_TYPE_TEXT;
+    msg.msg_id = 1;
+    msg.timestamp = NOW_US;
+    msg.payload_len = (uint8_t)len;
+    memcpy(msg.payload, text, len);
+    uint8_t frame[MAX_SERIALIZED_SIZE];
+    size_t frame_len = 0;
+    serialize_message_v2(&msg, NOW_US, frame, &frame_len);
+    size_t raw_len = frame_len + (packed_len ? len - packed_len : 0);
+    segments_raw += mesh_frame_segment_count(raw_len + 2);
+    segments_packed += mesh_frame_segment_count(frame_len + 2);
+    if (mesh_frame_segment_count(frame_len + 2) == 1)
+      unsegmented++;
+  }
+  printf("corpus: %zu messages, %zu bytes -> %zu bytes (ratio %.3f)\n",
+         CORPUS_SIZE, text_bytes, packed_bytes,
+         (double)packed_bytes / (double)text_bytes);
+  printf("segments: %zu uncompressed -> %zu compressed (%zu saved, "
+         "%zu unsegmented)\n",
+         segments_raw, segments_packed, segments_raw - segments_packed,
+         unsegmented);
+
+  long iters = bench_iters(20000);
+  uint64_t start = bench_now_ns();
+  for (long it = 0; it < iters; it++) {
+    for (size_t i = 0; i < CORPUS_SIZE; i++) {
+      uint8_t packed[MAX_PAYLOAD_SIZE];
+      bench_sink += (uint32_t)text_compress((const uint8_t *)corpus[i],
+                                            strlen(corpus[i]), packed,
+                                            sizeof(packed));
+    }
+  }
+  uint64_t encode_ns = bench_now_ns() - start;
+
+  // Decode what compressed, as stored once
+  uint8_t packed[CORPUS_SIZE][MAX_PAYLOAD_SIZE];
+  size_t packed_len[CORPUS_SIZE];
+  size_t decoded_bytes = 0;
+  for (size_t i = 0; i < CORPUS_SIZE; i++) {
+    packed_len[i] = text_compress((const uint8_t *)corpus[i],
+                                  strlen(corpus[i]), packed[i],
+                                  sizeof(packed[i]));
+    if (packed_len[i])
+      decoded_bytes += strlen(corpus[i]);
+  }
+  start = bench_now_ns();
+  for (long it = 0; it < iters; it++) {
+    for (size_t i = 0; i < CORPUS_SIZE; i++) {
+      uint8_t text[MAX_PAYLOAD_SIZE];
+      if (packed_len[i])
+        bench_sink += (uint32_t)text_decompress(packed[i], packed_len[i],
+                                                text, sizeof(text));
+    }
+  }
+  uint64_t decode_ns = bench_now_ns() - start;
+
+  printf("encode: %.2f ns/byte\n",
+         (double)encode_ns / (double)(iters * (long)text_bytes));
+  printf("decode: %.2f ns/byte (of text)\n",
+         (double)decode_ns / (double)(iters * (long)decoded_bytes));
+  return 0;
+}
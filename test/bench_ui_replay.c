@@ -0,0 +1,254 @@
+// Replays a scripted navigation session through the UI, the display driver
+// and the fake SSD1306 panel, and reports the I2C traffic per frame by kind
+// of step, next to what a full redraw would cost.
+//
+// Messages go through the real receive / send paths (message_handler,
+// delivery, api) with the mesh fake playing the peer.
+
+#include "api.h"
+#include "app_state.h"
+#include "bench_util.h"
+#include "binary_serial.h"
+#include "chat_log.h"
+#include "crc16.h"
+#include "display.h"
+#include "esp_timer.h"
+#include "host_shims.h"
+#include "mesh_fake.h"
+#include "message_handler.h"
+#include "node_config.h"
+#include "panel_fake.h"
+#include "ui_loop.h"
+#include "ui_screens.h"
+#include "user_table.h"
+#include <stdio.h>
+
+#define PEER_ADDR 0x0010
+#define CONTACTS 10
+#define I2C_HZ 400000
+#define I2C_BITS_PER_BYTE 9 // 8 data bits + ACK
+
+// What a full redraw sends: every page as one span
+#define FULL_FRAME_BYTES                                                       \
+  (MAX_DISPLAY_LINES * (DISPLAY_SPAN_HEADER_SIZE + DISPLAY_WIDTH))
+
+typedef enum {
+  STEP_CURSOR,    // Cursor move on a menu or list
+  STEP_LIST,      // List window scrolls with the cursor
+  STEP_SCREEN,    // Screen change
+  STEP_HISTORY,   // Chat history scrolled by a line
+  STEP_RECEIVE,   // New message in the open chat
+  STEP_SEND,      // Message sent, toast shown
+  STEP_DELIVERY,  // Toast follows the delivery state
+  STEP_TOAST_END, // Toast dismissed
+  STEP_KINDS
+} step_kind_t;
+
+static const char *const kind_names[STEP_KINDS] = {
+    "cursor move", "list scroll", "screen change", "history scroll",
+    "new message", "send + toast", "delivery upd", "toast end",
+};
+
+typedef struct {
+  uint32_t frames;
+  uint64_t bytes;
+  uint64_t transfers;
+  uint32_t max_bytes;
+  uint64_t ns;
+} kind_stats_t;
+
+static kind_stats_t kinds[STEP_KINDS];
+static uint8_t next_rx_id = 1;
+
+static size_t peer_frame(const MeshMessage *msg, uint8_t *buf) {
+  size_t len = 0;
+  if (serialize_message_v2(msg, esp_timer_get_time(), buf, &len) != 0)
+    return 0;
+  uint16_t crc = crc16(buf, len);
+  buf[len++] = crc >> 8;
+  buf[len++] = crc & 0xFF;
+  return len;
+}
+
+static void render(void) {
+  ui_process_delivery_updates();
+  ui_process_timeouts();
+  ui_update_display();
+  host_tasks_wait_idle(1000);
+}
+
+// Run one step and charge what reached the panel to its kind
+static void step(step_kind_t kind, void (*action)(joystick_action_t),
+                 joystick_action_t arg) {
+  host_panel_stats_t before, after;
+  host_panel_get_stats(&before);
+  uint64_t start = bench_now_ns();
+
+  action(arg);
+  render();
+
+  kind_stats_t *k = &kinds[kind];
+  k->ns += bench_now_ns() - start;
+  host_panel_get_stats(&after);
+  uint32_t bytes = after.bytes - before.bytes;
+  k->frames++;
+  k->bytes += bytes;
+  k->transfers += after.transfers - before.transfers;
+  if (bytes > k->max_bytes)
+    k->max_bytes = bytes;
+}
+
+static void press(joystick_action_t action) { ui_handle_joystick(action); }
+
+static void peer_sends(joystick_action_t unused) {
+  MeshMessage msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.type = MSG_TYPE_TEXT;
+  msg.msg_id = next_rx_id;
+  next_rx_id = next_rx_id == 255 ? 1 : next_rx_id + 1;
+  msg.timestamp = esp_timer_get_time();
+  snprintf((char *)msg.payload, sizeof(msg.payload), "ok, message %u",
+           msg.msg_id);
+  msg.payload_len = strlen((const char *)msg.payload);
+
+  uint8_t buf[MESH_TX_FRAME_MAX];
+  size_t len = peer_frame(&msg, buf);
+  host_mesh_receive(PEER_ADDR, buf, len);
+
+  // Our ACK goes out after the aggregation window
+  host_clock_advance_ms(MSG_AGG_WINDOW_MS);
+  while (host_mesh_complete(0, NULL)) {
+  }
+}
+
+// Our message leaves after the aggregation window and the peer ACKs it
+static void peer_acks(joystick_action_t unused) {
+  host_clock_advance_ms(MSG_AGG_WINDOW_MS);
+  host_mesh_frame_t frame;
+  if (!host_mesh_complete(0, &frame))
+    return;
+
+  MeshMessage sent;
+  if (deserialize_message(frame.data, frame.len - 2, esp_timer_get_time(),
+                          &sent) != 0)
+    return;
+  MeshMessage ack;
+  memset(&ack, 0, sizeof(ack));
+  ack.type = MSG_TYPE_ACK;
+  ack.msg_id = sent.msg_id;
+  ack.timestamp = esp_timer_get_time();
+  uint8_t buf[MESH_TX_FRAME_MAX];
+  size_t len = peer_frame(&ack, buf);
+  host_clock_advance_ms(100);
+  host_mesh_receive_ack(PEER_ADDR, buf, len);
+}
+
+static void toast_expires(joystick_action_t unused) {
+  host_clock_advance_ms(UI_MESSAGE_SENT_DISPLAY_MS);
+}
+
+// Home -> contact list (scrolled past the window and back) -> chat with the
+// first contact (history scrolled, messages received, one sent) -> home
+static void replay_session(void) {
+  step(STEP_CURSOR, press, JOY_DOWN);
+  step(STEP_CURSOR, press, JOY_UP);
+  step(STEP_SCREEN, press, JOY_BTN);
+
+  for (int i = 0; i < CONTACTS - 1; i++) {
+    bool scrolls = i + 1 >= UI_LIST_VISIBLE_ITEMS;
+    step(scrolls ? STEP_LIST : STEP_CURSOR, press, JOY_DOWN);
+  }
+  for (int i = CONTACTS - 1; i > 0; i--) {
+    bool scrolls = i - 1 < CONTACTS - UI_LIST_VISIBLE_ITEMS;
+    step(scrolls ? STEP_LIST : STEP_CURSOR, press, JOY_UP);
+  }
+  step(STEP_SCREEN, press, JOY_BTN);
+
+  for (int i = 0; i < 4; i++)
+    step(STEP_HISTORY, press, JOY_UP);
+  for (int i = 0; i < 4; i++)
+    step(STEP_HISTORY, press, JOY_DOWN);
+  for (int i = 0; i < 3; i++)
+    step(STEP_RECEIVE, peer_sends, JOY_NONE);
+
+  step(STEP_SCREEN, press, JOY_BTN); // Send Message
+  step(STEP_CURSOR, press, JOY_DOWN);
+  step(STEP_SEND, press, JOY_BTN);
+  step(STEP_DELIVERY, peer_acks, JOY_NONE);
+  step(STEP_TOAST_END, toast_expires, JOY_NONE);
+
+  step(STEP_SCREEN, press, JOY_LEFT);
+  step(STEP_SCREEN, press, JOY_LEFT);
+}
+
+static void setup(void) {
+  host_nvs_reset();
+  host_mesh_reset();
+  host_panel_reset();
+  node_config_init("self");
+  node_config_set_address(0x0001);
+  app_state_init();
+  chat_log_init();
+  user_table_init();
+  user_table_clear();
+  message_handler_register_app_cb(api_on_message_view);
+  message_handler_init();
+
+  static const char *const names[CONTACTS] = {
+      "alice", "bob", "carol", "dave", "erin",
+      "frank", "grace", "heidi", "ivan", "judy",
+  };
+  for (int i = 0; i < CONTACTS; i++) {
+    user_table_set(names[i], (uint16_t)(PEER_ADDR + i));
+  }
+  peer_id_t alice = user_table_peer_id(0);
+  for (int i = 0; i < 12; i++) {
+    chat_log_add(alice, i % 2 ? "Sounds good, see you at the north gate"
+                              : "Where are you?",
+                 i % 2);
+  }
+
+  display_init();
+  ui_init();
+  render();
+}
+
+int main(int argc, char **argv) {
+  bench_parse_args(argc, argv);
+  esp_log_level_set("*", ESP_LOG_ERROR);
+  setup();
+
+  long sessions = bench_iters(200);
+  for (long i = 0; i < sessions; i++) {
+    replay_session();
+  }
+
+  printf("%ld sessions, full redraw = %d bytes\n", sessions,
+         FULL_FRAME_BYTES);
+  printf("%-14s %7s %10s %9s %9s %8s %9s\n", "step", "frames", "bytes/frm",
+         "xfers/frm", "max bytes", "bus ms", "cpu us");
+  uint64_t total_bytes = 0;
+  uint32_t total_frames = 0;
+  for (int k = 0; k < STEP_KINDS; k++) {
+    const kind_stats_t *s = &kinds[k];
+    if (s->frames == 0)
+      continue;
+    double bytes = (double)s->bytes / s->frames;
+    printf("%-14s %7u %10.1f %9.2f %9u %8.2f %9.1f\n", kind_names[k],
+           s->frames, bytes, (double)s->transfers / s->frames, s->max_bytes,
+           bytes * I2C_BITS_PER_BYTE * 1000.0 / I2C_HZ,
+           (double)s->ns / s->frames / 1000.0);
+    total_bytes += s->bytes;
+    total_frames += s->frames;
+  }
+  printf("all: %.1f bytes/frame, %.1f%% of a full redraw\n",
+         (double)total_bytes / total_frames,
+         100.0 * total_bytes / total_frames / FULL_FRAME_BYTES);
+
+  display_stats_t ds;
+  display_get_stats(&ds);
+  printf("display: %lu flushes, %lu dropped, %lu scrolled\n",
+         (unsigned long)ds.flushes, (unsigned long)ds.frames_dropped,
+         (unsigned long)ds.scrolls);
+  return 0;
+}
@@ -0,0 +1,91 @@
+// User directory at 10, 100 and 1000 peers: cost of adding a peer and of
+// looking one up by address and by name. At 1000 the table is full and
+// every new peer evicts the least recently seen one. Inserts include the
+// NVS write of the entry (host stand-in), as on the device.
+//
+// A linear strcmp scan over the same entries, as the directory did before
+// the hash indices, is timed alongside for the name lookup.
+
+#include "bench_util.h"
+#include "host_shims.h"
+#include "user_table.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BASE_ADDR 0x0100
+
+static void name_of(int n, char *name) {
+  snprintf(name, USERNAME_MAX_LEN, "op%d", n);
+}
+
+static int linear_find(const char *name) {
+  for (int i = 0; i < user_table_count(); i++) {
+    if (strcmp(user_table[i].username, name) == 0)
+      return i;
+  }
+  return -1;
+}
+
+static void run(int peers) {
+  host_nvs_reset();
+  user_table_clear();
+  char name[USERNAME_MAX_LEN];
+
+  uint64_t start = bench_now_ns();
+  for (int n = 0; n < peers; n++) {
+    name_of(n, name);
+    user_table_set(name, (uint16_t)(BASE_ADDR + n));
+  }
+  double insert_ns = (double)(bench_now_ns() - start) / peers;
+
+  // Look up the peers still in the table (the newest ones when it evicted)
+  int held = user_table_count();
+  int first = peers - held;
+  long iters = bench_iters(1000000);
+  srand(1);
+  int *picks = malloc(sizeof(int) * 1024);
+  for (int i = 0; i < 1024; i++) {
+    picks[i] = first + rand() % held;
+  }
+
+  start = bench_now_ns();
+  for (long i = 0; i < iters; i++) {
+    bench_sink += user_table_find_index_by_addr(
+        (uint16_t)(BASE_ADDR + picks[i & 1023]));
+  }
+  double addr_ns = (double)(bench_now_ns() - start) / iters;
+
+  char names[1024][USERNAME_MAX_LEN];
+  for (int i = 0; i < 1024; i++) {
+    name_of(picks[i], names[i]);
+  }
+  start = bench_now_ns();
+  for (long i = 0; i < iters; i++) {
+    bench_sink += user_table_find_index_by_name(names[i & 1023]);
+  }
+  double name_ns = (double)(bench_now_ns() - start) / iters;
+
+  start = bench_now_ns();
+  for (long i = 0; i < iters; i++) {
+    bench_sink += linear_find(names[i & 1023]);
+  }
+  double linear_ns = (double)(bench_now_ns() - start) / iters;
+  free(picks);
+
+  printf("%6d %6d %10.1f %10.1f %10.1f %10.1f\n", peers, held, insert_ns,
+         addr_ns, name_ns, linear_ns);
+}
+
+int main(int argc, char **argv) {
+  bench_parse_args(argc, argv);
+  esp_log_level_set("*", ESP_LOG_ERROR);
+  user_table_init();
+
+  printf("%d entries max, ns per operation\n", MAX_USERS);
+  printf("%6s %6s %10s %10s %10s %10s\n", "peers", "held", "insert",
+         "by addr", "by name", "name scan");
+  run(10);
+  run(100);
+  run(1000);
+  return 0;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+// Microbenchmark helpers. Every bench takes --quick (used by ctest) to run
+// a few iterations only, as a smoke test of the bench itself.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+static bool bench_quick = false;
+
+static inline void bench_parse_args(int argc, char **argv) {
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--quick") == 0)
+      bench_quick = true;
+  }
+}
+
+// Iterations to run: n, or a handful with --quick
+static inline long bench_iters(long n) {
+  return bench_quick ? (n < 10 ? n : 10) : n;
+}
+
+static inline uint64_t bench_now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+// Keeps the compiler from dropping a computed value
+static volatile uint32_t bench_sink;
@@ -0,0 +1,115 @@
+#include "flash_fake.h"
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static FILE *file = NULL;
+static chat_store_flash_t flash;
+static host_flash_stats_t stats;
+static bool cut_armed = false;
+static size_t cut_after = 0;
+static bool powered_off = false;
+
+static bool in_range(size_t addr, size_t len) {
+  return file && addr <= flash.size && len <= flash.size - addr;
+}
+
+static int flash_read(void *ctx, size_t addr, void *buf, size_t len) {
+  if (!in_range(addr, len) || powered_off)
+    return -1;
+  if (pread(fileno(file), buf, len, (off_t)addr) != (ssize_t)len)
+    return -1;
+  stats.reads++;
+  stats.bytes_read += len;
+  return 0;
+}
+
+static int flash_write(void *ctx, size_t addr, const void *buf, size_t len) {
+  uint8_t cell[CHAT_STORE_SEGMENT_SIZE];
+  if (!in_range(addr, len) || len > sizeof(cell) || powered_off)
+    return -1;
+
+  size_t programmed = len;
+  if (cut_armed && cut_after < len) {
+    programmed = cut_after;
+    powered_off = true;
+  }
+  if (pread(fileno(file), cell, programmed, (off_t)addr) !=
+      (ssize_t)programmed)
+    return -1;
+  const uint8_t *src = buf;
+  for (size_t i = 0; i < programmed; i++) {
+    cell[i] &= src[i]; // Programming only clears bits
+  }
+  if (pwrite(fileno(file), cell, programmed, (off_t)addr) !=
+      (ssize_t)programmed)
+    return -1;
+
+  stats.writes++;
+  stats.bytes_written += programmed;
+  return powered_off ? -1 : 0;
+}
+
+static int flash_erase(void *ctx, size_t addr, size_t len) {
+  uint8_t erased[CHAT_STORE_SEGMENT_SIZE];
+  if (!in_range(addr, len) || addr % CHAT_STORE_SEGMENT_SIZE != 0 ||
+      len % CHAT_STORE_SEGMENT_SIZE != 0 || powered_off)
+    return -1;
+
+  memset(erased, 0xFF, sizeof(erased));
+  for (size_t off = 0; off < len; off += CHAT_STORE_SEGMENT_SIZE) {
+    if (pwrite(fileno(file), erased, sizeof(erased), (off_t)(addr + off)) !=
+        (ssize_t)sizeof(erased))
+      return -1;
+    stats.erases++;
+  }
+  return 0;
+}
+
+const chat_store_flash_t *host_flash_open(const char *path, size_t size) {
+  host_flash_close();
+
+  struct stat st;
+  bool keep = path && stat(path, &st) == 0 && (size_t)st.st_size == size;
+  file = path ? fopen(path, keep ? "r+b" : "w+b") : tmpfile();
+  if (!file)
+    return NULL;
+
+  memset(&flash, 0, sizeof(flash));
+  flash.read = flash_read;
+  flash.write = flash_write;
+  flash.erase = flash_erase;
+  flash.size = size;
+  memset(&stats, 0, sizeof(stats));
+  host_flash_power_on();
+
+  if (!keep) {
+    for (size_t addr = 0; addr < size; addr += CHAT_STORE_SEGMENT_SIZE) {
+      if (flash_erase(NULL, addr, CHAT_STORE_SEGMENT_SIZE) != 0) {
+        host_flash_close();
+        return NULL;
+      }
+    }
+    stats.erases = 0;
+  }
+  return &flash;
+}
+
+void host_flash_close(void) {
+  if (file)
+    fclose(file);
+  file = NULL;
+}
+
+void host_flash_get_stats(host_flash_stats_t *out) { *out = stats; }
+
+void host_flash_cut_power_after(size_t bytes) {
+  cut_armed = true;
+  cut_after = bytes;
+}
+
+void host_flash_power_on(void) {
+  cut_armed = false;
+  powered_off = false;
+}
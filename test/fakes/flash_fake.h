@@ -0,0 +1,32 @@
+#pragma once
+
+// File-backed flash for the chat store. Behaves like NOR flash: erase sets
+// whole CHAT_STORE_SEGMENT_SIZE segments to 0xFF, a write can only clear
+// bits. The file outlives the process, so a store can be remounted from it
+// as after a reboot. One flash at a time.
+
+#include "chat_store.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+  uint32_t reads;
+  uint64_t bytes_read;
+  uint32_t writes;
+  uint64_t bytes_written; // Bytes programmed
+  uint32_t erases;        // Segments erased
+} host_flash_stats_t;
+
+// Open the flash of size bytes on path, created erased if missing or of
+// another size. NULL path: an anonymous temporary file. Counters are zeroed.
+// Returns NULL on I/O error.
+const chat_store_flash_t *host_flash_open(const char *path, size_t size);
+void host_flash_close(void);
+
+void host_flash_get_stats(host_flash_stats_t *out);
+
+// Power loss: the next write programs only its first bytes and fails, as
+// do all writes and erases after it until host_flash_power_on()
+void host_flash_cut_power_after(size_t bytes);
+void host_flash_power_on(void);
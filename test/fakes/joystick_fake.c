@@ -0,0 +1,12 @@
+// Host replacement for joystick.c: no ADC or GPIO. The UI loop links
+// against these; tests drive the UI with ui_handle_joystick() instead.
+
+#include "joystick.h"
+
+joystick_action_t joystick_get_action(void) { return JOY_NONE; }
+
+bool joystick_is_active(void) { return false; }
+
+bool joystick_is_calibrated(void) { return true; }
+
+void joystick_enable_wakeup(TaskHandle_t task) {}
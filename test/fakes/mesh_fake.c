@@ -0,0 +1,116 @@
+#include "mesh_fake.h"
+#include <pthread.h>
+#include <string.h>
+
+static pthread_mutex_t fake_lock = PTHREAD_MUTEX_INITIALIZER;
+static mesh_receive_cb_t app_receive_cb = NULL;
+static mesh_receive_cb_t ack_receive_cb = NULL;
+static mesh_tx_done_cb_t tx_done_cb = NULL;
+
+static host_mesh_frame_t queue[MESH_TX_QUEUE_LEN];
+static size_t queue_head = 0;
+static size_t queue_count = 0;
+
+static int fake_queue(const uint8_t *data, size_t data_len,
+                      uint16_t receiver_add, uint32_t tx_id, bool ack) {
+  if (!data || data_len == 0 || data_len > MESH_TX_FRAME_MAX)
+    return -1;
+
+  pthread_mutex_lock(&fake_lock);
+  if (queue_count == MESH_TX_QUEUE_LEN) {
+    pthread_mutex_unlock(&fake_lock);
+    return -1;
+  }
+  host_mesh_frame_t *frame =
+      &queue[(queue_head + queue_count) % MESH_TX_QUEUE_LEN];
+  frame->receiver_add = receiver_add;
+  frame->tx_id = tx_id;
+  frame->ack = ack;
+  frame->len = data_len;
+  memcpy(frame->data, data, data_len);
+  queue_count++;
+  pthread_mutex_unlock(&fake_lock);
+  return 0;
+}
+
+int mesh_send_raw(const uint8_t *data, size_t data_len,
+                  uint16_t receiver_add) {
+  return fake_queue(data, data_len, receiver_add, 0, false);
+}
+
+void mesh_tx_init(void) {}
+
+void mesh_rx_init(void) {}
+
+int mesh_send_async(const uint8_t *data, size_t data_len,
+                    uint16_t receiver_add, uint32_t tx_id) {
+  return fake_queue(data, data_len, receiver_add, tx_id, false);
+}
+
+int mesh_send_ack_async(const uint8_t *data, size_t data_len,
+                        uint16_t receiver_add) {
+  return fake_queue(data, data_len, receiver_add, 0, true);
+}
+
+void mesh_register_ack_cb(mesh_receive_cb_t cb) { ack_receive_cb = cb; }
+
+void mesh_register_tx_done_cb(mesh_tx_done_cb_t cb) { tx_done_cb = cb; }
+
+void mesh_on_send_complete(int err_code) {}
+
+void mesh_register_receive_cb(mesh_receive_cb_t cb) { app_receive_cb = cb; }
+
+bool mesh_broadcast_self(const uint8_t *buffer, size_t buffer_len) {
+  return fake_queue(buffer, buffer_len, 0xFFFF, 0, false) == 0;
+}
+
+void mesh_vendor_model_cb(esp_ble_mesh_model_cb_event_t event,
+                          esp_ble_mesh_model_cb_param_t *param) {}
+
+void host_mesh_reset(void) {
+  pthread_mutex_lock(&fake_lock);
+  queue_head = 0;
+  queue_count = 0;
+  app_receive_cb = NULL;
+  ack_receive_cb = NULL;
+  tx_done_cb = NULL;
+  pthread_mutex_unlock(&fake_lock);
+}
+
+size_t host_mesh_queued(void) {
+  pthread_mutex_lock(&fake_lock);
+  size_t count = queue_count;
+  pthread_mutex_unlock(&fake_lock);
+  return count;
+}
+
+bool host_mesh_complete(int err, host_mesh_frame_t *out) {
+  host_mesh_frame_t frame;
+
+  pthread_mutex_lock(&fake_lock);
+  if (queue_count == 0) {
+    pthread_mutex_unlock(&fake_lock);
+    return false;
+  }
+  frame = queue[queue_head];
+  queue_head = (queue_head + 1) % MESH_TX_QUEUE_LEN;
+  queue_count--;
+  pthread_mutex_unlock(&fake_lock);
+
+  if (out)
+    *out = frame;
+  if (tx_done_cb)
+    tx_done_cb(frame.receiver_add, frame.tx_id, err);
+  return true;
+}
+
+void host_mesh_receive(uint16_t src_addr, const uint8_t *data, size_t len) {
+  if (app_receive_cb)
+    app_receive_cb(src_addr, data, len);
+}
+
+void host_mesh_receive_ack(uint16_t src_addr, const uint8_t *data,
+                           size_t len) {
+  if (ack_receive_cb)
+    ack_receive_cb(src_addr, data, len);
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+// Host replacement for mesh.c: queued frames are captured instead of sent,
+// and tests play the BLE stack by completing them or injecting received
+// frames. Implements the whole of mesh.h.
+
+#include "mesh.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+  uint16_t receiver_add;
+  uint32_t tx_id;
+  bool ack; // Queued with mesh_send_ack_async()
+  size_t len;
+  uint8_t data[MESH_TX_FRAME_MAX];
+} host_mesh_frame_t;
+
+// Drop queued frames and registered callbacks
+void host_mesh_reset(void);
+
+// Frames queued and not completed yet (at most MESH_TX_QUEUE_LEN)
+size_t host_mesh_queued(void);
+
+// Complete the oldest queued frame with err (0 = sent), copying it to out
+// (may be NULL) and running the TX done callback as the mesh TX task would.
+// Returns false if nothing is queued.
+bool host_mesh_complete(int err, host_mesh_frame_t *out);
+
+// Deliver a frame as if received on the message / ACK opcode
+void host_mesh_receive(uint16_t src_addr, const uint8_t *data, size_t len);
+void host_mesh_receive_ack(uint16_t src_addr, const uint8_t *data,
+                           size_t len);
@@ -0,0 +1,40 @@
+#pragma once
+
+// Test hooks of the fake SSD1306 panel behind display.c. The fake decodes
+// every I2C transfer (page addressing, column/page pointers, display start
+// line) into its own GDDRAM, so what the tests see is what a real panel
+// would show, and counts the bus traffic it took. Only the unflipped
+// orientation is modelled.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define HOST_PANEL_WIDTH 128
+#define HOST_PANEL_HEIGHT 64
+
+typedef struct {
+  uint32_t transfers;     // i2c_master_transmit() calls
+  uint32_t bytes;         // Bytes on the bus, control bytes included
+  uint32_t data_bytes;    // GDDRAM bytes written
+  uint32_t commands;      // Commands decoded
+  uint32_t start_lines;   // Of which display start line commands
+  uint32_t unknown;       // Commands the fake does not model
+} host_panel_stats_t;
+
+// Blank GDDRAM, start line 0, counters zeroed
+void host_panel_reset(void);
+
+void host_panel_get_stats(host_panel_stats_t *out);
+
+// Visible pixel (start line applied), true if lit
+bool host_panel_pixel(int x, int y);
+
+// Write the visible image as a plain PBM (P1). Returns false on I/O error.
+bool host_panel_write_pbm(const char *path);
+
+// Pixels that differ from a PBM written by host_panel_write_pbm(), -1 if
+// the file is missing or not a 128x64 P1 image
+int host_panel_diff_pbm(const char *path);
+
+// Draw the visible image to stderr, for failed comparisons
+void host_panel_dump(void);
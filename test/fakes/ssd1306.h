@@ -0,0 +1,32 @@
+#pragma once
+
+// Host replacement for the nopnop2002/ssd1306 component: the device struct,
+// the protocol constants display.c uses and the two init calls. The panel
+// behind it is the fake in ssd1306_fake.c (hooks in panel_fake.h).
+
+#include "driver/i2c_master.h"
+#include "sdkconfig.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Control byte ahead of commands / data (Co bit 7, D/C# bit 6)
+#define OLED_CONTROL_BYTE_CMD_SINGLE 0x80
+#define OLED_CONTROL_BYTE_CMD_STREAM 0x00
+#define OLED_CONTROL_BYTE_DATA_SINGLE 0xC0
+#define OLED_CONTROL_BYTE_DATA_STREAM 0x40
+
+#define OLED_CMD_SET_DISPLAY_START_LINE 0x40 // OR'ed with the line 0-63
+
+typedef struct {
+  int _address;
+  int _width;
+  int _height;
+  int _pages;
+  bool _flip;
+  i2c_master_bus_handle_t _i2c_bus_handle;
+  i2c_master_dev_handle_t _i2c_dev_handle;
+} SSD1306_t;
+
+void i2c_device_add(SSD1306_t *dev, i2c_port_t i2c_num, int16_t reset,
+                    uint16_t i2c_address);
+void ssd1306_init(SSD1306_t *dev, int width, int height);
@@ -0,0 +1,214 @@
+#include "panel_fake.h"
+#include "ssd1306.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#define PANEL_PAGES (HOST_PANEL_HEIGHT / 8)
+
+struct host_i2c_bus {
+  size_t queue_depth;
+};
+
+struct host_i2c_dev {
+  i2c_master_event_callbacks_t cbs;
+  void *user_data;
+};
+
+static pthread_mutex_t fake_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct host_i2c_bus bus;
+static struct host_i2c_dev device;
+
+// Panel state: GDDRAM in page layout plus the pointers the commands set
+static uint8_t gddram[PANEL_PAGES][HOST_PANEL_WIDTH];
+static int column = 0;
+static int page = 0;
+static int start_line = 0;
+static host_panel_stats_t stats;
+
+esp_err_t i2c_new_master_bus(const i2c_master_bus_config_t *bus_config,
+                             i2c_master_bus_handle_t *ret_bus_handle) {
+  if (!bus_config || !ret_bus_handle)
+    return ESP_ERR_INVALID_ARG;
+  bus.queue_depth = bus_config->trans_queue_depth;
+  *ret_bus_handle = &bus;
+  return ESP_OK;
+}
+
+void i2c_device_add(SSD1306_t *dev, i2c_port_t i2c_num, int16_t reset,
+                    uint16_t i2c_address) {
+  memset(&device, 0, sizeof(device));
+  dev->_address = i2c_address;
+  dev->_i2c_dev_handle = &device;
+}
+
+// The real init sends the power-up command sequence; the fake panel comes
+// up blank, so only the geometry is set
+void ssd1306_init(SSD1306_t *dev, int width, int height) {
+  dev->_width = width;
+  dev->_height = height;
+  dev->_pages = height / 8;
+  dev->_flip = false;
+}
+
+esp_err_t
+i2c_master_register_event_callbacks(i2c_master_dev_handle_t i2c_dev,
+                                    const i2c_master_event_callbacks_t *cbs,
+                                    void *user_data) {
+  if (!i2c_dev || !cbs)
+    return ESP_ERR_INVALID_ARG;
+  i2c_dev->cbs = *cbs;
+  i2c_dev->user_data = user_data;
+  return ESP_OK;
+}
+
+static void panel_command(uint8_t cmd) {
+  stats.commands++;
+  if (cmd <= 0x0F) {
+    column = (column & 0xF0) | cmd; // Lower column start address
+  } else if (cmd <= 0x1F) {
+    column = (column & 0x0F) | ((cmd & 0x0F) << 4); // Higher column
+  } else if (cmd >= 0x40 && cmd <= 0x7F) {
+    start_line = cmd & 0x3F;
+    stats.start_lines++;
+  } else if (cmd >= 0xB0 && cmd <= 0xB7) {
+    page = cmd & 0x07;
+  } else {
+    stats.unknown++;
+  }
+}
+
+static void panel_data(uint8_t data) {
+  // Page addressing mode: the column wraps, the page stays
+  gddram[page][column % HOST_PANEL_WIDTH] = data;
+  column = (column + 1) % HOST_PANEL_WIDTH;
+  stats.data_bytes++;
+}
+
+esp_err_t i2c_master_transmit(i2c_master_dev_handle_t i2c_dev,
+                              const uint8_t *write_buffer, size_t write_size,
+                              int xfer_timeout_ms) {
+  if (!i2c_dev || !write_buffer || write_size == 0)
+    return ESP_ERR_INVALID_ARG;
+
+  pthread_mutex_lock(&fake_lock);
+  stats.transfers++;
+  stats.bytes += write_size;
+
+  size_t i = 0;
+  while (i < write_size) {
+    uint8_t control = write_buffer[i++];
+    bool is_data = control & 0x40;
+    // Co = 1: one byte follows, then another control byte. Co = 0: the rest
+    // of the transfer is a stream of the same kind.
+    size_t end = (control & 0x80) && i < write_size ? i + 1 : write_size;
+    for (; i < end; i++) {
+      if (is_data)
+        panel_data(write_buffer[i]);
+      else
+        panel_command(write_buffer[i]);
+    }
+  }
+  pthread_mutex_unlock(&fake_lock);
+
+  if (i2c_dev->cbs.on_trans_done) {
+    i2c_master_event_data_t evt = {.event = I2C_EVENT_DONE};
+    i2c_dev->cbs.on_trans_done(i2c_dev, &evt, i2c_dev->user_data);
+  }
+  return ESP_OK;
+}
+
+void host_panel_reset(void) {
+  pthread_mutex_lock(&fake_lock);
+  memset(gddram, 0, sizeof(gddram));
+  column = 0;
+  page = 0;
+  start_line = 0;
+  memset(&stats, 0, sizeof(stats));
+  pthread_mutex_unlock(&fake_lock);
+}
+
+void host_panel_get_stats(host_panel_stats_t *out) {
+  pthread_mutex_lock(&fake_lock);
+  *out = stats;
+  pthread_mutex_unlock(&fake_lock);
+}
+
+// Row y of the screen shows GDDRAM row (y + start line) % 64
+static bool pixel_locked(int x, int y) {
+  int row = (y + start_line) % HOST_PANEL_HEIGHT;
+  return (gddram[row / 8][x] >> (row % 8)) & 1;
+}
+
+bool host_panel_pixel(int x, int y) {
+  if (x < 0 || x >= HOST_PANEL_WIDTH || y < 0 || y >= HOST_PANEL_HEIGHT)
+    return false;
+  pthread_mutex_lock(&fake_lock);
+  bool lit = pixel_locked(x, y);
+  pthread_mutex_unlock(&fake_lock);
+  return lit;
+}
+
+bool host_panel_write_pbm(const char *path) {
+  FILE *f = fopen(path, "w");
+  if (!f)
+    return false;
+
+  // Same layout as display_print_pbm(): one row of 0/1 per line
+  fprintf(f, "P1\n%d %d\n", HOST_PANEL_WIDTH, HOST_PANEL_HEIGHT);
+  pthread_mutex_lock(&fake_lock);
+  for (int y = 0; y < HOST_PANEL_HEIGHT; y++) {
+    for (int x = 0; x < HOST_PANEL_WIDTH; x++) {
+      fputc(pixel_locked(x, y) ? '1' : '0', f);
+    }
+    fputc('\n', f);
+  }
+  pthread_mutex_unlock(&fake_lock);
+  return fclose(f) == 0;
+}
+
+int host_panel_diff_pbm(const char *path) {
+  FILE *f = fopen(path, "r");
+  if (!f)
+    return -1;
+
+  int width = 0, height = 0;
+  if (fscanf(f, "P1 %d %d", &width, &height) != 2 ||
+      width != HOST_PANEL_WIDTH || height != HOST_PANEL_HEIGHT) {
+    fclose(f);
+    return -1;
+  }
+
+  int diff = 0;
+  pthread_mutex_lock(&fake_lock);
+  for (int y = 0; y < HOST_PANEL_HEIGHT && diff >= 0; y++) {
+    for (int x = 0; x < HOST_PANEL_WIDTH; x++) {
+      int c;
+      do {
+        c = fgetc(f);
+      } while (c == ' ' || c == '\n' || c == '\r' || c == '\t');
+      if (c != '0' && c != '1') {
+        diff = -1; // Truncated
+        break;
+      }
+      diff += (c == '1') != pixel_locked(x, y);
+    }
+  }
+  pthread_mutex_unlock(&fake_lock);
+  fclose(f);
+  return diff;
+}
+
+void host_panel_dump(void) {
+  pthread_mutex_lock(&fake_lock);
+  for (int y = 0; y < HOST_PANEL_HEIGHT; y++) {
+    char row[HOST_PANEL_WIDTH + 2];
+    for (int x = 0; x < HOST_PANEL_WIDTH; x++) {
+      row[x] = pixel_locked(x, y) ? '#' : '.';
+    }
+    row[HOST_PANEL_WIDTH] = '\n';
+    row[HOST_PANEL_WIDTH + 1] = '\0';
+    fputs(row, stderr);
+  }
+  pthread_mutex_unlock(&fake_lock);
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+// Host stand-in for ESP-IDF driver/i2c_master.h: the part display.c uses.
+// Transfers are decoded by the fake panel in fakes/ssd1306_fake.c.
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef int i2c_port_t;
+typedef int i2c_port_num_t;
+#define I2C_NUM_0 0
+
+typedef enum { I2C_CLK_SRC_DEFAULT } i2c_clock_source_t;
+
+typedef struct host_i2c_bus *i2c_master_bus_handle_t;
+typedef struct host_i2c_dev *i2c_master_dev_handle_t;
+
+typedef struct {
+  i2c_port_num_t i2c_port;
+  int sda_io_num;
+  int scl_io_num;
+  i2c_clock_source_t clk_source;
+  uint32_t glitch_ignore_cnt;
+  int intr_priority;
+  size_t trans_queue_depth;
+  struct {
+    uint32_t enable_internal_pullup : 1;
+  } flags;
+} i2c_master_bus_config_t;
+
+typedef enum {
+  I2C_EVENT_ALIVE,
+  I2C_EVENT_DONE,
+  I2C_EVENT_NACK,
+} i2c_master_event_t;
+
+typedef struct {
+  i2c_master_event_t event;
+} i2c_master_event_data_t;
+
+typedef bool (*i2c_master_callback_t)(i2c_master_dev_handle_t i2c_dev,
+                                      const i2c_master_event_data_t *evt,
+                                      void *arg);
+
+typedef struct {
+  i2c_master_callback_t on_trans_done;
+} i2c_master_event_callbacks_t;
+
+esp_err_t i2c_new_master_bus(const i2c_master_bus_config_t *bus_config,
+                             i2c_master_bus_handle_t *ret_bus_handle);
+
+// With a callback registered, transfers are "queued": the fake completes
+// them at once, calling on_trans_done from the transmitting thread
+esp_err_t
+i2c_master_register_event_callbacks(i2c_master_dev_handle_t i2c_dev,
+                                    const i2c_master_event_callbacks_t *cbs,
+                                    void *user_data);
+
+esp_err_t i2c_master_transmit(i2c_master_dev_handle_t i2c_dev,
+                              const uint8_t *write_buffer, size_t write_size,
+                              int xfer_timeout_ms);
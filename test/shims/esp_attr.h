@@ -0,0 +1,6 @@
+#pragma once
+
+// Host stand-in for ESP-IDF esp_attr.h (placement attributes are no-ops)
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define RTC_DATA_ATTR
@@ -0,0 +1,14 @@
+#pragma once
+
+// Host stand-in for the BLE Mesh types named in mesh.h
+
+#include <stdint.h>
+
+typedef enum {
+  ESP_BLE_MESH_MODEL_OPERATION_EVT,
+  ESP_BLE_MESH_MODEL_SEND_COMP_EVT,
+} esp_ble_mesh_model_cb_event_t;
+
+typedef struct {
+  int unused;
+} esp_ble_mesh_model_cb_param_t;
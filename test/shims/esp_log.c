@@ -0,0 +1,91 @@
+#include "esp_log.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+#include "host_shims.h"
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+
+static esp_log_level_t print_level = ESP_LOG_WARN;
+static atomic_uint level_counts[ESP_LOG_VERBOSE + 1];
+static uint32_t random_state = 1;
+
+void esp_log_level_set(const char *tag, esp_log_level_t level) {
+  print_level = level;
+}
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format,
+                   ...) {
+  if (level > ESP_LOG_NONE && level <= ESP_LOG_VERBOSE)
+    atomic_fetch_add(&level_counts[level], 1);
+  if (level > print_level)
+    return;
+
+  static const char letters[] = "NEWIDV";
+  va_list args;
+  va_start(args, format);
+  fprintf(stderr, "%c (%lu) %s: ", letters[level],
+          (unsigned long)esp_log_timestamp(), tag);
+  vfprintf(stderr, format, args);
+  fputc('\n', stderr);
+  va_end(args);
+}
+
+uint32_t esp_log_timestamp(void) {
+  return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+uint32_t host_log_count(esp_log_level_t level) {
+  if (level <= ESP_LOG_NONE || level > ESP_LOG_VERBOSE)
+    return 0;
+  return atomic_load(&level_counts[level]);
+}
+
+void host_log_reset_counts(void) {
+  for (int i = 0; i <= ESP_LOG_VERBOSE; i++) {
+    atomic_store(&level_counts[i], 0);
+  }
+}
+
+const char *esp_err_to_name(esp_err_t code) {
+  switch (code) {
+  case ESP_OK:
+    return "ESP_OK";
+  case ESP_FAIL:
+    return "ESP_FAIL";
+  case ESP_ERR_NO_MEM:
+    return "ESP_ERR_NO_MEM";
+  case ESP_ERR_INVALID_ARG:
+    return "ESP_ERR_INVALID_ARG";
+  case ESP_ERR_INVALID_STATE:
+    return "ESP_ERR_INVALID_STATE";
+  case ESP_ERR_INVALID_SIZE:
+    return "ESP_ERR_INVALID_SIZE";
+  case ESP_ERR_NOT_FOUND:
+    return "ESP_ERR_NOT_FOUND";
+  case ESP_ERR_TIMEOUT:
+    return "ESP_ERR_TIMEOUT";
+  case ESP_ERR_NVS_NOT_FOUND:
+    return "ESP_ERR_NVS_NOT_FOUND";
+  case ESP_ERR_NVS_NOT_ENOUGH_SPACE:
+    return "ESP_ERR_NVS_NOT_ENOUGH_SPACE";
+  case ESP_ERR_NVS_INVALID_LENGTH:
+    return "ESP_ERR_NVS_INVALID_LENGTH";
+  case ESP_ERR_NVS_PART_NOT_FOUND:
+    return "ESP_ERR_NVS_PART_NOT_FOUND";
+  default:
+    return "UNKNOWN ERROR";
+  }
+}
+
+// xorshift32: reproducible runs instead of hardware entropy
+uint32_t esp_random(void) {
+  uint32_t x = random_state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  random_state = x;
+  return x;
+}
+
+void host_random_seed(uint32_t seed) { random_state = seed ? seed : 1; }
@@ -0,0 +1,33 @@
+#pragma once
+
+// Host stand-in for ESP-IDF esp_log.h: messages go to stderr, filtered by
+// level (ESP_LOG_WARN by default so test output stays readable)
+
+#include "esp_err.h"
+#include <stdint.h>
+
+typedef enum {
+  ESP_LOG_NONE,
+  ESP_LOG_ERROR,
+  ESP_LOG_WARN,
+  ESP_LOG_INFO,
+  ESP_LOG_DEBUG,
+  ESP_LOG_VERBOSE
+} esp_log_level_t;
+
+// Only the "*" tag is supported
+void esp_log_level_set(const char *tag, esp_log_level_t level);
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format,
+                   ...);
+uint32_t esp_log_timestamp(void);
+
+#define ESP_LOGE(tag, format, ...)                                             \
+  esp_log_write(ESP_LOG_ERROR, tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...)                                             \
+  esp_log_write(ESP_LOG_WARN, tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...)                                             \
+  esp_log_write(ESP_LOG_INFO, tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...)                                             \
+  esp_log_write(ESP_LOG_DEBUG, tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...)                                             \
+  esp_log_write(ESP_LOG_VERBOSE, tag, format, ##__VA_ARGS__)
@@ -0,0 +1,6 @@
+#pragma once
+
+#include <stdint.h>
+
+// Host stand-in: deterministic generator, see host_random_seed()
+uint32_t esp_random(void);
@@ -0,0 +1,142 @@
+#include "esp_timer.h"
+#include "host_shims.h"
+#include <pthread.h>
+#include <stdlib.h>
+
+// Virtual time starts past 0, which some code uses for "never"
+#define HOST_CLOCK_START_US 1000000
+
+struct esp_timer {
+  esp_timer_cb_t callback;
+  void *arg;
+  bool active;
+  int64_t deadline;
+  uint64_t period_us; // 0 for one-shot timers
+  struct esp_timer *next;
+};
+
+static pthread_mutex_t timer_lock = PTHREAD_MUTEX_INITIALIZER;
+static int64_t now_us = HOST_CLOCK_START_US;
+static struct esp_timer *timers = NULL;
+
+int64_t esp_timer_get_time(void) {
+  pthread_mutex_lock(&timer_lock);
+  int64_t now = now_us;
+  pthread_mutex_unlock(&timer_lock);
+  return now;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args,
+                           esp_timer_handle_t *out_handle) {
+  if (!create_args || !create_args->callback || !out_handle)
+    return ESP_ERR_INVALID_ARG;
+
+  struct esp_timer *timer = calloc(1, sizeof(*timer));
+  if (!timer)
+    return ESP_ERR_NO_MEM;
+  timer->callback = create_args->callback;
+  timer->arg = create_args->arg;
+
+  pthread_mutex_lock(&timer_lock);
+  timer->next = timers;
+  timers = timer;
+  pthread_mutex_unlock(&timer_lock);
+
+  *out_handle = timer;
+  return ESP_OK;
+}
+
+static esp_err_t timer_start(esp_timer_handle_t timer, uint64_t timeout_us,
+                             uint64_t period_us) {
+  if (!timer)
+    return ESP_ERR_INVALID_ARG;
+
+  esp_err_t err = ESP_OK;
+  pthread_mutex_lock(&timer_lock);
+  if (timer->active) {
+    err = ESP_ERR_INVALID_STATE; // As in ESP-IDF: stop it first
+  } else {
+    timer->active = true;
+    timer->deadline = now_us + (int64_t)timeout_us;
+    timer->period_us = period_us;
+  }
+  pthread_mutex_unlock(&timer_lock);
+  return err;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us) {
+  return timer_start(timer, timeout_us, 0);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer,
+                                   uint64_t period_us) {
+  return timer_start(timer, period_us, period_us);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+  if (!timer)
+    return ESP_ERR_INVALID_ARG;
+
+  pthread_mutex_lock(&timer_lock);
+  esp_err_t err = timer->active ? ESP_OK : ESP_ERR_INVALID_STATE;
+  timer->active = false;
+  pthread_mutex_unlock(&timer_lock);
+  return err;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+  if (!timer)
+    return ESP_ERR_INVALID_ARG;
+
+  pthread_mutex_lock(&timer_lock);
+  for (struct esp_timer **p = &timers; *p; p = &(*p)->next) {
+    if (*p == timer) {
+      *p = timer->next;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&timer_lock);
+  free(timer);
+  return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer) {
+  pthread_mutex_lock(&timer_lock);
+  bool active = timer && timer->active;
+  pthread_mutex_unlock(&timer_lock);
+  return active;
+}
+
+void host_clock_advance_us(int64_t us) {
+  pthread_mutex_lock(&timer_lock);
+  int64_t target = now_us + us;
+
+  for (;;) {
+    struct esp_timer *due = NULL;
+    for (struct esp_timer *t = timers; t; t = t->next) {
+      if (t->active && t->deadline <= target &&
+          (!due || t->deadline < due->deadline))
+        due = t;
+    }
+    if (!due)
+      break;
+
+    if (due->deadline > now_us)
+      now_us = due->deadline;
+    if (due->period_us > 0) {
+      due->deadline += (int64_t)due->period_us;
+    } else {
+      due->active = false;
+    }
+
+    // Callbacks may start and stop timers
+    pthread_mutex_unlock(&timer_lock);
+    due->callback(due->arg);
+    pthread_mutex_lock(&timer_lock);
+  }
+
+  now_us = target;
+  pthread_mutex_unlock(&timer_lock);
+}
+
+void host_clock_advance_ms(int64_t ms) { host_clock_advance_us(ms * 1000); }
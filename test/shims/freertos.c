@@ -0,0 +1,432 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "host_shims.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * All kernel objects are guarded by one lock and waiters sleep on one
+ * condition, re-checking what they wait for after every state change. A
+ * task that found nothing to do since the last change is marked waiting,
+ * which host_tasks_wait_idle() looks for.
+ */
+struct host_task {
+  TaskFunction_t fn;
+  void *arg;
+  uint32_t notify;
+  bool waiting;
+  bool listed; // Created by xTaskCreate(), counted by host_tasks_wait_idle()
+  struct host_task *next;
+};
+
+struct host_queue {
+  uint8_t *items; // NULL for semaphores
+  UBaseType_t length;
+  UBaseType_t item_size;
+  UBaseType_t count;
+  UBaseType_t head;
+  struct host_task *owner; // Recursive mutexes only
+  UBaseType_t depth;
+};
+
+static pthread_mutex_t kernel_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t kernel_cond; // State changed
+static pthread_cond_t idle_cond;   // A task started waiting or ended
+static pthread_once_t kernel_once = PTHREAD_ONCE_INIT;
+static struct host_task *tasks = NULL;
+static _Thread_local struct host_task *current = NULL;
+static void (*take_hook)(void) = NULL; // host_on_next_semaphore_take()
+
+static void kernel_init(void) {
+  pthread_condattr_t attr;
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&kernel_cond, &attr);
+  pthread_cond_init(&idle_cond, &attr);
+  pthread_condattr_destroy(&attr);
+}
+
+static void kernel_enter(void) {
+  pthread_once(&kernel_once, kernel_init);
+  pthread_mutex_lock(&kernel_lock);
+}
+
+static void kernel_exit(void) { pthread_mutex_unlock(&kernel_lock); }
+
+// Wake every waiter to re-check (lock held)
+static void kernel_changed(void) {
+  for (struct host_task *t = tasks; t; t = t->next) {
+    t->waiting = false;
+  }
+  pthread_cond_broadcast(&kernel_cond);
+}
+
+static struct timespec deadline_after(uint32_t ms) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  ts.tv_sec += ms / 1000;
+  ts.tv_nsec += (long)(ms % 1000) * 1000000L;
+  if (ts.tv_nsec >= 1000000000L) {
+    ts.tv_sec++;
+    ts.tv_nsec -= 1000000000L;
+  }
+  return ts;
+}
+
+// The calling thread as a task; threads not created by xTaskCreate() get
+// an unlisted one so they can take notifications too
+static struct host_task *self(void) {
+  if (!current) {
+    current = calloc(1, sizeof(*current));
+  }
+  return current;
+}
+
+// Block (lock held) until ready(obj) or the timeout. Returns ready(obj).
+static bool kernel_wait(bool (*ready)(void *), void *obj, TickType_t ticks) {
+  struct timespec deadline;
+  if (ticks != portMAX_DELAY)
+    deadline = deadline_after(ticks);
+
+  struct host_task *me = self();
+  while (!ready(obj)) {
+    if (ticks == 0)
+      return false;
+    if (me->listed && !me->waiting) {
+      me->waiting = true;
+      pthread_cond_broadcast(&idle_cond);
+    }
+    if (ticks == portMAX_DELAY) {
+      pthread_cond_wait(&kernel_cond, &kernel_lock);
+    } else if (pthread_cond_timedwait(&kernel_cond, &kernel_lock,
+                                      &deadline) == ETIMEDOUT) {
+      me->waiting = false;
+      return ready(obj);
+    }
+  }
+  me->waiting = false;
+  return true;
+}
+
+// Queues and semaphores
+
+static bool queue_has_item(void *obj) {
+  return ((struct host_queue *)obj)->count > 0;
+}
+
+static bool queue_has_space(void *obj) {
+  struct host_queue *q = obj;
+  return q->count < q->length;
+}
+
+static QueueHandle_t queue_new(UBaseType_t length, UBaseType_t item_size,
+                               UBaseType_t count) {
+  if (length == 0)
+    return NULL;
+
+  struct host_queue *q = calloc(1, sizeof(*q));
+  if (!q)
+    return NULL;
+  if (item_size > 0) {
+    q->items = calloc(length, item_size);
+    if (!q->items) {
+      free(q);
+      return NULL;
+    }
+  }
+  q->length = length;
+  q->item_size = item_size;
+  q->count = count;
+  return q;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+  return queue_new(length, item_size, 0);
+}
+
+void vQueueDelete(QueueHandle_t queue) {
+  if (!queue)
+    return;
+  free(queue->items);
+  free(queue);
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item,
+                      TickType_t ticks_to_wait) {
+  kernel_enter();
+  bool ok = kernel_wait(queue_has_space, queue, ticks_to_wait);
+  if (ok) {
+    if (queue->items) {
+      UBaseType_t slot = (queue->head + queue->count) % queue->length;
+      memcpy(queue->items + slot * queue->item_size, item, queue->item_size);
+    }
+    queue->count++;
+    kernel_changed();
+  }
+  kernel_exit();
+  return ok ? pdTRUE : errQUEUE_FULL;
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void *item,
+                             BaseType_t *higher_priority_task_woken) {
+  if (higher_priority_task_woken)
+    *higher_priority_task_woken = pdFALSE;
+  return xQueueSend(queue, item, 0);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *buffer,
+                         TickType_t ticks_to_wait) {
+  kernel_enter();
+  bool ok = kernel_wait(queue_has_item, queue, ticks_to_wait);
+  if (ok) {
+    if (queue->items) {
+      memcpy(buffer, queue->items + queue->head * queue->item_size,
+             queue->item_size);
+      queue->head = (queue->head + 1) % queue->length;
+    }
+    queue->count--;
+    kernel_changed();
+  }
+  kernel_exit();
+  return ok ? pdTRUE : pdFALSE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+  kernel_enter();
+  UBaseType_t count = queue->count;
+  kernel_exit();
+  return count;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue) {
+  kernel_enter();
+  UBaseType_t spaces = queue->length - queue->count;
+  kernel_exit();
+  return spaces;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) { return queue_new(1, 0, 1); }
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void) { return queue_new(1, 0, 0); }
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count,
+                                           UBaseType_t initial_count) {
+  if (initial_count > max_count)
+    return NULL;
+  return queue_new(max_count, 0, initial_count);
+}
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex(void) {
+  return queue_new(1, 0, 1);
+}
+
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t sem,
+                                   TickType_t ticks_to_wait) {
+  struct host_task *me = self();
+  kernel_enter();
+  bool ok = true;
+  if (sem->owner == me) {
+    sem->depth++;
+  } else {
+    ok = kernel_wait(queue_has_item, sem, ticks_to_wait);
+    if (ok) {
+      sem->count--;
+      sem->owner = me;
+      sem->depth = 1;
+      kernel_changed();
+    }
+  }
+  kernel_exit();
+  return ok ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t sem) {
+  struct host_task *me = self();
+  kernel_enter();
+  bool ok = sem->owner == me;
+  if (ok && --sem->depth == 0) {
+    sem->owner = NULL;
+    sem->count++;
+    kernel_changed();
+  }
+  kernel_exit();
+  return ok ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks_to_wait) {
+  kernel_enter();
+  void (*hook)(void) = take_hook;
+  take_hook = NULL;
+  kernel_exit();
+  if (hook)
+    hook();
+  return xQueueReceive(sem, NULL, ticks_to_wait);
+}
+
+void host_on_next_semaphore_take(void (*fn)(void)) {
+  kernel_enter();
+  take_hook = fn;
+  kernel_exit();
+}
+
+// Like FreeRTOS, giving a semaphore at its maximum count fails
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+  return xQueueSend(sem, NULL, 0);
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t sem,
+                                 BaseType_t *higher_priority_task_woken) {
+  return xQueueSendFromISR(sem, NULL, higher_priority_task_woken);
+}
+
+UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t sem) {
+  return uxQueueMessagesWaiting(sem);
+}
+
+// Tasks
+
+static void task_unlist(struct host_task *task) {
+  for (struct host_task **p = &tasks; *p; p = &(*p)->next) {
+    if (*p == task) {
+      *p = task->next;
+      break;
+    }
+  }
+  task->listed = false;
+  pthread_cond_broadcast(&idle_cond);
+}
+
+static void *task_main(void *arg) {
+  current = arg;
+  current->fn(current->arg);
+
+  // Returning from a task function is an error in FreeRTOS; just end it
+  kernel_enter();
+  task_unlist(current);
+  kernel_exit();
+  return NULL;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name,
+                       uint32_t stack_depth, void *arg, UBaseType_t priority,
+                       TaskHandle_t *out_handle) {
+  struct host_task *task = calloc(1, sizeof(*task));
+  if (!task)
+    return pdFAIL;
+  task->fn = fn;
+  task->arg = arg;
+  task->listed = true;
+
+  kernel_enter();
+  task->next = tasks;
+  tasks = task;
+  kernel_exit();
+
+  pthread_t thread;
+  if (pthread_create(&thread, NULL, task_main, task) != 0) {
+    kernel_enter();
+    task_unlist(task);
+    kernel_exit();
+    free(task);
+    return pdFAIL;
+  }
+  pthread_detach(thread);
+
+  if (out_handle)
+    *out_handle = task;
+  return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name,
+                                   uint32_t stack_depth, void *arg,
+                                   UBaseType_t priority,
+                                   TaskHandle_t *out_handle, BaseType_t core) {
+  return xTaskCreate(fn, name, stack_depth, arg, priority, out_handle);
+}
+
+// Only a task deleting itself is supported
+void vTaskDelete(TaskHandle_t task) {
+  if (task && task != current)
+    return;
+
+  kernel_enter();
+  task_unlist(current);
+  kernel_exit();
+  pthread_exit(NULL);
+}
+
+void vTaskDelay(TickType_t ticks) {
+  struct timespec ts = {.tv_sec = ticks / 1000,
+                        .tv_nsec = (long)(ticks % 1000) * 1000000L};
+  nanosleep(&ts, NULL);
+}
+
+TickType_t xTaskGetTickCount(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (TickType_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) { return self(); }
+
+static bool task_notified(void *obj) {
+  return ((struct host_task *)obj)->notify > 0;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks_to_wait) {
+  kernel_enter();
+  struct host_task *me = self();
+  uint32_t value = 0;
+  if (kernel_wait(task_notified, me, ticks_to_wait)) {
+    value = me->notify;
+    me->notify = clear_on_exit ? 0 : me->notify - 1;
+  }
+  kernel_exit();
+  return value;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+  if (!task)
+    return pdFAIL;
+
+  kernel_enter();
+  task->notify++;
+  kernel_changed();
+  kernel_exit();
+  return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task,
+                            BaseType_t *higher_priority_task_woken) {
+  if (higher_priority_task_woken)
+    *higher_priority_task_woken = pdFALSE;
+  xTaskNotifyGive(task);
+}
+
+static bool all_tasks_waiting(void) {
+  for (struct host_task *t = tasks; t; t = t->next) {
+    if (!t->waiting)
+      return false;
+  }
+  return true;
+}
+
+bool host_tasks_wait_idle(uint32_t timeout_ms) {
+  kernel_enter();
+  struct timespec deadline = deadline_after(timeout_ms);
+  bool idle;
+  while (!(idle = all_tasks_waiting())) {
+    if (pthread_cond_timedwait(&idle_cond, &kernel_lock, &deadline) ==
+        ETIMEDOUT) {
+      idle = all_tasks_waiting();
+      break;
+    }
+  }
+  kernel_exit();
+  return idle;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+// Test hooks of the host stand-ins for ESP-IDF (not part of ESP-IDF)
+
+#include "esp_log.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Move the virtual esp_timer clock forward, firing due timers in order
+void host_clock_advance_us(int64_t us);
+void host_clock_advance_ms(int64_t ms);
+
+// Wait until every task created with xTaskCreate() is blocked with nothing
+// to do (all queues it waits on empty, no pending notification).
+// Returns false on timeout.
+bool host_tasks_wait_idle(uint32_t timeout_ms);
+
+// Run fn once, in the next xSemaphoreTake() call and on its task, before
+// the semaphore is taken: lets a test act right before a lock is entered
+void host_on_next_semaphore_take(void (*fn)(void));
+
+// Forget every NVS partition, namespace and key
+void host_nvs_reset(void);
+// nvs_set_*() calls so far
+uint32_t host_nvs_writes(void);
+// Entries still free in an NVS partition (see the capacity model in nvs.c)
+uint32_t host_nvs_free_entries(const char *part_name);
+
+// Restart the esp_random() sequence
+void host_random_seed(uint32_t seed);
+
+// Messages logged at a level (also below the print level) since the reset
+uint32_t host_log_count(esp_log_level_t level);
+void host_log_reset_counts(void);
@@ -0,0 +1,346 @@
+#include "nvs.h"
+#include "host_shims.h"
+#include "nvs_flash.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ESP-IDF limits namespace and key names to 15 characters
+#define NVS_NAME_MAX 16
+#define NVS_MAX_HANDLES 32
+
+// ESP-IDF layout: 4 KB pages of 126 32-byte entries, one page kept free
+// for garbage collection. A u8/i32 takes one entry; a blob takes an index
+// entry, a chunk header and its data in whole entries. Namespace entries
+// are not counted.
+#define NVS_PAGE_SIZE 4096
+#define NVS_PAGE_ENTRIES 126
+#define NVS_ENTRY_SIZE 32
+#define NVS_BLOB_ENTRIES(len)                                                  \
+  (2 + ((len) + NVS_ENTRY_SIZE - 1) / NVS_ENTRY_SIZE)
+
+typedef struct {
+  const char *name;
+  size_t size;
+  uint32_t used; // Entries taken
+} nvs_partition_t;
+
+// The NVS partitions of partitions.csv
+static nvs_partition_t partitions[] = {
+    {NVS_DEFAULT_PART_NAME, 0x6000, 0},
+    {"users", 0x10000, 0},
+};
+#define NVS_PARTITION_COUNT (sizeof(partitions) / sizeof(partitions[0]))
+
+typedef struct nvs_entry {
+  nvs_partition_t *partition;
+  char namespace_name[NVS_NAME_MAX];
+  char key[NVS_NAME_MAX];
+  void *value;
+  size_t length;
+  uint32_t entries; // Cost in NVS entries
+  struct nvs_entry *next;
+} nvs_entry_t;
+
+typedef struct {
+  bool open;
+  bool writable;
+  nvs_partition_t *partition;
+  char namespace_name[NVS_NAME_MAX];
+} nvs_open_handle_t;
+
+static pthread_mutex_t nvs_lock = PTHREAD_MUTEX_INITIALIZER;
+static nvs_entry_t *entries = NULL;
+static nvs_open_handle_t handles[NVS_MAX_HANDLES];
+static uint32_t write_count = 0;
+
+static nvs_partition_t *find_partition(const char *name) {
+  for (size_t i = 0; i < NVS_PARTITION_COUNT; i++) {
+    if (name && strcmp(partitions[i].name, name) == 0)
+      return &partitions[i];
+  }
+  return NULL;
+}
+
+static uint32_t partition_capacity(const nvs_partition_t *partition) {
+  return (partition->size / NVS_PAGE_SIZE - 1) * NVS_PAGE_ENTRIES;
+}
+
+static void free_entry(nvs_entry_t *gone) {
+  gone->partition->used -= gone->entries;
+  free(gone->value);
+  free(gone);
+}
+
+esp_err_t nvs_flash_init(void) {
+  return nvs_flash_init_partition(NVS_DEFAULT_PART_NAME);
+}
+
+esp_err_t nvs_flash_init_partition(const char *partition_label) {
+  return find_partition(partition_label) ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t nvs_flash_erase(void) {
+  return nvs_flash_erase_partition(NVS_DEFAULT_PART_NAME);
+}
+
+esp_err_t nvs_flash_erase_partition(const char *part_name) {
+  nvs_partition_t *partition = find_partition(part_name);
+  if (!partition)
+    return ESP_ERR_NOT_FOUND;
+
+  pthread_mutex_lock(&nvs_lock);
+  nvs_entry_t **p = &entries;
+  while (*p) {
+    if ((*p)->partition == partition) {
+      nvs_entry_t *gone = *p;
+      *p = gone->next;
+      free_entry(gone);
+    } else {
+      p = &(*p)->next;
+    }
+  }
+  pthread_mutex_unlock(&nvs_lock);
+  return ESP_OK;
+}
+
+// Caller holds nvs_lock; handles are 1-based so 0 is never valid
+static nvs_open_handle_t *get_handle(nvs_handle_t handle) {
+  if (handle == 0 || handle > NVS_MAX_HANDLES || !handles[handle - 1].open)
+    return NULL;
+  return &handles[handle - 1];
+}
+
+static nvs_entry_t **find_entry(const nvs_open_handle_t *h, const char *key) {
+  nvs_entry_t **p = &entries;
+  for (; *p; p = &(*p)->next) {
+    if ((*p)->partition == h->partition &&
+        strcmp((*p)->namespace_name, h->namespace_name) == 0 &&
+        strcmp((*p)->key, key) == 0)
+      break;
+  }
+  return p;
+}
+
+esp_err_t nvs_open(const char *namespace_name, nvs_open_mode_t open_mode,
+                   nvs_handle_t *out_handle) {
+  return nvs_open_from_partition(NVS_DEFAULT_PART_NAME, namespace_name,
+                                 open_mode, out_handle);
+}
+
+esp_err_t nvs_open_from_partition(const char *part_name,
+                                  const char *namespace_name,
+                                  nvs_open_mode_t open_mode,
+                                  nvs_handle_t *out_handle) {
+  if (!namespace_name || !out_handle ||
+      strlen(namespace_name) >= NVS_NAME_MAX)
+    return ESP_ERR_INVALID_ARG;
+  nvs_partition_t *partition = find_partition(part_name);
+  if (!partition)
+    return ESP_ERR_NVS_PART_NOT_FOUND;
+
+  esp_err_t err = ESP_ERR_NO_MEM;
+  pthread_mutex_lock(&nvs_lock);
+  for (int i = 0; i < NVS_MAX_HANDLES; i++) {
+    if (!handles[i].open) {
+      handles[i].open = true;
+      handles[i].writable = (open_mode == NVS_READWRITE);
+      handles[i].partition = partition;
+      strcpy(handles[i].namespace_name, namespace_name);
+      *out_handle = (nvs_handle_t)(i + 1);
+      err = ESP_OK;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&nvs_lock);
+  return err;
+}
+
+void nvs_close(nvs_handle_t handle) {
+  pthread_mutex_lock(&nvs_lock);
+  nvs_open_handle_t *h = get_handle(handle);
+  if (h)
+    h->open = false;
+  pthread_mutex_unlock(&nvs_lock);
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle) {
+  pthread_mutex_lock(&nvs_lock);
+  esp_err_t err = get_handle(handle) ? ESP_OK : ESP_ERR_INVALID_ARG;
+  pthread_mutex_unlock(&nvs_lock);
+  return err;
+}
+
+esp_err_t nvs_erase_all(nvs_handle_t handle) {
+  pthread_mutex_lock(&nvs_lock);
+  nvs_open_handle_t *h = get_handle(handle);
+  if (!h || !h->writable) {
+    pthread_mutex_unlock(&nvs_lock);
+    return ESP_ERR_INVALID_ARG;
+  }
+  nvs_entry_t **p = &entries;
+  while (*p) {
+    if ((*p)->partition == h->partition &&
+        strcmp((*p)->namespace_name, h->namespace_name) == 0) {
+      nvs_entry_t *gone = *p;
+      *p = gone->next;
+      free_entry(gone);
+    } else {
+      p = &(*p)->next;
+    }
+  }
+  write_count++;
+  pthread_mutex_unlock(&nvs_lock);
+  return ESP_OK;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key) {
+  pthread_mutex_lock(&nvs_lock);
+  nvs_open_handle_t *h = get_handle(handle);
+  if (!h || !h->writable || !key) {
+    pthread_mutex_unlock(&nvs_lock);
+    return ESP_ERR_INVALID_ARG;
+  }
+  nvs_entry_t **p = find_entry(h, key);
+  esp_err_t err = ESP_ERR_NVS_NOT_FOUND;
+  if (*p) {
+    nvs_entry_t *gone = *p;
+    *p = gone->next;
+    free_entry(gone);
+    write_count++;
+    err = ESP_OK;
+  }
+  pthread_mutex_unlock(&nvs_lock);
+  return err;
+}
+
+// Store a copy of value under key, taking cost entries of the partition
+static esp_err_t set_value(nvs_handle_t handle, const char *key,
+                           const void *value, size_t length, uint32_t cost) {
+  if (!key || strlen(key) >= NVS_NAME_MAX || (!value && length > 0))
+    return ESP_ERR_INVALID_ARG;
+
+  void *copy = malloc(length ? length : 1);
+  if (!copy)
+    return ESP_ERR_NO_MEM;
+  if (length > 0)
+    memcpy(copy, value, length);
+
+  pthread_mutex_lock(&nvs_lock);
+  nvs_open_handle_t *h = get_handle(handle);
+  if (!h || !h->writable) {
+    pthread_mutex_unlock(&nvs_lock);
+    free(copy);
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  nvs_entry_t **p = find_entry(h, key);
+  nvs_entry_t *entry = *p;
+  uint32_t freed = entry ? entry->entries : 0;
+  if (h->partition->used - freed + cost > partition_capacity(h->partition)) {
+    pthread_mutex_unlock(&nvs_lock);
+    free(copy);
+    return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+  }
+  if (!entry) {
+    entry = calloc(1, sizeof(*entry));
+    if (!entry) {
+      pthread_mutex_unlock(&nvs_lock);
+      free(copy);
+      return ESP_ERR_NO_MEM;
+    }
+    entry->partition = h->partition;
+    strcpy(entry->namespace_name, h->namespace_name);
+    strcpy(entry->key, key);
+    *p = entry;
+  }
+  free(entry->value);
+  entry->value = copy;
+  entry->length = length;
+  h->partition->used += cost - freed;
+  entry->entries = cost;
+  write_count++;
+  pthread_mutex_unlock(&nvs_lock);
+  return ESP_OK;
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value,
+                       size_t *length) {
+  if (!key || !length)
+    return ESP_ERR_INVALID_ARG;
+
+  pthread_mutex_lock(&nvs_lock);
+  nvs_open_handle_t *h = get_handle(handle);
+  if (!h) {
+    pthread_mutex_unlock(&nvs_lock);
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  nvs_entry_t *entry = *find_entry(h, key);
+  esp_err_t err = ESP_OK;
+  if (!entry) {
+    err = ESP_ERR_NVS_NOT_FOUND;
+  } else if (!out_value) {
+    *length = entry->length; // Size query, as in ESP-IDF
+  } else if (*length < entry->length) {
+    err = ESP_ERR_NVS_INVALID_LENGTH;
+  } else {
+    memcpy(out_value, entry->value, entry->length);
+    *length = entry->length;
+  }
+  pthread_mutex_unlock(&nvs_lock);
+  return err;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key,
+                       const void *value, size_t length) {
+  return set_value(handle, key, value, length, NVS_BLOB_ENTRIES(length));
+}
+
+esp_err_t nvs_set_i32(nvs_handle_t handle, const char *key, int32_t value) {
+  return set_value(handle, key, &value, sizeof(value), 1);
+}
+
+esp_err_t nvs_get_i32(nvs_handle_t handle, const char *key,
+                      int32_t *out_value) {
+  size_t length = sizeof(*out_value);
+  return nvs_get_blob(handle, key, out_value, &length);
+}
+
+esp_err_t nvs_set_u8(nvs_handle_t handle, const char *key, uint8_t value) {
+  return set_value(handle, key, &value, sizeof(value), 1);
+}
+
+esp_err_t nvs_get_u8(nvs_handle_t handle, const char *key,
+                     uint8_t *out_value) {
+  size_t length = sizeof(*out_value);
+  return nvs_get_blob(handle, key, out_value, &length);
+}
+
+void host_nvs_reset(void) {
+  pthread_mutex_lock(&nvs_lock);
+  while (entries) {
+    nvs_entry_t *gone = entries;
+    entries = gone->next;
+    free_entry(gone);
+  }
+  memset(handles, 0, sizeof(handles));
+  write_count = 0;
+  pthread_mutex_unlock(&nvs_lock);
+}
+
+uint32_t host_nvs_writes(void) {
+  pthread_mutex_lock(&nvs_lock);
+  uint32_t count = write_count;
+  pthread_mutex_unlock(&nvs_lock);
+  return count;
+}
+
+uint32_t host_nvs_free_entries(const char *part_name) {
+  pthread_mutex_lock(&nvs_lock);
+  nvs_partition_t *partition = find_partition(part_name);
+  uint32_t free_entries =
+      partition ? partition_capacity(partition) - partition->used : 0;
+  pthread_mutex_unlock(&nvs_lock);
+  return free_entries;
+}
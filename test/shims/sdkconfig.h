@@ -0,0 +1,5 @@
+#pragma once
+
+// Host build configuration: the values of ../../sdkconfig the code uses
+#define CONFIG_BLE_MESH_RX_SDU_MAX 384
+#define CONFIG_OFFSETX 0
@@ -0,0 +1,165 @@
+#include "binary_serial.h"
+#include "test_util.h"
+
+#define NOW_US 5000000
+
+static MeshMessage make_text(const char *name, uint8_t msg_id,
+                             const char *text) {
+  MeshMessage msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.type = MSG_TYPE_TEXT;
+  msg.msg_id = msg_id;
+  msg.timestamp = NOW_US;
+  strncpy(msg.sender_name, name, USERNAME_MAX_LEN - 1);
+  msg.payload_len = (uint8_t)strlen(text);
+  memcpy(msg.payload, text, msg.payload_len);
+  return msg;
+}
+
+static void test_v2_round_trip(void) {
+  MeshMessage msg = make_text("alice", 42, "hello there, how are you?");
+  uint8_t buf[MAX_SERIALIZED_SIZE];
+  size_t len = 0;
+  CHECK_EQ(serialize_message_v2(&msg, NOW_US, buf, &len), 0);
+  CHECK(len > 0 && len < MAX_SERIALIZED_SIZE);
+
+  MeshMessage out;
+  CHECK_EQ(deserialize_message(buf, len, NOW_US, &out), 0);
+  CHECK_EQ(out.type, MSG_TYPE_TEXT);
+  CHECK_EQ(out.msg_id, 42);
+  CHECK_EQ(out.addr, 0); // v2 leaves the address to the mesh header
+  CHECK_STR(out.sender_name, "alice");
+  CHECK_EQ(out.payload_len, msg.payload_len);
+  CHECK(memcmp(out.payload, msg.payload, msg.payload_len) == 0);
+}
+
+static void test_v2_optional_fields(void) {
+  // No id, no name, fresh timestamp: header + payload length + payload
+  MeshMessage msg = make_text("", 0, "zq");
+  uint8_t buf[MAX_SERIALIZED_SIZE];
+  size_t len = 0;
+  CHECK_EQ(serialize_message_v2(&msg, NOW_US, buf, &len), 0);
+  CHECK_EQ(len, 1 + 1 + 2);
+  CHECK_EQ(buf[0], MSG_V2_MARKER | MSG_TYPE_TEXT);
+
+  uint8_t type = 0;
+  CHECK_EQ(frame_peek_msg_id(buf, len, &type), 0);
+  CHECK_EQ(type, MSG_TYPE_TEXT);
+
+  // An old message carries its age, which is rebased on the local clock
+  msg.timestamp = NOW_US - 2000000;
+  CHECK_EQ(serialize_message_v2(&msg, NOW_US, buf, &len), 0);
+  CHECK(buf[0] & MSG_V2_FLAG_TS);
+  MeshMessage out;
+  CHECK_EQ(deserialize_message(buf, len, NOW_US + 1000000, &out), 0);
+  CHECK_EQ(out.timestamp, NOW_US - 1000000);
+}
+
+static void test_name_fills_field(void) {
+  // A name using the whole field has no terminator
+  MeshMessage msg = make_text("", 7, "hi");
+  memset(msg.sender_name, 'x', USERNAME_MAX_LEN);
+  uint8_t buf[MAX_SERIALIZED_SIZE];
+  size_t len = 0;
+  CHECK_EQ(serialize_message_v2(&msg, NOW_US, buf, &len), 0);
+
+  MeshMessageView view;
+  CHECK_EQ(deserialize_message_view(buf, len, NOW_US, &view), 0);
+  CHECK_EQ(view.sender_name_len, USERNAME_MAX_LEN - 1);
+}
+
+static void test_field_len(void) {
+  CHECK_EQ(field_len("alice", 8), 5);
+  CHECK_EQ(field_len("", 8), 0);
+
+  // A full field has no terminator; nothing past max_len is read
+  char field[4] = {'a', 'b', 'c', 'd'};
+  CHECK_EQ(field_len(field, sizeof(field)), 4);
+  CHECK_EQ(field_len(field, 2), 2);
+}
+
+static void test_v1_frames(void) {
+  MeshMessage msg = make_text("bob", 0, "legacy");
+  msg.addr = 0x1234;
+  uint8_t buf[MAX_SERIALIZED_SIZE];
+  size_t len = 0;
+  CHECK_EQ(serialize_message(&msg, buf, &len), 0);
+
+  MeshMessageView view;
+  CHECK_EQ(deserialize_message_view(buf, len, NOW_US, &view), 0);
+  CHECK_EQ(view.addr, 0x1234);
+  CHECK_EQ(view.sender_name_len, 3);
+  CHECK(memcmp(view.sender_name, "bob", 3) == 0);
+  CHECK_EQ(view.payload_len, 6);
+  CHECK_EQ(frame_peek_msg_id(buf, len, NULL), 0);
+}
+
+static void test_truncated_frames(void) {
+  MeshMessage msg = make_text("carol", 9, "some text to cut short");
+  uint8_t buf[MAX_SERIALIZED_SIZE];
+  size_t len = 0;
+  CHECK_EQ(serialize_message_v2(&msg, NOW_US, buf, &len), 0);
+
+  for (size_t cut = 0; cut < len; cut++) {
+    MeshMessageView view;
+    CHECK(deserialize_message_view(buf, cut, NOW_US, &view) != 0);
+  }
+}
+
+static void test_batch_records(void) {
+  uint8_t batch[256];
+  size_t len = 1;
+  batch[0] = MSG_BATCH_HEADER;
+
+  const char *texts[] = {"one", "two", "three"};
+  for (int i = 0; i < 3; i++) {
+    MeshMessage msg = make_text("", (uint8_t)(i + 1), texts[i]);
+    uint8_t rec[MAX_SERIALIZED_SIZE];
+    size_t rec_len = 0;
+    CHECK_EQ(serialize_message_v2(&msg, NOW_US, rec, &rec_len), 0);
+    len += serialize_batch_record(rec, rec_len, &batch[len]);
+  }
+
+  size_t offset = 0;
+  const uint8_t *record;
+  size_t record_len;
+  int n = 0;
+  while (deserialize_batch_record(batch, len, &offset, &record,
+                                  &record_len) > 0) {
+    MeshMessage out;
+    CHECK_EQ(deserialize_message(record, record_len, NOW_US, &out), 0);
+    CHECK_EQ(out.msg_id, n + 1);
+    CHECK_EQ(out.payload_len, strlen(texts[n]));
+    n++;
+  }
+  CHECK_EQ(n, 3);
+
+  // A record running past the end is malformed
+  offset = 0;
+  CHECK(deserialize_batch_record(batch, len - 1, &offset, &record,
+                                 &record_len) == 1);
+  CHECK(deserialize_batch_record(batch, len - 1, &offset, &record,
+                                 &record_len) == 1);
+  CHECK(deserialize_batch_record(batch, len - 1, &offset, &record,
+                                 &record_len) < 0);
+}
+
+static void test_segment_count(void) {
+  // 11-byte access payload (3-byte opcode) is the unsegmented limit
+  CHECK_EQ(mesh_frame_segment_count(8), 1);
+  CHECK_EQ(mesh_frame_segment_count(9), 2);
+  CHECK_EQ(mesh_frame_segment_count(17), 2);
+  CHECK_EQ(mesh_frame_segment_count(18), 3);
+}
+
+int main(void) {
+  RUN_TEST(test_v2_round_trip);
+  RUN_TEST(test_v2_optional_fields);
+  RUN_TEST(test_name_fills_field);
+  RUN_TEST(test_field_len);
+  RUN_TEST(test_v1_frames);
+  RUN_TEST(test_truncated_frames);
+  RUN_TEST(test_batch_records);
+  RUN_TEST(test_segment_count);
+  return TEST_RESULT();
+}
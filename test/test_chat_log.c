@@ -0,0 +1,327 @@
+#include "chat_log.h"
+#include "freertos/task.h"
+#include "host_shims.h"
+#include "test_util.h"
+#include "user_table.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+static peer_id_t add_peer(const char *name, uint16_t addr) {
+  user_table_set(name, addr);
+  return user_table_peer_id(user_table_find_index_by_addr(addr));
+}
+
+static void setup(void) {
+  host_nvs_reset();
+  user_table_init();
+  user_table_clear();
+  chat_log_init();
+}
+
+static void test_add_and_iterate(void) {
+  setup();
+  peer_id_t alice = add_peer("alice", 0x0002);
+  peer_id_t bob = add_peer("bob", 0x0003);
+
+  chat_log_add(alice, "first", false);
+  chat_log_add(bob, "for bob", true);
+  chat_log_add(alice, "second", true);
+
+  chat_log_iter_t it;
+  chat_log_entry_t entry;
+  chat_log_iter_begin(alice, &it);
+  CHECK(chat_log_iter_next(&it, &entry));
+  CHECK_STR(entry.text, "first");
+  CHECK_EQ(entry.line_count, 1);
+  CHECK(chat_log_iter_next(&it, &entry));
+  CHECK_STR(entry.text, "You: second"); // Outgoing lines are prefixed
+  CHECK(!chat_log_iter_next(&it, &entry));
+  CHECK(chat_log_iter_valid(&it));
+
+  // Another user's append invalidates the cursor
+  chat_log_add(bob, "again", true);
+  CHECK(!chat_log_iter_valid(&it));
+}
+
+static void test_word_wrap(void) {
+  setup();
+  peer_id_t alice = add_peer("alice", 0x0002);
+
+  // 19 columns: "the quick brown fox" fits exactly, the rest wraps
+  chat_log_add(alice, "the quick brown fox jumps over the lazy dog", false);
+  CHECK_EQ(chat_log_line_count(alice), 3);
+
+  chat_log_line_t lines[4];
+  uint32_t gen = chat_log_generation();
+  int n = chat_log_get_lines(alice, 0, lines, 4);
+  CHECK_EQ(n, 3);
+  CHECK(chat_log_unchanged(gen));
+  CHECK_EQ(lines[0].len, 19);
+  CHECK(strncmp(lines[0].text, "the quick brown fox", 19) == 0);
+  CHECK(!lines[0].last);
+  CHECK(lines[2].last);
+
+  // Windows into the middle
+  CHECK_EQ(chat_log_get_lines(alice, 1, lines, 1), 1);
+  CHECK(strncmp(lines[0].text, "jumps", 5) == 0);
+  CHECK_EQ(chat_log_get_lines(alice, 3, lines, 4), 0);
+}
+
+static void test_delivery_state(void) {
+  setup();
+  peer_id_t alice = add_peer("alice", 0x0002);
+
+  chat_log_add_outgoing(alice, "tracked", 17);
+  chat_log_line_t line;
+  CHECK_EQ(chat_log_get_lines(alice, 0, &line, 1), 1);
+  CHECK_EQ(line.state, DELIVERY_QUEUED);
+
+  CHECK(chat_log_set_delivery(alice, 17, DELIVERY_ACKED));
+  CHECK_EQ(chat_log_get_lines(alice, 0, &line, 1), 1);
+  CHECK_EQ(line.state, DELIVERY_ACKED);
+
+  CHECK(!chat_log_set_delivery(alice, 18, DELIVERY_ACKED));
+}
+
+static void test_clear_and_stale_peer(void) {
+  setup();
+  peer_id_t alice = add_peer("alice", 0x0002);
+  chat_log_add(alice, "hello", false);
+  CHECK_EQ(chat_log_line_count(alice), 1);
+
+  chat_log_clear_peer(alice);
+  CHECK_EQ(chat_log_line_count(alice), 0);
+
+  // Handles that never were valid are ignored
+  chat_log_add(PEER_NONE, "nobody", false);
+  CHECK(chat_log_add_n(0x7F05, "bad", 3, false) == NULL);
+}
+
+// Messages of peer in log order; their texts start with a number (after
+// the "You: " of outgoing ones), which must count up by one from first.
+// Returns how many there are.
+static int check_run(peer_id_t peer, int *first) {
+  chat_log_iter_t it;
+  chat_log_entry_t entry;
+  int n = 0;
+  chat_log_iter_begin(peer, &it);
+  while (chat_log_iter_next(&it, &entry)) {
+    const char *text = entry.text;
+    if (strncmp(text, "You: ", 5) == 0)
+      text += 5;
+    int number = atoi(text);
+    if (n == 0)
+      *first = number;
+    CHECK_EQ(number, *first + n);
+    n++;
+  }
+  CHECK(chat_log_iter_valid(&it));
+  return n;
+}
+
+// The arena evicts the oldest record overall: an idle contact gives its
+// space to the active one, whose newest messages survive without gaps
+// across many wraps of the arena
+static void test_evicts_oldest_first(void) {
+  setup();
+  peer_id_t alice = add_peer("alice", 0x0002);
+  peer_id_t bob = add_peer("bob", 0x0003);
+  chat_log_add(alice, "0 old news", false);
+
+  char text[MAX_MESSAGE_LEN];
+  int sent = 0;
+  while (chat_log_line_count(alice) > 0 && sent < 1000) {
+    snprintf(text, sizeof(text), "%d", sent++);
+    chat_log_add(bob, text, false);
+  }
+  CHECK(sent < 1000);
+  CHECK_EQ(chat_log_evicted_lines(alice), 1);
+  int first = -1;
+  CHECK_EQ(check_run(alice, &first), 0);
+  CHECK_EQ(check_run(bob, &first), sent);
+  CHECK_EQ(first, 0);
+
+  // Record sizes vary, so the head wraps at different offsets
+  for (int i = 0; i < 2000; i++) {
+    int pad = (i * 7) % (MAX_MESSAGE_LEN - 8);
+    snprintf(text, sizeof(text), "%d %.*s", sent++, pad,
+             "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx");
+    chat_log_add(bob, text, i % 3 == 0);
+  }
+  int kept = check_run(bob, &first);
+  CHECK(kept > MAX_CHAT_PER_USER);
+  CHECK_EQ(first + kept, sent);
+}
+
+// Short messages take little room: the arena holds far more than the old
+// fixed MAX_CHAT_PER_USER slots per contact
+static void test_short_messages_pack(void) {
+  setup();
+  peer_id_t alice = add_peer("alice", 0x0002);
+  char text[8];
+  for (int i = 0; i < 1000; i++) {
+    snprintf(text, sizeof(text), "%d", i);
+    chat_log_add(alice, text, false);
+  }
+  int first = -1;
+  int kept = check_run(alice, &first);
+  CHECK(kept >= CHAT_LOG_ARENA_SIZE / 16);
+  CHECK_EQ(first + kept, 1000);
+  CHECK_EQ(chat_log_evicted_lines(alice) + chat_log_line_count(alice), 1000);
+}
+
+// A cleared peer's records stay in the arena until evicted, and must not
+// be linked back to anyone when they are
+static void test_cleared_records_evicted(void) {
+  setup();
+  peer_id_t alice = add_peer("alice", 0x0002);
+  peer_id_t bob = add_peer("bob", 0x0003);
+  char text[MAX_MESSAGE_LEN];
+  for (int i = 0; i < 5; i++) {
+    snprintf(text, sizeof(text), "%d from alice", i);
+    chat_log_add(alice, text, false);
+  }
+  chat_log_clear_peer(alice);
+
+  for (int i = 0; i < 500; i++) {
+    snprintf(text, sizeof(text), "%d from bob", i);
+    chat_log_add(bob, text, false);
+    CHECK_EQ(chat_log_line_count(alice), 0);
+  }
+  chat_log_add(alice, "0 again", false);
+
+  int first = -1;
+  CHECK_EQ(check_run(alice, &first), 1);
+  CHECK_EQ(first, 0);
+  int kept = check_run(bob, &first);
+  CHECK_EQ(first + kept, 500);
+}
+
+static pthread_t evictor;
+static atomic_bool evicted;
+
+static void *evict_lru_peer(void *arg) {
+  user_table_set("newcomer", 0x0F00);
+  atomic_store(&evicted, true);
+  return NULL;
+}
+
+// Runs as the add is about to take the log lock: evict the peer from
+// another task, giving it up to 100 ms
+static void evict_before_log_lock(void) {
+  CHECK_EQ(pthread_create(&evictor, NULL, evict_lru_peer, NULL), 0);
+  for (int ms = 0; ms < 100 && !atomic_load(&evicted); ms++) {
+    vTaskDelay(pdMS_TO_TICKS(1));
+  }
+}
+
+// A peer evicted while a message for it is being added: the message goes
+// with the evicted peer, never into the log of the one taking its slot
+static void test_evict_during_add(void) {
+  setup();
+  user_table_register_evict_cb(chat_log_clear_peer);
+  char name[USERNAME_MAX_LEN];
+  for (int i = 0; i < MAX_USERS; i++) {
+    snprintf(name, sizeof(name), "n%04x", 0x0100 + i);
+    user_table_set(name, (uint16_t)(0x0100 + i));
+  }
+  peer_id_t doomed = user_table_peer_id(0); // Least recently seen
+
+  atomic_store(&evicted, false);
+  host_on_next_semaphore_take(evict_before_log_lock);
+  chat_log_add(doomed, "for n0100", false);
+  pthread_join(evictor, NULL);
+  user_table_register_evict_cb(NULL);
+
+  CHECK(atomic_load(&evicted));
+  CHECK_EQ(user_table_index_of(doomed), -1);
+  CHECK_EQ(user_table_find_index_by_addr(0x0F00), 0);
+  CHECK_EQ(chat_log_line_count(user_table_peer_id(0)), 0);
+}
+
+static atomic_bool reader_stop;
+static atomic_int torn_reads;
+static atomic_int retries;
+static atomic_int good_reads;
+
+// Message n is "n:" and then n % 40 times letter n % 26
+static void format_message(int n, char *text, size_t size) {
+  int len = snprintf(text, size, "%d:", n);
+  memset(text + len, 'a' + n % 26, n % 40);
+  text[len + n % 40] = '\0';
+}
+
+static bool message_intact(const chat_log_entry_t *entry) {
+  char *end;
+  long n = strtol(entry->text, &end, 10);
+  if (*end != ':')
+    return false;
+  char expected[MAX_MESSAGE_LEN];
+  format_message((int)n, expected, sizeof(expected));
+  return entry->len == strlen(expected) && strcmp(entry->text, expected) == 0;
+}
+
+// Seqlock reader: walk the log and retry whenever a write overlapped. A
+// walk that still looks valid afterwards must only have seen whole
+// messages.
+static void *log_reader(void *arg) {
+  peer_id_t peer = *(peer_id_t *)arg;
+  while (!atomic_load(&reader_stop)) {
+    chat_log_iter_t it;
+    chat_log_entry_t entry;
+    bool intact = true;
+    chat_log_iter_begin(peer, &it);
+    while (chat_log_iter_next(&it, &entry)) {
+      if (!message_intact(&entry))
+        intact = false;
+    }
+    if (!chat_log_iter_valid(&it)) {
+      atomic_fetch_add(&retries, 1);
+    } else if (!intact) {
+      atomic_fetch_add(&torn_reads, 1);
+    } else {
+      atomic_fetch_add(&good_reads, 1);
+    }
+  }
+  return NULL;
+}
+
+static void test_concurrent_reader_retries(void) {
+  setup();
+  peer_id_t alice = add_peer("alice", 0x0002);
+  atomic_store(&reader_stop, false);
+  atomic_store(&torn_reads, 0);
+  atomic_store(&retries, 0);
+  atomic_store(&good_reads, 0);
+
+  pthread_t reader;
+  CHECK_EQ(pthread_create(&reader, NULL, log_reader, &alice), 0);
+
+  char text[MAX_MESSAGE_LEN];
+  for (int n = 0; n < 200000; n++) {
+    format_message(n, text, sizeof(text));
+    chat_log_add(alice, text, false);
+  }
+
+  atomic_store(&reader_stop, true);
+  pthread_join(reader, NULL);
+  CHECK_EQ(atomic_load(&torn_reads), 0);
+  CHECK(atomic_load(&good_reads) > 0);
+  printf("  %d walks, %d retried\n",
+         atomic_load(&good_reads) + atomic_load(&retries),
+         atomic_load(&retries));
+}
+
+int main(void) {
+  RUN_TEST(test_add_and_iterate);
+  RUN_TEST(test_word_wrap);
+  RUN_TEST(test_delivery_state);
+  RUN_TEST(test_clear_and_stale_peer);
+  RUN_TEST(test_evicts_oldest_first);
+  RUN_TEST(test_short_messages_pack);
+  RUN_TEST(test_cleared_records_evicted);
+  RUN_TEST(test_concurrent_reader_retries);
+  RUN_TEST(test_evict_during_add);
+  return TEST_RESULT();
+}
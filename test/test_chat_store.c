@@ -0,0 +1,208 @@
+// Chat store on the file-backed flash fake: paging, remount, compaction
+// when the log wraps (also with hundreds of peers), power loss in the
+// middle of a record, and appends through the store task.
+
+#include "chat_store.h"
+#include "flash_fake.h"
+#include "host_shims.h"
+#include "test_util.h"
+#include <stdio.h>
+#include <unistd.h>
+
+#define FLASH_SIZE (16 * CHAT_STORE_SEGMENT_SIZE)
+#define FLASH_FILE "test_chat_store.flash"
+#define ALICE 0x0010
+#define BOB 0x0011
+
+static const chat_store_flash_t *flash;
+
+static void fresh_store(void) {
+  unlink(FLASH_FILE);
+  flash = host_flash_open(FLASH_FILE, FLASH_SIZE);
+  CHECK(flash != NULL);
+  CHECK_EQ(chat_store_init(flash), 0);
+}
+
+static void append(uint16_t peer, bool outgoing, int n) {
+  char text[MAX_MESSAGE_LEN + 1];
+  snprintf(text, sizeof(text), "message %d", n);
+  CHECK_EQ(chat_store_append(peer, outgoing, text, strlen(text)), 0);
+}
+
+// Page of peer must hold messages first..last, numbered as append() does
+static void check_page(uint16_t peer, uint32_t page, int page_size,
+                       int first, int last) {
+  chat_store_msg_t msgs[16];
+  int n = chat_store_read_page(peer, page, msgs, page_size);
+  CHECK_EQ(n, last - first + 1);
+  for (int i = 0; i < n; i++) {
+    char text[MAX_MESSAGE_LEN + 1];
+    snprintf(text, sizeof(text), "message %d", first + i);
+    CHECK_EQ(msgs[i].seq, first + i);
+    CHECK_STR(msgs[i].text, text);
+  }
+}
+
+static void test_missing_flash(void) {
+  CHECK(chat_store_init(NULL) < 0);
+  CHECK(chat_store_append(ALICE, true, "hi", 2) < 0);
+  CHECK_EQ(chat_store_count(ALICE), 0);
+}
+
+static void test_pages(void) {
+  fresh_store();
+  for (int i = 1; i <= 20; i++) {
+    append(ALICE, i % 2, i);
+  }
+  append(BOB, false, 1);
+
+  CHECK_EQ(chat_store_count(ALICE), 20);
+  CHECK_EQ(chat_store_count(BOB), 1);
+  CHECK_EQ(chat_store_count(0x0099), 0);
+  check_page(ALICE, 0, 8, 13, 20);
+  check_page(ALICE, 1, 8, 5, 12);
+  check_page(ALICE, 2, 8, 1, 4);
+  check_page(ALICE, 3, 8, 1, 0);
+  check_page(BOB, 0, 8, 1, 1);
+
+  chat_store_msg_t msg;
+  CHECK_EQ(chat_store_read_page(ALICE, 0, &msg, 1), 1);
+  CHECK(!msg.outgoing);
+  CHECK_EQ(chat_store_read_page(ALICE, 1, &msg, 1), 1);
+  CHECK(msg.outgoing);
+}
+
+// The file keeps the log across a reboot; numbering continues
+static void test_remount(void) {
+  host_flash_close();
+  flash = host_flash_open(FLASH_FILE, FLASH_SIZE);
+  CHECK_EQ(chat_store_init(flash), 0);
+
+  CHECK_EQ(chat_store_count(ALICE), 20);
+  check_page(ALICE, 0, 8, 13, 20);
+  append(ALICE, false, 21);
+  check_page(ALICE, 0, 2, 20, 21);
+}
+
+// A busy conversation wraps the log many times over; the idle one keeps
+// its newest CHAT_STORE_KEEP messages
+static void test_wrap_keeps_recent(void) {
+  fresh_store();
+  for (int i = 1; i <= 10; i++) {
+    append(ALICE, false, i);
+  }
+  for (int i = 1; i <= 3000; i++) {
+    append(BOB, true, i);
+  }
+
+  CHECK_EQ(chat_store_count(ALICE), CHAT_STORE_KEEP);
+  check_page(ALICE, 0, 16, 10 - CHAT_STORE_KEEP + 1, 10);
+  check_page(BOB, 0, 4, 2997, 3000);
+
+  chat_store_stats_t stats;
+  chat_store_get_stats(&stats);
+  CHECK_EQ(stats.appends, 3010);
+  CHECK(stats.copied >= CHAT_STORE_KEEP);
+  CHECK(stats.erases > FLASH_SIZE / CHAT_STORE_SEGMENT_SIZE);
+
+  // Compaction survives the remount too
+  CHECK_EQ(chat_store_init(flash), 0);
+  check_page(ALICE, 0, 16, 10 - CHAT_STORE_KEEP + 1, 10);
+}
+
+// More peers than fit in one segment: each said one thing and went quiet.
+// Compaction carries all of them forward while a busy conversation wraps
+// the log, and a segment filled up by those copies does not make the
+// append that opened it fail.
+static void test_many_peers(void) {
+  enum { PEERS = 204, BASE = 0x0100 }; // Exactly one segment of records
+  fresh_store();
+  for (int p = 0; p < PEERS; p++) {
+    append(BASE + p, false, 1);
+  }
+  for (int p = 0; p < PEERS; p++) {
+    CHECK_EQ(chat_store_count(BASE + p), 1);
+  }
+
+  for (int i = 1; i <= 3000; i++) {
+    append(ALICE, true, i);
+  }
+  check_page(ALICE, 0, 4, 2997, 3000);
+  for (int p = 0; p < PEERS; p++) {
+    check_page(BASE + p, 0, 4, 1, 1);
+  }
+
+  // Nothing was written past a segment end: flash holds what was indexed
+  uint32_t alice = chat_store_count(ALICE);
+  CHECK_EQ(chat_store_init(flash), 0);
+  CHECK_EQ(chat_store_count(ALICE), alice);
+  for (int p = 0; p < PEERS; p++) {
+    check_page(BASE + p, 0, 4, 1, 1);
+  }
+}
+
+// Power lost halfway through a record: the torn record is dropped at mount
+// and the store carries on in a new segment
+static void test_torn_record(void) {
+  fresh_store();
+  for (int i = 1; i <= 5; i++) {
+    append(ALICE, false, i);
+  }
+  host_flash_cut_power_after(6);
+  CHECK(chat_store_append(ALICE, false, "lost", 4) < 0);
+  host_flash_power_on();
+
+  uint32_t warnings = host_log_count(ESP_LOG_WARN);
+  CHECK_EQ(chat_store_init(flash), 0);
+  CHECK(host_log_count(ESP_LOG_WARN) > warnings);
+  CHECK_EQ(chat_store_count(ALICE), 5);
+
+  append(ALICE, false, 6);
+  check_page(ALICE, 0, 8, 1, 6);
+  CHECK_EQ(chat_store_init(flash), 0);
+  check_page(ALICE, 0, 8, 1, 6);
+}
+
+// Queued appends reach flash from the store task; while it is held off a
+// full queue drops messages instead of blocking the caller
+static void test_async(void) {
+  fresh_store();
+  CHECK(chat_store_append_async(ALICE, true, "early", 5) < 0);
+  chat_store_task_init();
+
+  CHECK_EQ(chat_store_append_async(ALICE, true, "hi", 2), 0);
+  CHECK(host_tasks_wait_idle(1000));
+  chat_store_lock();
+  CHECK_EQ(chat_store_count(ALICE), 1);
+  chat_store_unlock();
+
+  uint32_t warnings = host_log_count(ESP_LOG_WARN);
+  int queued = 0;
+  chat_store_lock();
+  for (int i = 0; i < CHAT_STORE_QUEUE_LEN + 2; i++) {
+    if (chat_store_append_async(BOB, false, "busy", 4) == 0)
+      queued++;
+  }
+  CHECK(queued < CHAT_STORE_QUEUE_LEN + 2);
+  CHECK(host_log_count(ESP_LOG_WARN) > warnings);
+  chat_store_unlock();
+
+  CHECK(host_tasks_wait_idle(1000));
+  chat_store_lock();
+  CHECK_EQ(chat_store_count(BOB), queued);
+  chat_store_unlock();
+}
+
+int main(void) {
+  esp_log_level_set("*", ESP_LOG_NONE);
+  RUN_TEST(test_missing_flash);
+  RUN_TEST(test_pages);
+  RUN_TEST(test_remount);
+  RUN_TEST(test_wrap_keeps_recent);
+  RUN_TEST(test_many_peers);
+  RUN_TEST(test_torn_record);
+  RUN_TEST(test_async);
+  host_flash_close();
+  unlink(FLASH_FILE);
+  return TEST_RESULT();
+}
@@ -0,0 +1,30 @@
+#include "crc16.h"
+#include "test_util.h"
+
+static void test_check_value(void) {
+  // Reflected 0xA001 with initial value 0xFFFF is CRC-16/MODBUS
+  const char *check = "123456789";
+  CHECK_EQ(crc16((const uint8_t *)check, strlen(check)), 0x4B37);
+  CHECK_EQ(crc16(NULL, 0), 0xFFFF);
+}
+
+static void test_detects_bit_flips(void) {
+  uint8_t data[32];
+  for (size_t i = 0; i < sizeof(data); i++) {
+    data[i] = (uint8_t)(i * 37 + 11);
+  }
+  uint16_t crc = crc16(data, sizeof(data));
+
+  for (size_t bit = 0; bit < sizeof(data) * 8; bit++) {
+    data[bit / 8] ^= (uint8_t)(1u << (bit % 8));
+    CHECK(crc16(data, sizeof(data)) != crc);
+    data[bit / 8] ^= (uint8_t)(1u << (bit % 8));
+  }
+  CHECK_EQ(crc16(data, sizeof(data)), crc);
+}
+
+int main(void) {
+  RUN_TEST(test_check_value);
+  RUN_TEST(test_detects_bit_flips);
+  return TEST_RESULT();
+}
@@ -0,0 +1,56 @@
+#include "dedup_filter.h"
+#include "test_util.h"
+
+#define START_US 1000000
+#define WINDOW_US ((int64_t)DEDUP_WINDOW_MS * 1000)
+
+static void test_repeat_is_duplicate(void) {
+  dedup_filter_init(START_US);
+  CHECK(!dedup_filter_seen(0x0005, 1, START_US));
+  CHECK(dedup_filter_seen(0x0005, 1, START_US + 1000));
+  // Same id from another sender, next id from the same sender
+  CHECK(!dedup_filter_seen(0x0006, 1, START_US + 2000));
+  CHECK(!dedup_filter_seen(0x0005, 2, START_US + 3000));
+}
+
+static void test_content_keys(void) {
+  const uint32_t key = DEDUP_KEY_CONTENT | 0x1234;
+  dedup_filter_init(START_US);
+  CHECK(!dedup_filter_seen(0x0005, key, START_US));
+  CHECK(dedup_filter_seen(0x0005, key, START_US + 1000));
+  // A CRC equal to an id is a different key
+  CHECK(!dedup_filter_seen(0x0005, DEDUP_KEY_CONTENT | 7, START_US + 2000));
+  CHECK(!dedup_filter_seen(0x0005, 7, START_US + 3000));
+}
+
+static void test_entries_expire(void) {
+  dedup_filter_init(START_US);
+  CHECK(!dedup_filter_seen(0x0005, 1, START_US));
+  // Still remembered one window later (moved to the older generation)
+  CHECK(dedup_filter_seen(0x0005, 1, START_US + WINDOW_US));
+
+  dedup_filter_init(START_US);
+  CHECK(!dedup_filter_seen(0x0005, 1, START_US));
+  CHECK(!dedup_filter_seen(0x0005, 1, START_US + 2 * WINDOW_US));
+}
+
+static void test_no_false_positives_at_low_load(void) {
+  // 2 senders x 64 ids: about 1e-4 false positives expected per lookup
+  dedup_filter_init(START_US);
+  int false_positives = 0;
+  for (uint16_t src = 1; src <= 2; src++) {
+    for (int id = 1; id <= 64; id++) {
+      if (dedup_filter_seen(src, (uint8_t)id, START_US))
+        false_positives++;
+    }
+  }
+  CHECK(false_positives <= 1);
+}
+
+int main(void) {
+  RUN_TEST(test_repeat_is_duplicate);
+  RUN_TEST(test_content_keys);
+  RUN_TEST(test_entries_expire);
+  RUN_TEST(test_no_false_positives_at_low_load);
+  return TEST_RESULT();
+}
@@ -0,0 +1,358 @@
+// End to end through api, message_handler and delivery, with the mesh
+// replaced by the fake in fakes/mesh_fake.c
+
+#include "api.h"
+#include "app_state.h"
+#include "binary_serial.h"
+#include "chat_log.h"
+#include "crc16.h"
+#include "delivery.h"
+#include "esp_timer.h"
+#include "host_shims.h"
+#include "mesh_fake.h"
+#include "message_handler.h"
+#include "node_config.h"
+#include "test_util.h"
+#include "user_table.h"
+
+#define SELF_ADDR 0x0001
+#define PEER_ADDR 0x0010
+
+static peer_id_t ui_last_sender = PEER_NONE;
+static int ui_received = 0;
+
+static void on_ui_receive(peer_id_t sender, const char *msg) {
+  ui_last_sender = sender;
+  ui_received++;
+}
+
+static void setup(void) {
+  host_nvs_reset();
+  host_mesh_reset();
+  node_config_init("self");
+  node_config_set_address(SELF_ADDR);
+  app_state_init();
+  chat_log_init();
+  user_table_init();
+  user_table_clear();
+  api_init(on_ui_receive);
+  message_handler_register_app_cb(api_on_message_view);
+  message_handler_init();
+}
+
+// Serialize msg with its CRC as a peer would send it
+static size_t peer_frame(const MeshMessage *msg, uint8_t *buf) {
+  size_t len = 0;
+  if (serialize_message_v2(msg, esp_timer_get_time(), buf, &len) != 0)
+    return 0;
+  uint16_t crc = crc16(buf, len);
+  buf[len++] = crc >> 8;
+  buf[len++] = crc & 0xFF;
+  return len;
+}
+
+// Delivery state of the newest message of a peer
+static delivery_state_t last_state(peer_id_t peer) {
+  chat_log_iter_t it;
+  chat_log_entry_t entry;
+  delivery_state_t state = DELIVERY_NONE;
+  chat_log_iter_begin(peer, &it);
+  while (chat_log_iter_next(&it, &entry)) {
+    state = entry.state;
+  }
+  return state;
+}
+
+static void test_send_and_ack(void) {
+  CHECK(user_table_set("peer", PEER_ADDR));
+  peer_id_t peer = user_table_peer_id(user_table_find_index_by_addr(PEER_ADDR));
+
+  CHECK_EQ(api_send_text(peer, "hello peer"), 0);
+  CHECK_EQ(last_state(peer), DELIVERY_QUEUED);
+
+  // The aggregation window closes, the frame goes to the mesh
+  CHECK_EQ(host_mesh_queued(), 0);
+  host_clock_advance_ms(MSG_AGG_WINDOW_MS);
+  CHECK_EQ(host_mesh_queued(), 1);
+
+  host_mesh_frame_t frame;
+  CHECK(host_mesh_complete(0, &frame));
+  CHECK_EQ(frame.receiver_add, PEER_ADDR);
+  CHECK_EQ(last_state(peer), DELIVERY_SENT);
+
+  MeshMessage sent;
+  CHECK_EQ(deserialize_message(frame.data, frame.len - 2, esp_timer_get_time(),
+                               &sent),
+           0);
+  CHECK_EQ(sent.payload_len, strlen("hello peer"));
+
+  // The peer confirms it
+  MeshMessage ack;
+  memset(&ack, 0, sizeof(ack));
+  ack.type = MSG_TYPE_ACK;
+  ack.msg_id = sent.msg_id;
+  ack.timestamp = esp_timer_get_time();
+  uint8_t buf[MESH_TX_FRAME_MAX];
+  size_t len = peer_frame(&ack, buf);
+  host_clock_advance_ms(200);
+  host_mesh_receive_ack(PEER_ADDR, buf, len);
+  CHECK_EQ(last_state(peer), DELIVERY_ACKED);
+}
+
+static void test_retransmit_until_failed(void) {
+  peer_id_t peer = user_table_peer_id(user_table_find_index_by_addr(PEER_ADDR));
+  CHECK_EQ(api_send_text(peer, "anyone there?"), 0);
+  host_clock_advance_ms(MSG_AGG_WINDOW_MS);
+
+  // Every transmission goes out, no ACK ever comes back
+  int transmissions = 0;
+  for (int i = 0; i < 20 && last_state(peer) != DELIVERY_FAILED; i++) {
+    while (host_mesh_complete(0, NULL)) {
+      transmissions++;
+    }
+    host_clock_advance_ms(DELIVERY_RTO_MAX_MS);
+  }
+  CHECK_EQ(transmissions, DELIVERY_MAX_ATTEMPTS);
+  CHECK_EQ(last_state(peer), DELIVERY_FAILED);
+}
+
+static void test_full_pending_table_refuses(void) {
+  peer_id_t peer = user_table_peer_id(user_table_find_index_by_addr(PEER_ADDR));
+  char text[16];
+  for (int i = 0; i < DELIVERY_MAX_PENDING; i++) {
+    snprintf(text, sizeof(text), "quick %d", i);
+    CHECK_EQ(api_send_text(peer, text), 0);
+    CHECK_EQ(last_state(peer), DELIVERY_QUEUED);
+  }
+
+  // No slot left to track it: not sent, and marked failed right away
+  CHECK_EQ(api_send_text(peer, "one too many"), -1);
+  CHECK_EQ(last_state(peer), DELIVERY_FAILED);
+
+  // The others went out as one batch; ACK them all in one frame
+  host_clock_advance_ms(MSG_AGG_WINDOW_MS);
+  host_mesh_frame_t frame;
+  CHECK(host_mesh_complete(0, &frame));
+  CHECK_EQ(host_mesh_queued(), 0);
+
+  MeshMessage ack;
+  memset(&ack, 0, sizeof(ack));
+  ack.type = MSG_TYPE_ACK;
+  ack.timestamp = esp_timer_get_time();
+  size_t offset = 0;
+  const uint8_t *record;
+  size_t record_len;
+  int records = 0;
+  while (deserialize_batch_record(frame.data, frame.len - 2, &offset, &record,
+                                  &record_len) > 0) {
+    uint8_t id = frame_peek_msg_id(record, record_len, NULL);
+    if (records == 0) {
+      ack.msg_id = id;
+    } else {
+      ack.payload[ack.payload_len++] = id;
+    }
+    records++;
+  }
+  CHECK_EQ(records, DELIVERY_MAX_PENDING);
+
+  uint8_t buf[MESH_TX_FRAME_MAX];
+  size_t len = peer_frame(&ack, buf);
+  host_mesh_receive_ack(PEER_ADDR, buf, len);
+
+  // Room again for new messages
+  CHECK_EQ(api_send_text(peer, "after the ACK"), 0);
+  host_clock_advance_ms(MSG_AGG_WINDOW_MS);
+  CHECK(host_mesh_complete(0, &frame));
+  MeshMessage sent;
+  CHECK_EQ(deserialize_message(frame.data, frame.len - 2, esp_timer_get_time(),
+                               &sent),
+           0);
+  ack.msg_id = sent.msg_id;
+  ack.payload_len = 0;
+  len = peer_frame(&ack, buf);
+  host_mesh_receive_ack(PEER_ADDR, buf, len);
+  CHECK_EQ(last_state(peer), DELIVERY_ACKED);
+}
+
+// The largest frame the encoder makes, queued behind a short message to
+// the same peer: both go out whole and in order, none over one SDU
+static void test_max_size_record(void) {
+  MeshMessage big;
+  memset(&big, 0, sizeof(big));
+  big.type = MSG_TYPE_TEXT;
+  big.msg_id = 200;
+  memset(big.sender_name, 'n', USERNAME_MAX_LEN - 1);
+  uint32_t seed = 1;
+  for (int i = 0; i < MAX_PAYLOAD_SIZE; i++) {
+    seed = seed * 1103515245u + 12345u; // Incompressible
+    big.payload[i] = (uint8_t)(seed >> 16);
+  }
+  big.payload_len = MAX_PAYLOAD_SIZE;
+
+  MeshMessage small;
+  memset(&small, 0, sizeof(small));
+  small.type = MSG_TYPE_TEXT;
+  small.msg_id = 199;
+  small.payload_len = 2;
+  memcpy(small.payload, "hi", 2);
+
+  CHECK(message_handler_send(&small, PEER_ADDR) > 0);
+  CHECK(message_handler_send(&big, PEER_ADDR) > 0);
+  host_clock_advance_ms(MSG_AGG_WINDOW_MS);
+
+  // Records in send order, from one batch or from plain frames
+  MeshMessage got[2];
+  int n = 0;
+  host_mesh_frame_t frame;
+  while (host_mesh_complete(0, &frame)) {
+    CHECK(frame.len <= MESH_TX_FRAME_MAX);
+    CHECK_EQ(crc16(frame.data, frame.len - 2),
+             (frame.data[frame.len - 2] << 8) | frame.data[frame.len - 1]);
+    if (frame.data[0] != MSG_BATCH_HEADER) {
+      CHECK(n < 2);
+      CHECK_EQ(deserialize_message(frame.data, frame.len - 2,
+                                   esp_timer_get_time(), &got[n++]),
+               0);
+      continue;
+    }
+    size_t offset = 0;
+    const uint8_t *record;
+    size_t record_len;
+    while (n < 2 && deserialize_batch_record(frame.data, frame.len - 2,
+                                             &offset, &record,
+                                             &record_len) > 0) {
+      CHECK_EQ(deserialize_message(record, record_len, esp_timer_get_time(),
+                                   &got[n++]),
+               0);
+    }
+  }
+  CHECK_EQ(n, 2);
+  CHECK_EQ(got[0].msg_id, 199);
+  CHECK_EQ(got[1].msg_id, 200);
+  CHECK_EQ(got[1].payload_len, MAX_PAYLOAD_SIZE);
+  CHECK(memcmp(got[1].payload, big.payload, MAX_PAYLOAD_SIZE) == 0);
+  CHECK_EQ(strlen(got[1].sender_name), USERNAME_MAX_LEN - 1);
+}
+
+static void test_receive_and_dedup(void) {
+  MeshMessage msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.type = MSG_TYPE_TEXT;
+  msg.msg_id = 9;
+  msg.timestamp = esp_timer_get_time();
+  strcpy(msg.sender_name, "newbie");
+  const char *text = "hi from a new node";
+  msg.payload_len = (uint8_t)strlen(text);
+  memcpy(msg.payload, text, msg.payload_len);
+
+  uint8_t buf[MESH_TX_FRAME_MAX];
+  size_t len = peer_frame(&msg, buf);
+  int before = ui_received;
+  host_mesh_receive(0x0022, buf, len);
+
+  // Unknown sender is registered under its name and gets an ACK
+  int idx = user_table_find_index_by_addr(0x0022);
+  CHECK(idx >= 0);
+  CHECK_STR(user_table_get_name(0x0022), "newbie");
+  CHECK_EQ(ui_received, before + 1);
+  CHECK_EQ(ui_last_sender, user_table_peer_id(idx));
+  CHECK(app_state_has_new_message(user_table_peer_id(idx)));
+  CHECK_EQ(chat_log_line_count(user_table_peer_id(idx)), 1);
+
+  host_mesh_frame_t frame;
+  CHECK(host_mesh_complete(0, &frame));
+  CHECK(frame.ack);
+  CHECK_EQ(frame.receiver_add, 0x0022);
+
+  // A repeat (our ACK got lost) is ACKed again but not shown twice
+  uint32_t duplicates = message_handler_get_duplicates();
+  host_mesh_receive(0x0022, buf, len);
+  CHECK_EQ(ui_received, before + 1);
+  CHECK_EQ(message_handler_get_duplicates(), duplicates + 1);
+  CHECK(host_mesh_complete(0, &frame));
+  CHECK(frame.ack);
+
+  // A corrupted frame is dropped
+  buf[3] ^= 0x40;
+  host_mesh_receive(0x0022, buf, len);
+  CHECK_EQ(ui_received, before + 1);
+  CHECK_EQ(host_mesh_queued(), 0);
+}
+
+// Broadcasts carry no msg id: a relayed copy is caught by its content,
+// while a changed announcement (a rename) still gets through
+static void test_broadcast_dedup(void) {
+  MeshMessage msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.type = MSG_TYPE_BROADCAST;
+  strcpy(msg.sender_name, "caster");
+
+  uint8_t buf[MESH_TX_FRAME_MAX];
+  size_t len = peer_frame(&msg, buf);
+  uint32_t duplicates = message_handler_get_duplicates();
+  host_mesh_receive(0x0033, buf, len);
+  CHECK_STR(user_table_get_name(0x0033), "caster");
+  CHECK_EQ(message_handler_get_duplicates(), duplicates);
+
+  host_mesh_receive(0x0033, buf, len);
+  CHECK_EQ(message_handler_get_duplicates(), duplicates + 1);
+  // The same bytes from another node are not a repeat
+  host_mesh_receive(0x0034, buf, len);
+  CHECK_EQ(message_handler_get_duplicates(), duplicates + 1);
+
+  strcpy(msg.sender_name, "recaster");
+  len = peer_frame(&msg, buf);
+  host_mesh_receive(0x0033, buf, len);
+  CHECK_STR(user_table_get_name(0x0033), "recaster");
+  CHECK_EQ(message_handler_get_duplicates(), duplicates + 1);
+  CHECK_EQ(host_mesh_queued(), 0); // Broadcasts are not ACKed
+}
+
+// Evicting a peer for a new one invalidates its handle everywhere: the
+// new peer in the same entry starts clean and the old handle no longer
+// reaches it
+static void test_evicted_handle_goes_stale(void) {
+  setup();
+  user_table_set("alice", PEER_ADDR);
+  peer_id_t alice = user_table_peer_id(0);
+  chat_log_add(alice, "hello alice", false);
+  app_state_set_new_message(alice);
+
+  // alice is the least recently seen peer once the table is full
+  char name[USERNAME_MAX_LEN];
+  for (int i = 1; i <= MAX_USERS; i++) {
+    snprintf(name, sizeof(name), "peer%d", i);
+    user_table_set(name, (uint16_t)(0x0100 + i));
+  }
+  CHECK_EQ(user_table_find_index_by_addr(PEER_ADDR), -1);
+  CHECK_EQ(user_table_index_of(alice), -1);
+
+  int idx = user_table_find_index_by_addr(0x0100 + MAX_USERS);
+  CHECK_EQ(idx, 0);
+  peer_id_t newcomer = user_table_peer_id(idx);
+  CHECK(newcomer != alice);
+  CHECK_EQ(chat_log_line_count(newcomer), 0);
+  CHECK(!app_state_has_new_message(newcomer));
+
+  // Nothing sent or stored through the stale handle
+  CHECK(api_send_text(alice, "are you there?") < 0);
+  CHECK_EQ(host_mesh_queued(), 0);
+  chat_log_add(alice, "late", false);
+  CHECK_EQ(chat_log_line_count(alice), 0);
+  CHECK_EQ(chat_log_line_count(newcomer), 0);
+  CHECK(!app_state_has_new_message(alice));
+  char out[USERNAME_MAX_LEN];
+  CHECK(!api_get_peer_name(alice, out, sizeof(out)));
+}
+
+int main(void) {
+  setup();
+  RUN_TEST(test_send_and_ack);
+  RUN_TEST(test_retransmit_until_failed);
+  RUN_TEST(test_full_pending_table_refuses);
+  RUN_TEST(test_max_size_record);
+  RUN_TEST(test_receive_and_dedup);
+  RUN_TEST(test_broadcast_dedup);
+  RUN_TEST(test_evicted_handle_goes_stale);
+  return TEST_RESULT();
+}
@@ -0,0 +1,91 @@
+#include "spsc_ring.h"
+#include "test_util.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+
+#define SLOTS 8
+
+static void test_init_checks_count(void) {
+  spsc_ring_t ring;
+  uint32_t storage[SLOTS];
+  CHECK_EQ(spsc_ring_init(&ring, storage, sizeof(uint32_t), 6), -1);
+  CHECK_EQ(spsc_ring_init(&ring, storage, sizeof(uint32_t), 0), -1);
+  CHECK_EQ(spsc_ring_init(&ring, storage, sizeof(uint32_t), SLOTS), 0);
+}
+
+static void test_fill_and_drain(void) {
+  spsc_ring_t ring;
+  uint32_t storage[SLOTS];
+  spsc_ring_init(&ring, storage, sizeof(uint32_t), SLOTS);
+  CHECK(spsc_ring_read_slot(&ring) == NULL);
+
+  // Wraps the indices a few times
+  for (uint32_t round = 0; round < 5; round++) {
+    for (uint32_t i = 0; i < SLOTS; i++) {
+      uint32_t *slot = spsc_ring_write_slot(&ring);
+      CHECK(slot != NULL);
+      if (!slot)
+        return;
+      *slot = round * 100 + i;
+      spsc_ring_commit(&ring);
+    }
+    CHECK(spsc_ring_write_slot(&ring) == NULL);
+
+    for (uint32_t i = 0; i < SLOTS; i++) {
+      uint32_t *slot = spsc_ring_read_slot(&ring);
+      CHECK(slot != NULL);
+      if (!slot)
+        return;
+      CHECK_EQ(*slot, round * 100 + i);
+      spsc_ring_release(&ring);
+    }
+    CHECK(spsc_ring_read_slot(&ring) == NULL);
+  }
+}
+
+#define TRANSFER_COUNT 100000
+
+static spsc_ring_t shared_ring;
+static uint32_t shared_storage[SLOTS];
+
+static void *producer(void *arg) {
+  for (uint32_t i = 0; i < TRANSFER_COUNT; i++) {
+    uint32_t *slot;
+    while (!(slot = spsc_ring_write_slot(&shared_ring))) {
+      sched_yield();
+    }
+    *slot = i;
+    spsc_ring_commit(&shared_ring);
+  }
+  return NULL;
+}
+
+static void test_threads_keep_order(void) {
+  spsc_ring_init(&shared_ring, shared_storage, sizeof(uint32_t), SLOTS);
+  pthread_t thread;
+  pthread_create(&thread, NULL, producer, NULL);
+
+  uint32_t expected = 0;
+  bool in_order = true;
+  while (expected < TRANSFER_COUNT) {
+    uint32_t *slot = spsc_ring_read_slot(&shared_ring);
+    if (!slot) {
+      sched_yield();
+      continue;
+    }
+    if (*slot != expected)
+      in_order = false;
+    expected++;
+    spsc_ring_release(&shared_ring);
+  }
+  pthread_join(thread, NULL);
+  CHECK(in_order);
+}
+
+int main(void) {
+  RUN_TEST(test_init_checks_count);
+  RUN_TEST(test_fill_and_drain);
+  RUN_TEST(test_threads_keep_order);
+  return TEST_RESULT();
+}
@@ -0,0 +1,87 @@
+#include "text_codec.h"
+#include "test_util.h"
+
+static const char *const samples[] = {
+    "hello there",
+    "where are you now?",
+    "ok",
+    "I will be there in ten minutes, wait for me at the station",
+    "THE QUICK BROWN FOX",
+    "tab\tand\nnewline",
+};
+
+static void test_round_trip(void) {
+  for (size_t i = 0; i < sizeof(samples) / sizeof(samples[0]); i++) {
+    const uint8_t *in = (const uint8_t *)samples[i];
+    size_t in_len = strlen(samples[i]);
+    uint8_t packed[128];
+    uint8_t text[128];
+
+    size_t packed_len = text_compress(in, in_len, packed, sizeof(packed));
+    if (packed_len == 0)
+      continue; // Not worth compressing, sent as is
+    CHECK(packed_len < in_len);
+    CHECK_EQ(text_decompress(packed, packed_len, text, sizeof(text)), in_len);
+    CHECK(memcmp(text, in, in_len) == 0);
+  }
+}
+
+static void test_compresses_chat_text(void) {
+  const char *text = "where are you now?";
+  uint8_t packed[64];
+  size_t packed_len = text_compress((const uint8_t *)text, strlen(text),
+                                    packed, sizeof(packed));
+  CHECK(packed_len > 0);
+  CHECK(packed_len <= strlen(text) * 3 / 4);
+}
+
+static void test_incompressible(void) {
+  uint8_t packed[64];
+  // Raw bytes need escapes and never shrink
+  const uint8_t raw[] = {0x02, 0x03, 0x90, 0xFF};
+  CHECK_EQ(text_compress(raw, sizeof(raw), packed, sizeof(packed)), 0);
+  // Output that does not fit is reported as not compressible
+  const char *text = "there there there";
+  CHECK_EQ(text_compress((const uint8_t *)text, strlen(text), packed, 2), 0);
+}
+
+static void test_malformed_input(void) {
+  uint8_t text[64];
+  const uint8_t dangling_escape[] = {'a', TEXT_CODEC_ESCAPE};
+  CHECK_EQ(text_decompress(dangling_escape, sizeof(dangling_escape), text,
+                           sizeof(text)),
+           -1);
+  const uint8_t control[] = {'a', 0x05};
+  CHECK_EQ(text_decompress(control, sizeof(control), text, sizeof(text)), -1);
+
+  // Expansion past out_max is rejected
+  uint8_t many[32];
+  memset(many, TEXT_CODEC_DICT_BASE, sizeof(many));
+  CHECK_EQ(text_decompress(many, sizeof(many), text, 8), -1);
+}
+
+static void test_every_dict_entry(void) {
+  // Each entry expands to its full text and compresses back to its byte
+  for (int b = TEXT_CODEC_DICT_BASE; b <= 0xFF; b++) {
+    uint8_t code = (uint8_t)b;
+    uint8_t text[8];
+    int len = text_decompress(&code, 1, text, sizeof(text));
+    CHECK(len >= 2 && len <= 5);
+    if (len < 2)
+      continue;
+    CHECK(memchr(text, '\0', (size_t)len) == NULL);
+
+    uint8_t packed[8];
+    CHECK_EQ(text_compress(text, (size_t)len, packed, sizeof(packed)), 1);
+    CHECK_EQ(packed[0], b);
+  }
+}
+
+int main(void) {
+  RUN_TEST(test_round_trip);
+  RUN_TEST(test_every_dict_entry);
+  RUN_TEST(test_compresses_chat_text);
+  RUN_TEST(test_incompressible);
+  RUN_TEST(test_malformed_input);
+  return TEST_RESULT();
+}
@@ -0,0 +1,217 @@
+// Every screen_t rendered through ui_screens.c and display.c onto the fake
+// SSD1306 panel, compared pixel for pixel with the images in golden/.
+//
+// The tests walk one navigation path in order and share its state. After a
+// deliberate change to a screen, regenerate the images with
+//   MESHTALK_UPDATE_GOLDEN=1 ./test_ui_golden
+// and review the diff of golden/*.pbm (plain text, one row per line).
+
+#include "api.h"
+#include "app_state.h"
+#include "chat_log.h"
+#include "display.h"
+#include "host_shims.h"
+#include "mesh_fake.h"
+#include "message_handler.h"
+#include "node_config.h"
+#include "panel_fake.h"
+#include "test_util.h"
+#include "ui_loop.h"
+#include "ui_screens.h"
+#include "user_table.h"
+#include <stdlib.h>
+
+#ifndef GOLDEN_DIR
+#define GOLDEN_DIR "golden"
+#endif
+
+static peer_id_t alice, bob;
+
+static peer_id_t add_peer(const char *name, uint16_t addr) {
+  user_table_set(name, addr);
+  return user_table_peer_id(user_table_find_index_by_addr(addr));
+}
+
+// One pass of the UI task, then let the display task finish streaming
+static void render(void) {
+  ui_process_delivery_updates();
+  ui_process_timeouts();
+  ui_update_display();
+  CHECK(host_tasks_wait_idle(1000));
+}
+
+static void press(joystick_action_t action) {
+  ui_handle_joystick(action);
+  render();
+}
+
+static void check_golden(const char *name) {
+  char path[256];
+  snprintf(path, sizeof(path), "%s/%s.pbm", GOLDEN_DIR, name);
+
+  if (getenv("MESHTALK_UPDATE_GOLDEN")) {
+    CHECK(host_panel_write_pbm(path));
+    return;
+  }
+
+  int diff = host_panel_diff_pbm(path);
+  if (diff != 0) {
+    fprintf(stderr, "%s: %d pixels differ (-1: unreadable), panel shows:\n",
+            path, diff);
+    host_panel_dump();
+  }
+  CHECK_EQ(diff, 0);
+}
+
+static void setup_world(void) {
+  host_nvs_reset();
+  host_mesh_reset();
+  host_panel_reset();
+  node_config_init("self");
+  node_config_set_address(0x0001);
+  app_state_init();
+  chat_log_init();
+  user_table_init();
+  user_table_clear();
+  message_handler_init();
+
+  alice = add_peer("alice", 0x0010);
+  bob = add_peer("bob", 0x0011);
+  add_peer("carol", 0x0012);
+
+  chat_log_add(alice, "Hi there", false);
+  chat_log_add_outgoing(alice, "Hello", 1);
+  chat_log_set_delivery(alice, 1, DELIVERY_ACKED);
+  chat_log_add(alice, "Meet at the gate in ten minutes?", false);
+  chat_log_add_outgoing(alice, "Which gate?", 2);
+  chat_log_set_delivery(alice, 2, DELIVERY_SENT);
+  chat_log_add(alice, "North", false);
+  app_state_set_new_message(bob);
+
+  display_init();
+  ui_init();
+  render();
+}
+
+static void test_home(void) { check_golden("home"); }
+
+static void test_chat_list(void) {
+  press(JOY_BTN); // Chat
+  CHECK_EQ(app_state_get_screen(), SCREEN_CHAT);
+  check_golden("chat");
+}
+
+static void test_individual_chat(void) {
+  press(JOY_BTN); // alice
+  CHECK_EQ(app_state_get_screen(), SCREEN_INDIVIDUAL_CHAT);
+  check_golden("individual_chat");
+}
+
+// The history fills the window, so a new message moves it up a line: the
+// panel's start line is moved instead of resending the lines still visible.
+// Nine transfers (start line + 8 pages) must all complete without waiting
+// out a timeout.
+static void test_individual_chat_scrolled(void) {
+  host_panel_stats_t before, after;
+  host_panel_get_stats(&before);
+  uint32_t warnings = host_log_count(ESP_LOG_WARN);
+
+  chat_log_add(alice, "On my way", false);
+  ui_on_message_received(alice, "On my way");
+  render();
+
+  host_panel_get_stats(&after);
+  CHECK_EQ(after.start_lines - before.start_lines, 1);
+  CHECK_EQ(host_log_count(ESP_LOG_WARN), warnings);
+  check_golden("individual_chat_scrolled");
+}
+
+static void test_send_message(void) {
+  press(JOY_BTN); // Send Message
+  CHECK_EQ(app_state_get_screen(), SCREEN_SEND_MESSAGE);
+  check_golden("send_message");
+}
+
+// Sending returns to the chat with the delivery toast over it, which
+// follows the delivery updates
+static void test_sent_toast(void) {
+  press(JOY_BTN);
+  CHECK_EQ(app_state_get_screen(), SCREEN_INDIVIDUAL_CHAT);
+  check_golden("sent_toast");
+
+  ui_on_delivery_update(alice, DELIVERY_ACKED);
+  render();
+  check_golden("sent_toast_delivered");
+
+  host_clock_advance_ms(UI_MESSAGE_SENT_DISPLAY_MS);
+  render();
+  while (host_mesh_complete(0, NULL)) {
+  }
+}
+
+static void test_broadcast(void) {
+  press(JOY_LEFT); // Chat list
+  press(JOY_LEFT); // Home
+  press(JOY_DOWN);
+  press(JOY_BTN); // Broadcast
+  CHECK_EQ(app_state_get_screen(), SCREEN_BROADCAST);
+  check_golden("broadcast");
+
+  host_clock_advance_ms(UI_BROADCAST_TIMEOUT_MS + 1);
+  render();
+  CHECK_EQ(app_state_get_screen(), SCREEN_HOME);
+  while (host_mesh_complete(0, NULL)) {
+  }
+}
+
+static void test_about(void) {
+  press(JOY_DOWN);
+  press(JOY_DOWN);
+  press(JOY_BTN); // About
+  CHECK_EQ(app_state_get_screen(), SCREEN_ABOUT);
+  check_golden("about");
+}
+
+// Worst case for the transfer queue: a scroll frame that also changes every
+// page sends the start line plus eight spans
+static void test_full_scroll_frame(void) {
+  host_panel_stats_t before, after;
+  host_panel_get_stats(&before);
+  display_stats_t ds_before, ds_after;
+  display_get_stats(&ds_before);
+  uint32_t warnings = host_log_count(ESP_LOG_WARN);
+
+  display_scroll(1);
+  display_clear();
+  for (int line = 0; line < MAX_DISPLAY_LINES; line++) {
+    char text[MAX_CHARS_PER_LINE + 1];
+    snprintf(text, sizeof(text), "scrolled line %d", line);
+    display_left_text(line, text, false);
+  }
+  display_update();
+  CHECK(host_tasks_wait_idle(1000));
+
+  // A lost completion leaves the task waiting for it (which counts as idle)
+  // instead of finishing the flush
+  host_panel_get_stats(&after);
+  display_get_stats(&ds_after);
+  CHECK_EQ(after.transfers - before.transfers, MAX_DISPLAY_LINES + 1);
+  CHECK_EQ(ds_after.flushes - ds_before.flushes, 1);
+  CHECK_EQ(ds_after.last_transactions, MAX_DISPLAY_LINES + 1);
+  CHECK_EQ(host_log_count(ESP_LOG_WARN), warnings);
+  CHECK_EQ(after.unknown, 0);
+}
+
+int main(void) {
+  setup_world();
+  RUN_TEST(test_home);
+  RUN_TEST(test_chat_list);
+  RUN_TEST(test_individual_chat);
+  RUN_TEST(test_individual_chat_scrolled);
+  RUN_TEST(test_send_message);
+  RUN_TEST(test_sent_toast);
+  RUN_TEST(test_broadcast);
+  RUN_TEST(test_about);
+  RUN_TEST(test_full_scroll_frame);
+  return TEST_RESULT();
+}
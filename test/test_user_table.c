@@ -0,0 +1,324 @@
+#include "host_shims.h"
+#include "nvs.h"
+#include "test_util.h"
+#include "user_table.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+
+static void setup(void) {
+  host_nvs_reset();
+  user_table_init();
+  user_table_clear();
+}
+
+static void test_set_and_find(void) {
+  setup();
+  CHECK(user_table_set("alice", 0x0002));
+  CHECK(user_table_set("bob", 0x0003));
+  CHECK(!user_table_set("", 0x0004));
+  CHECK(!user_table_set(NULL, 0x0004));
+  CHECK_EQ(user_table_count(), 2);
+
+  CHECK_EQ(user_table_get_addr("bob"), 0x0003);
+  CHECK_EQ(user_table_get_addr("bo"), 0);
+  CHECK_STR(user_table_get_name(0x0002), "alice");
+  CHECK(user_table_get_name(0x0009) == NULL);
+  CHECK_EQ(user_table_find_index_by_name("alice"), 0);
+  CHECK_EQ(user_table_find_index_by_addr(0x0003), 1);
+}
+
+static void test_rename_keeps_handle(void) {
+  setup();
+  user_table_set("alice", 0x0002);
+  peer_id_t peer = user_table_peer_id(0);
+
+  CHECK(user_table_set("alicia", 0x0002));
+  CHECK_EQ(user_table_count(), 1);
+  CHECK_EQ(user_table_index_of(peer), 0);
+  CHECK_STR(user_table_get_name(0x0002), "alicia");
+  CHECK_EQ(user_table_find_index_by_name("alice"), -1);
+  CHECK_EQ(user_table_find_index_by_name("alicia"), 0);
+}
+
+static void test_long_name_truncated(void) {
+  setup();
+  CHECK(user_table_set("averyverylongname", 0x0005));
+  CHECK_EQ(strlen(user_table_get_name(0x0005)), USERNAME_MAX_LEN - 1);
+}
+
+static void test_handles(void) {
+  setup();
+  CHECK_EQ(user_table_peer_id(0), PEER_NONE);
+  CHECK_EQ(user_table_index_of(PEER_NONE), -1);
+
+  user_table_set("alice", 0x0002);
+  peer_id_t peer = user_table_peer_id(0);
+  CHECK(peer != PEER_NONE);
+  CHECK_EQ(user_table_index_of(peer), 0);
+  CHECK_EQ(user_table_index_of(peer + 0x100), -1);
+}
+
+static void test_nvs_round_trip(void) {
+  setup();
+  user_table_set("alice", 0x0002);
+  user_table_set("bob", 0x0003);
+  user_table_set("bobby", 0x0003); // Rename rewrites only that entry
+  uint32_t writes = host_nvs_writes();
+  user_table_set("bobby", 0x0003); // No change, nothing written
+  CHECK_EQ(host_nvs_writes(), writes);
+
+  // Simulate a reboot: RAM table gone, NVS kept
+  memset(user_table, 0, sizeof(user_table));
+  CHECK_EQ(user_table_load_from_nvs(), ESP_OK);
+  CHECK_EQ(user_table_count(), 2);
+  CHECK_EQ(user_table_get_addr("alice"), 0x0002);
+  CHECK_EQ(user_table_get_addr("bobby"), 0x0003);
+  CHECK_EQ(user_table_find_index_by_addr(0x0003), 1);
+}
+
+static void test_copy_name(void) {
+  setup();
+  char name[USERNAME_MAX_LEN] = "x";
+  CHECK(!user_table_copy_name(0, name, sizeof(name)));
+  CHECK_STR(name, "x");
+
+  user_table_set("alice", 0x0002);
+  CHECK(user_table_copy_name(0, name, sizeof(name)));
+  CHECK_STR(name, "alice");
+  CHECK(user_table_copy_name(0, name, 3)); // Truncated, still terminated
+  CHECK_STR(name, "al");
+  CHECK(!user_table_copy_name(-1, name, sizeof(name)));
+}
+
+static peer_id_t evicted[4];
+static int evictions;
+
+static void record_evict(peer_id_t peer) {
+  if (evictions < 4)
+    evicted[evictions] = peer;
+  evictions++;
+}
+
+static void name_of(uint16_t addr, char *name) {
+  snprintf(name, USERNAME_MAX_LEN, "n%04x", addr);
+}
+
+// A full table gives the least recently seen entry to the new peer: its
+// handle goes stale, both indices forget it and every other peer stays
+static void test_lru_eviction(void) {
+  setup();
+  user_table_register_evict_cb(record_evict);
+  evictions = 0;
+
+  char name[USERNAME_MAX_LEN];
+  for (int i = 0; i < MAX_USERS; i++) {
+    name_of((uint16_t)(0x0100 + i), name);
+    CHECK(user_table_set(name, (uint16_t)(0x0100 + i)));
+  }
+  CHECK_EQ(user_table_count(), MAX_USERS);
+  CHECK_EQ(evictions, 0);
+
+  // Entry 0 is the oldest, but was just seen
+  user_table_touch(0);
+  peer_id_t victim = user_table_peer_id(1);
+  CHECK(user_table_set("newcomer", 0x0F00));
+
+  CHECK_EQ(evictions, 1);
+  CHECK_EQ(evicted[0], victim);
+  CHECK_EQ(user_table_index_of(victim), -1);
+  CHECK_EQ(user_table_find_index_by_addr(0x0101), -1);
+  CHECK_EQ(user_table_find_index_by_name("n0101"), -1);
+  CHECK_EQ(user_table_find_index_by_addr(0x0F00), 1);
+  CHECK_EQ(user_table_find_index_by_name("newcomer"), 1);
+  CHECK_EQ(user_table_count(), MAX_USERS);
+  for (int i = 0; i < MAX_USERS; i++) {
+    if (i == 1)
+      continue;
+    name_of((uint16_t)(0x0100 + i), name);
+    CHECK_EQ(user_table_find_index_by_addr((uint16_t)(0x0100 + i)), i);
+    CHECK_EQ(user_table_find_index_by_name(name), i);
+  }
+  user_table_register_evict_cb(NULL);
+}
+
+// Every address of the churn range must be found exactly where the table
+// holds it, by address and by name
+static bool indices_consistent(uint16_t base, int range) {
+  char name[USERNAME_MAX_LEN];
+  bool ok = true;
+  for (int a = 0; a < range; a++) {
+    uint16_t addr = (uint16_t)(base + a);
+    int expected = -1;
+    for (int i = 0; i < user_table_count(); i++) {
+      if (user_table[i].unicast_addr == addr)
+        expected = i;
+    }
+    name_of(addr, name);
+    if (user_table_find_index_by_addr(addr) != expected ||
+        user_table_find_index_by_name(name) != expected)
+      ok = false;
+  }
+  return ok;
+}
+
+// A full directory fits its NVS partition and comes back after a reboot
+static void test_nvs_full_directory(void) {
+  setup();
+  uint32_t errors = host_log_count(ESP_LOG_ERROR);
+
+  char name[USERNAME_MAX_LEN];
+  for (int i = 0; i < MAX_USERS; i++) {
+    name_of((uint16_t)(0x0100 + i), name);
+    CHECK(user_table_set(name, (uint16_t)(0x0100 + i)));
+  }
+  CHECK_EQ(host_log_count(ESP_LOG_ERROR), errors);
+
+  memset(user_table, 0, sizeof(user_table));
+  CHECK_EQ(user_table_load_from_nvs(), ESP_OK);
+  CHECK_EQ(user_table_count(), MAX_USERS);
+  for (int i = 0; i < MAX_USERS; i++) {
+    name_of((uint16_t)(0x0100 + i), name);
+    CHECK_EQ(user_table_find_index_by_addr((uint16_t)(0x0100 + i)), i);
+    CHECK_EQ(user_table_find_index_by_name(name), i);
+  }
+}
+
+// The default partition runs out of space before it holds the directory:
+// 630 entries at three per saved user
+static void test_nvs_capacity(void) {
+  host_nvs_reset();
+  nvs_handle_t nvs_handle;
+  CHECK_EQ(nvs_open("meshtalk", NVS_READWRITE, &nvs_handle), ESP_OK);
+
+  uint8_t entry[USERNAME_MAX_LEN + 4] = {0}; // Size of a saved user
+  esp_err_t err = ESP_OK;
+  int saved = 0;
+  for (; saved < MAX_USERS; saved++) {
+    char key[16];
+    snprintf(key, sizeof(key), "user_%d", saved);
+    err = nvs_set_blob(nvs_handle, key, entry, sizeof(entry));
+    if (err != ESP_OK)
+      break;
+  }
+  CHECK_EQ(err, ESP_ERR_NVS_NOT_ENOUGH_SPACE);
+  CHECK_EQ(saved, 630 / 3);
+  CHECK_EQ(host_nvs_free_entries(NVS_DEFAULT_PART_NAME), 0);
+
+  // Rewriting a key reuses its entries; a new one does not fit
+  CHECK_EQ(nvs_set_blob(nvs_handle, "user_0", entry, sizeof(entry)), ESP_OK);
+  CHECK_EQ(nvs_set_u8(nvs_handle, "user_count", 1),
+           ESP_ERR_NVS_NOT_ENOUGH_SPACE);
+  nvs_close(nvs_handle);
+}
+
+// Evictions and renames delete from the hash indices by shifting the rest
+// of the probe cluster back. Churn far more peers than fit through the
+// table and check both indices against the table as it goes, and that the
+// victim is always the least recently set peer.
+static void test_churn_keeps_indices(void) {
+  setup();
+  user_table_register_evict_cb(record_evict);
+
+  enum { RANGE = 4 * MAX_USERS, BASE = 0x2000 };
+  static uint32_t last_set[RANGE]; // Round of the last set, 0 = absent
+  memset(last_set, 0, sizeof(last_set));
+  char name[USERNAME_MAX_LEN];
+  uint32_t seed = 12345;
+  int wrong_victims = 0;
+
+  for (uint32_t round = 1; round <= 20000; round++) {
+    seed = seed * 1103515245u + 12345u;
+    int a = (int)((seed >> 8) % RANGE);
+
+    int lru = -1;
+    if (user_table_count() == MAX_USERS && last_set[a] == 0) {
+      for (int b = 0; b < RANGE; b++) {
+        if (last_set[b] && (lru < 0 || last_set[b] < last_set[lru]))
+          lru = b;
+      }
+    }
+
+    evictions = 0;
+    name_of((uint16_t)(BASE + a), name);
+    CHECK(user_table_set(name, (uint16_t)(BASE + a)));
+    last_set[a] = round;
+    if (lru >= 0) {
+      if (evictions != 1 ||
+          user_table_find_index_by_addr((uint16_t)(BASE + lru)) != -1)
+        wrong_victims++;
+      last_set[lru] = 0;
+    }
+
+    if (round % 97 == 0 && !indices_consistent(BASE, RANGE)) {
+      CHECK(false);
+      break;
+    }
+  }
+  CHECK_EQ(wrong_victims, 0);
+  CHECK(indices_consistent(BASE, RANGE));
+  user_table_register_evict_cb(NULL);
+}
+
+static atomic_bool reader_stop;
+static atomic_int torn_reads;
+
+// Copies every name while the main thread renames and evicts. Every name
+// written is one letter repeated, so a mix of letters is a torn read.
+static void *name_reader(void *arg) {
+  (void)arg;
+  char name[USERNAME_MAX_LEN];
+  while (!atomic_load(&reader_stop)) {
+    for (int i = 0; i < MAX_USERS; i++) {
+      if (!user_table_copy_name(i, name, sizeof(name)))
+        continue;
+      for (size_t k = 1; name[k]; k++) {
+        if (name[k] != name[0]) {
+          atomic_fetch_add(&torn_reads, 1);
+          break;
+        }
+      }
+    }
+  }
+  return NULL;
+}
+
+static void test_concurrent_readers(void) {
+  setup();
+  atomic_store(&reader_stop, false);
+  atomic_store(&torn_reads, 0);
+
+  pthread_t reader;
+  CHECK_EQ(pthread_create(&reader, NULL, name_reader, NULL), 0);
+
+  char name[USERNAME_MAX_LEN];
+  for (int round = 0; round < 200000; round++) {
+    // Rename in place, then push new peers through a full table (evictions)
+    memset(name, 'a' + round % 26, 5);
+    name[5] = '\0';
+    user_table_set(name, 0x0002);
+    memset(name, 'A' + round % 26, USERNAME_MAX_LEN - 1);
+    name[USERNAME_MAX_LEN - 1] = '\0';
+    user_table_set(name, (uint16_t)(0x0100 + round % (MAX_USERS * 2)));
+  }
+
+  atomic_store(&reader_stop, true);
+  pthread_join(reader, NULL);
+  CHECK_EQ(atomic_load(&torn_reads), 0);
+  CHECK_EQ(user_table_count(), MAX_USERS);
+}
+
+int main(void) {
+  RUN_TEST(test_set_and_find);
+  RUN_TEST(test_rename_keeps_handle);
+  RUN_TEST(test_long_name_truncated);
+  RUN_TEST(test_handles);
+  RUN_TEST(test_nvs_round_trip);
+  RUN_TEST(test_copy_name);
+  RUN_TEST(test_lru_eviction);
+  RUN_TEST(test_nvs_full_directory);
+  RUN_TEST(test_nvs_capacity);
+  RUN_TEST(test_churn_keeps_indices);
+  RUN_TEST(test_concurrent_readers);
+  return TEST_RESULT();
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+// Minimal test helpers: a failed CHECK is reported and counted, the test
+// keeps going, and TEST_RESULT() becomes the exit status.
+
+#include <stdio.h>
+#include <string.h>
+
+static int test_failures = 0;
+
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__,         \
+              #cond);                                                          \
+      test_failures++;                                                         \
+    }                                                                          \
+  } while (0)
+
+#define CHECK_EQ(a, b)                                                         \
+  do {                                                                         \
+    long long a_ = (long long)(a), b_ = (long long)(b);                        \
+    if (a_ != b_) {                                                            \
+      fprintf(stderr, "%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n",        \
+              __FILE__, __LINE__, #a, #b, a_, b_);                             \
+      test_failures++;                                                         \
+    }                                                                          \
+  } while (0)
+
+#define CHECK_STR(a, b)                                                        \
+  do {                                                                         \
+    const char *a_ = (a), *b_ = (b);                                           \
+    if (!a_ || !b_ || strcmp(a_, b_) != 0) {                                   \
+      fprintf(stderr, "%s:%d: CHECK_STR(%s, %s) failed: \"%s\" != \"%s\"\n",   \
+              __FILE__, __LINE__, #a, #b, a_ ? a_ : "(null)",                  \
+              b_ ? b_ : "(null)");                                             \
+      test_failures++;                                                         \
+    }                                                                          \
+  } while (0)
+
+#define RUN_TEST(fn)                                                           \
+  do {                                                                         \
+    int before_ = test_failures;                                               \
+    fn();                                                                      \
+    printf("%s %s\n", test_failures == before_ ? "PASS" : "FAIL", #fn);        \
+  } while (0)
+
+#define TEST_RESULT() (test_failures == 0 ? 0 : 1)